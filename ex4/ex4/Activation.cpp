@@ -1,39 +1,512 @@
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
 
 #include "Activation.h"
+#include "SimdHelpers.h"
 
-// See documentation at header file
-Matrix activation::softmax(const Matrix& input)
+// Arguments of the exponential are clamped to this range, so 2^n is
+// always a normal float (e^-87 is below any probability of interest)
+constexpr float exp_min_argument = -87.0F;
+constexpr float exp_max_argument = 88.0F;
+// log2(e), and ln(2) split into a part exact in float and the rest
+// (Cody-Waite), so x - n * ln(2) is exact for every clamped argument
+constexpr float log2e = 1.44269504088896341F;
+constexpr float ln2_high = 0.693359375F;
+constexpr float ln2_low = -2.12194440e-4F;
+// Polynomial P(r) with e^r = 1 + r + r^2 * P(r) on [-ln(2)/2, ln(2)/2]
+// (Cephes expf)
+constexpr float exp_p0 = 1.9875691500e-4F;
+constexpr float exp_p1 = 1.3981999507e-3F;
+constexpr float exp_p2 = 8.3334519073e-3F;
+constexpr float exp_p3 = 4.1665795894e-2F;
+constexpr float exp_p4 = 1.6666665459e-1F;
+constexpr float exp_p5 = 5.0000001201e-1F;
+// Exponent bias of a float, and the position of its exponent bits
+constexpr int float_exponent_bias = 127;
+constexpr int float_exponent_shift = 23;
+
+/**
+* Approximates e^x as 2^n * e^r, with n the integer nearest to
+* x / ln(2) and e^r from the polynomial. Every kernel below uses the
+* same steps, vectorized.
+*/
+static inline float exp_scalar(float x)
 {
-	Matrix softmax_matrix(input);
+	x = std::min(std::max(x, exp_min_argument), exp_max_argument);
+	const float n = std::floor((x * log2e) + 0.5F);
+	float r = x - (n * ln2_high);
+	r -= n * ln2_low;
+
+	float polynomial = exp_p0;
+	polynomial = (polynomial * r) + exp_p1;
+	polynomial = (polynomial * r) + exp_p2;
+	polynomial = (polynomial * r) + exp_p3;
+	polynomial = (polynomial * r) + exp_p4;
+	polynomial = (polynomial * r) + exp_p5;
+	polynomial = (polynomial * r * r) + r + 1.0F;
 
-	float variable_sum = 0;
-	// Calculating the expontential sum of the matrix first
-	for (
-		int row_index = 0;
-		row_index < input.get_rows() * input.get_cols();
-		row_index++)
+	const int32_t bits = (static_cast<int32_t>(n) + float_exponent_bias)
+						 << float_exponent_shift;
+	float scale = 0;
+	std::memcpy(&scale, &bits, sizeof(scale));
+	return polynomial * scale;
+}
+
+/**
+* Portable softmax (or log-softmax) of one sample, whose values are
+* stride apart: a max pass, an exponential pass (storing the
+* exponentials for softmax), then normalization in place.
+*/
+template <bool Logarithm>
+static void softmax_scalar(float* data, int size, int stride)
+{
+	float maximum = data[0];
+	for (int index = 1; index < size; index++)
 	{
-		variable_sum += std::exp(input[row_index]);
+		maximum = std::max(maximum, data[index * stride]);
 	}
 
-	for (int column_index = 0; 
-		 column_index < input.get_cols(); 
-		 column_index++)
+	float sum = 0;
+	for (int index = 0; index < size; index++)
+	{
+		const float value = exp_scalar(data[index * stride] - maximum);
+		if (!Logarithm)
+		{
+			data[index * stride] = value;
+		}
+		sum += value;
+	}
+
+	if (Logarithm)
+	{
+		const float shift = maximum + std::log(sum);
+		for (int index = 0; index < size; index++)
+		{
+			data[index * stride] -= shift;
+		}
+		return;
+	}
+
+	const float inverse = 1.0F / sum;
+	for (int index = 0; index < size; index++)
+	{
+		data[index * stride] *= inverse;
+	}
+}
+
+#if SIMD_X86
+
+/**
+* AVX2/FMA exponential of 8 values (see exp_scalar).
+*/
+SIMD_TARGET("avx2,fma")
+static inline __m256 exp_avx2(__m256 x)
+{
+	x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(exp_min_argument)),
+					  _mm256_set1_ps(exp_max_argument));
+	const __m256 n = _mm256_floor_ps(_mm256_fmadd_ps(
+		x, _mm256_set1_ps(log2e), _mm256_set1_ps(0.5F)));
+	__m256 r = _mm256_fnmadd_ps(n, _mm256_set1_ps(ln2_high), x);
+	r = _mm256_fnmadd_ps(n, _mm256_set1_ps(ln2_low), r);
+
+	__m256 polynomial = _mm256_set1_ps(exp_p0);
+	polynomial = _mm256_fmadd_ps(polynomial, r, _mm256_set1_ps(exp_p1));
+	polynomial = _mm256_fmadd_ps(polynomial, r, _mm256_set1_ps(exp_p2));
+	polynomial = _mm256_fmadd_ps(polynomial, r, _mm256_set1_ps(exp_p3));
+	polynomial = _mm256_fmadd_ps(polynomial, r, _mm256_set1_ps(exp_p4));
+	polynomial = _mm256_fmadd_ps(polynomial, r, _mm256_set1_ps(exp_p5));
+	polynomial = _mm256_fmadd_ps(_mm256_mul_ps(polynomial, r), r,
+								 _mm256_add_ps(r, _mm256_set1_ps(1.0F)));
+
+	const __m256i bits = _mm256_slli_epi32(
+		_mm256_add_epi32(_mm256_cvtps_epi32(n),
+						 _mm256_set1_epi32(float_exponent_bias)),
+		float_exponent_shift);
+	return _mm256_mul_ps(polynomial, _mm256_castsi256_ps(bits));
+}
+
+/**
+* AVX-512 exponential of 16 values (see exp_scalar).
+*/
+SIMD_AVX512_BEGIN
+SIMD_TARGET("avx512f,avx2,fma")
+static inline __m512 exp_avx512(__m512 x)
+{
+	x = _mm512_min_ps(_mm512_max_ps(x, _mm512_set1_ps(exp_min_argument)),
+					  _mm512_set1_ps(exp_max_argument));
+	const __m512 n = _mm512_roundscale_ps(
+		_mm512_fmadd_ps(x, _mm512_set1_ps(log2e), _mm512_set1_ps(0.5F)),
+		_MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+	__m512 r = _mm512_fnmadd_ps(n, _mm512_set1_ps(ln2_high), x);
+	r = _mm512_fnmadd_ps(n, _mm512_set1_ps(ln2_low), r);
+
+	__m512 polynomial = _mm512_set1_ps(exp_p0);
+	polynomial = _mm512_fmadd_ps(polynomial, r, _mm512_set1_ps(exp_p1));
+	polynomial = _mm512_fmadd_ps(polynomial, r, _mm512_set1_ps(exp_p2));
+	polynomial = _mm512_fmadd_ps(polynomial, r, _mm512_set1_ps(exp_p3));
+	polynomial = _mm512_fmadd_ps(polynomial, r, _mm512_set1_ps(exp_p4));
+	polynomial = _mm512_fmadd_ps(polynomial, r, _mm512_set1_ps(exp_p5));
+	polynomial = _mm512_fmadd_ps(_mm512_mul_ps(polynomial, r), r,
+								 _mm512_add_ps(r, _mm512_set1_ps(1.0F)));
+
+	const __m512i bits = _mm512_slli_epi32(
+		_mm512_add_epi32(_mm512_cvtps_epi32(n),
+						 _mm512_set1_epi32(float_exponent_bias)),
+		float_exponent_shift);
+	return _mm512_mul_ps(polynomial, _mm512_castsi512_ps(bits));
+}
+SIMD_AVX512_END
+
+/**
+* AVX2/FMA exponential of a buffer, the tail through masked lanes.
+*/
+SIMD_TARGET("avx2,fma")
+static void exp_buffer_avx2(const float* input, int count, float* output)
+{
+	for (int index = 0; index < count; index += 8)
+	{
+		const __m256i mask = tail_mask_avx2(count - index);
+		_mm256_maskstore_ps(output + index, mask, exp_avx2(
+			_mm256_maskload_ps(input + index, mask)));
+	}
+}
+
+/**
+* AVX-512 exponential of a buffer, the tail through masked lanes.
+*/
+SIMD_AVX512_BEGIN
+SIMD_TARGET("avx512f,avx2,fma")
+static void exp_buffer_avx512(const float* input, int count, float* output)
+{
+	for (int index = 0; index < count; index += 16)
+	{
+		const __mmask16 mask = tail_mask_avx512(count - index);
+		_mm512_mask_storeu_ps(output + index, mask, exp_avx512(
+			_mm512_maskz_loadu_ps(mask, input + index)));
+	}
+}
+SIMD_AVX512_END
+
+/**
+* AVX2/FMA softmax (or log-softmax) of one contiguous sample, 8 values
+* at a time (see softmax_scalar).
+*/
+template <bool Logarithm>
+SIMD_TARGET("avx2,fma")
+static void softmax_avx2(float* data, int size)
+{
+	const __m256 lowest =
+		_mm256_set1_ps(-std::numeric_limits<float>::infinity());
+	__m256 maximum = lowest;
+	for (int index = 0; index < size; index += 8)
+	{
+		const __m256i mask = tail_mask_avx2(size - index);
+		maximum = _mm256_max_ps(maximum, _mm256_blendv_ps(
+			lowest, _mm256_maskload_ps(data + index, mask),
+			_mm256_castsi256_ps(mask)));
+	}
+	__m128 folded = _mm_max_ps(_mm256_castps256_ps128(maximum),
+							   _mm256_extractf128_ps(maximum, 1));
+	folded = _mm_max_ps(folded, _mm_movehl_ps(folded, folded));
+	folded = _mm_max_ss(folded, _mm_movehdup_ps(folded));
+	const float maximum_value = _mm_cvtss_f32(folded);
+
+	// Summed in order, as the column kernels and a scalar loop do, so a
+	// sample gets the same probabilities alone and within a batch
+	float sum_value = 0;
+	for (int index = 0; index < size; index += 8)
 	{
-		for (
-			int row_index = 0; 
-			row_index < input.get_rows(); 
-			row_index++)
+		const __m256i mask = tail_mask_avx2(size - index);
+		const __m256 value = exp_avx2(_mm256_sub_ps(
+			_mm256_maskload_ps(data + index, mask),
+			_mm256_set1_ps(maximum_value)));
+		if (!Logarithm)
 		{
-			softmax_matrix(row_index, column_index) =
-				std::exp(input(row_index, column_index)) / variable_sum;
+			_mm256_maskstore_ps(data + index, mask, value);
 		}
+
+		float lanes[8];
+		_mm256_storeu_ps(lanes, value);
+		for (int lane = 0; lane < std::min(8, size - index); lane++)
+		{
+			sum_value += lanes[lane];
+		}
+	}
+
+	const __m256 shift = _mm256_set1_ps(
+		Logarithm ? (maximum_value + std::log(sum_value)) : 0.0F);
+	const __m256 inverse = _mm256_set1_ps(1.0F / sum_value);
+	for (int index = 0; index < size; index += 8)
+	{
+		const __m256i mask = tail_mask_avx2(size - index);
+		const __m256 value = _mm256_maskload_ps(data + index, mask);
+		_mm256_maskstore_ps(data + index, mask, Logarithm ?
+			_mm256_sub_ps(value, shift) : _mm256_mul_ps(value, inverse));
 	}
+}
+
+/**
+* AVX-512 softmax (or log-softmax) of one contiguous sample, 16 values
+* at a time (see softmax_scalar).
+*/
+SIMD_AVX512_BEGIN
+template <bool Logarithm>
+SIMD_TARGET("avx512f,avx2,fma")
+static void softmax_avx512(float* data, int size)
+{
+	const __m512 lowest =
+		_mm512_set1_ps(-std::numeric_limits<float>::infinity());
+	__m512 maximum = lowest;
+	for (int index = 0; index < size; index += 16)
+	{
+		const __mmask16 mask = tail_mask_avx512(size - index);
+		maximum = _mm512_max_ps(
+			maximum, _mm512_mask_loadu_ps(lowest, mask, data + index));
+	}
+	const float maximum_value = _mm512_reduce_max_ps(maximum);
+
+	// Summed in order (see softmax_avx2)
+	float sum_value = 0;
+	for (int index = 0; index < size; index += 16)
+	{
+		const __mmask16 mask = tail_mask_avx512(size - index);
+		const __m512 value = exp_avx512(_mm512_sub_ps(
+			_mm512_maskz_loadu_ps(mask, data + index),
+			_mm512_set1_ps(maximum_value)));
+		if (!Logarithm)
+		{
+			_mm512_mask_storeu_ps(data + index, mask, value);
+		}
+
+		float lanes[16];
+		_mm512_storeu_ps(lanes, value);
+		for (int lane = 0; lane < std::min(16, size - index); lane++)
+		{
+			sum_value += lanes[lane];
+		}
+	}
+
+	const __m512 shift = _mm512_set1_ps(
+		Logarithm ? (maximum_value + std::log(sum_value)) : 0.0F);
+	const __m512 inverse = _mm512_set1_ps(1.0F / sum_value);
+	for (int index = 0; index < size; index += 16)
+	{
+		const __mmask16 mask = tail_mask_avx512(size - index);
+		const __m512 value = _mm512_maskz_loadu_ps(mask, data + index);
+		_mm512_mask_storeu_ps(data + index, mask, Logarithm ?
+			_mm512_sub_ps(value, shift) : _mm512_mul_ps(value, inverse));
+	}
+}
+SIMD_AVX512_END
+
+/**
+* AVX2/FMA softmax (or log-softmax) of every column of a row-major
+* buffer, 8 columns (samples) at a time, so every load is of
+* consecutive values (see softmax_scalar).
+*/
+template <bool Logarithm>
+SIMD_TARGET("avx2,fma")
+static void softmax_columns_avx2(float* data, int rows, int cols)
+{
+	for (int column = 0; column < cols; column += 8)
+	{
+		const __m256i mask = tail_mask_avx2(cols - column);
+		float* block = data + column;
+		__m256 maximum = _mm256_maskload_ps(block, mask);
+		for (int row = 1; row < rows; row++)
+		{
+			maximum = _mm256_max_ps(
+				maximum, _mm256_maskload_ps(block + (row * cols), mask));
+		}
+
+		__m256 sum = _mm256_setzero_ps();
+		for (int row = 0; row < rows; row++)
+		{
+			const __m256 value = exp_avx2(_mm256_sub_ps(
+				_mm256_maskload_ps(block + (row * cols), mask), maximum));
+			if (!Logarithm)
+			{
+				_mm256_maskstore_ps(block + (row * cols), mask, value);
+			}
+			sum = _mm256_add_ps(sum, value);
+		}
+
+		// The logarithm of the 8 sums is left to the library
+		__m256 shift = _mm256_setzero_ps();
+		if (Logarithm)
+		{
+			float lanes[8];
+			_mm256_storeu_ps(lanes, sum);
+			for (float& lane : lanes)
+			{
+				lane = std::log(lane);
+			}
+			shift = _mm256_add_ps(maximum, _mm256_loadu_ps(lanes));
+		}
+		const __m256 inverse = _mm256_div_ps(_mm256_set1_ps(1.0F), sum);
+		for (int row = 0; row < rows; row++)
+		{
+			const __m256 value =
+				_mm256_maskload_ps(block + (row * cols), mask);
+			_mm256_maskstore_ps(block + (row * cols), mask, Logarithm ?
+				_mm256_sub_ps(value, shift) : _mm256_mul_ps(value, inverse));
+		}
+	}
+}
+
+/**
+* AVX-512 softmax (or log-softmax) of every column of a row-major
+* buffer, 16 columns (samples) at a time (see softmax_columns_avx2).
+*/
+SIMD_AVX512_BEGIN
+template <bool Logarithm>
+SIMD_TARGET("avx512f,avx2,fma")
+static void softmax_columns_avx512(float* data, int rows, int cols)
+{
+	for (int column = 0; column < cols; column += 16)
+	{
+		const __mmask16 mask = tail_mask_avx512(cols - column);
+		float* block = data + column;
+		__m512 maximum = _mm512_maskz_loadu_ps(mask, block);
+		for (int row = 1; row < rows; row++)
+		{
+			maximum = _mm512_max_ps(
+				maximum, _mm512_maskz_loadu_ps(mask, block + (row * cols)));
+		}
+
+		__m512 sum = _mm512_setzero_ps();
+		for (int row = 0; row < rows; row++)
+		{
+			const __m512 value = exp_avx512(_mm512_sub_ps(
+				_mm512_maskz_loadu_ps(mask, block + (row * cols)), maximum));
+			if (!Logarithm)
+			{
+				_mm512_mask_storeu_ps(block + (row * cols), mask, value);
+			}
+			sum = _mm512_add_ps(sum, value);
+		}
+
+		// The logarithm of the 16 sums is left to the library
+		__m512 shift = _mm512_setzero_ps();
+		if (Logarithm)
+		{
+			float lanes[16];
+			_mm512_storeu_ps(lanes, sum);
+			for (float& lane : lanes)
+			{
+				lane = std::log(lane);
+			}
+			shift = _mm512_add_ps(maximum, _mm512_loadu_ps(lanes));
+		}
+		const __m512 inverse = _mm512_div_ps(_mm512_set1_ps(1.0F), sum);
+		for (int row = 0; row < rows; row++)
+		{
+			const __m512 value =
+				_mm512_maskz_loadu_ps(mask, block + (row * cols));
+			_mm512_mask_storeu_ps(block + (row * cols), mask, Logarithm ?
+				_mm512_sub_ps(value, shift) : _mm512_mul_ps(value, inverse));
+		}
+	}
+}
+SIMD_AVX512_END
+
+#endif
+
+/**
+* Applies softmax (or log-softmax) in place to every column of a
+* row-major buffer, with the kernel of the active instruction set.
+* A single column is vectorized along its values, several columns
+* across the samples.
+*/
+template <bool Logarithm>
+static void softmax_dispatch(float* data, int rows, int cols)
+{
+	switch (simd::active_isa())
+	{
+#if SIMD_X86
+	case simd::isa::AVX512:
+		if (1 == cols)
+		{
+			softmax_avx512<Logarithm>(data, rows);
+		}
+		else
+		{
+			softmax_columns_avx512<Logarithm>(data, rows, cols);
+		}
+		break;
+	case simd::isa::AVX2:
+		if (1 == cols)
+		{
+			softmax_avx2<Logarithm>(data, rows);
+		}
+		else
+		{
+			softmax_columns_avx2<Logarithm>(data, rows, cols);
+		}
+		break;
+#endif
+	default:
+		for (int column = 0; column < cols; column++)
+		{
+			softmax_scalar<Logarithm>(data + column, rows, cols);
+		}
+		break;
+	}
+}
+
+// See documentation at header file
+void activation::exp_approx(const float* input, int count, float* output)
+{
+	exp_approx(simd::active_isa(), input, count, output);
+}
+
+// See documentation at header file
+void activation::exp_approx(simd::isa set, const float* input, int count,
+							float* output)
+{
+	switch (set)
+	{
+#if SIMD_X86
+	case simd::isa::AVX512:
+		exp_buffer_avx512(input, count, output);
+		break;
+	case simd::isa::AVX2:
+		exp_buffer_avx2(input, count, output);
+		break;
+#endif
+	default:
+		for (int index = 0; index < count; index++)
+		{
+			output[index] = exp_scalar(input[index]);
+		}
+		break;
+	}
+}
+
+// See documentation at header file
+Matrix activation::softmax(const Matrix& input)
+{
+	// Normalized over every value of the matrix, as one sample
+	Matrix softmax_matrix(input);
+	softmax_dispatch<false>(
+		softmax_matrix.data(), input.get_rows() * input.get_cols(), 1);
 
 	return softmax_matrix;
 }
 
+// See documentation at header file
+Matrix activation::log_softmax(const Matrix& input)
+{
+	Matrix log_softmax_matrix(input);
+	softmax_dispatch<true>(
+		log_softmax_matrix.data(), input.get_rows() * input.get_cols(), 1);
+
+	return log_softmax_matrix;
+}
+
 // See documentation at header file
 Matrix activation::relu(const Matrix& input)
 {
@@ -51,3 +524,74 @@ Matrix activation::relu(const Matrix& input)
 
 	return relu_matrix;
 }
+
+// See documentation at header file
+void activation::softmax_columns(float* data, int rows, int cols)
+{
+	softmax_dispatch<false>(data, rows, cols);
+}
+
+// See documentation at header file
+void activation::log_softmax_columns(float* data, int rows, int cols)
+{
+	softmax_dispatch<true>(data, rows, cols);
+}
+
+// See documentation at header file
+Matrix activation::apply_columns(ActivationPfn activation_func,
+								 const MatrixView& input)
+{
+	// ReLU is element-wise, so it needs no splitting into columns
+	if (relu == activation_func)
+	{
+		Matrix output(input.get_rows(), input.get_cols());
+		float* destination = output.data();
+		for (int row_index = 0; row_index < input.get_rows(); row_index++)
+		{
+			for (int column_index = 0;
+				 column_index < input.get_cols();
+				 column_index++)
+			{
+				const float value = input(row_index, column_index);
+				*destination++ = (value < 0) ? 0.0F : value;
+			}
+		}
+		return output;
+	}
+
+	if (softmax == activation_func)
+	{
+		Matrix output = input.to_matrix();
+		softmax_columns(output.data(), output.get_rows(), output.get_cols());
+		return output;
+	}
+
+	if (log_softmax == activation_func)
+	{
+		Matrix output = input.to_matrix();
+		log_softmax_columns(output.data(), output.get_rows(),
+							output.get_cols());
+		return output;
+	}
+
+	if (1 == input.get_cols())
+	{
+		return activation_func(input.to_matrix());
+	}
+
+	// Any other activation is applied to one column at a time
+	Matrix output(input.get_rows(), input.get_cols());
+	for (int column_index = 0;
+		 column_index < input.get_cols();
+		 column_index++)
+	{
+		const Matrix activated =
+			activation_func(input.column(column_index).to_matrix());
+		for (int row_index = 0; row_index < input.get_rows(); row_index++)
+		{
+			output(row_index, column_index) = activated[row_index];
+		}
+	}
+
+	return output;
+}
@@ -2,16 +2,52 @@
 #define ACTIVATION_H
 
 #include "Matrix.h"
+#include "MatrixView.h"
+#include "Simd.h"
 
 namespace activation
 {
+	// Maximal relative error of exp_approx against the exact exponential,
+	// for arguments within [-87, 88] (arguments outside are clamped)
+	constexpr float EXP_MAX_RELATIVE_ERROR = 2e-7F;
+
+	/**
+	* Computes e^x of every value with the polynomial approximation used
+	* by the Softmax filters, within EXP_MAX_RELATIVE_ERROR, using the
+	* most capable kernel for the CPU (see simd::active_isa).
+	* @param input - The values.
+	* @param count - The number of values.
+	* @param output - The exponentials, may be the input.
+	*/
+	void exp_approx(const float* input, int count, float* output);
+
 	/**
-	* Applies a Softmax filter to a matrix. 
+	* Same as above, with an explicitly selected kernel.
+	* The instruction set must be supported by the CPU.
+	* @param set - The instruction set of the kernel to use.
+	*/
+	void exp_approx(simd::isa set, const float* input, int count,
+					float* output);
+
+	/**
+	* Applies a Softmax filter to a matrix, over all of its values.
+	* The maximal value is subtracted first, so large values do not
+	* overflow, and every exponential is computed once (see exp_approx).
 	* @param input - The matrix to apply to.
 	* @return The matrix after application
 	*/
 	Matrix softmax(const Matrix& input);
 
+	/**
+	* Applies a log-Softmax filter to a matrix, over all of its values:
+	* the logarithm of every Softmax probability, computed as
+	* x - max - log(sum(e^(x - max))) without dividing. The argmax is
+	* unchanged, and small probabilities keep their precision.
+	* @param input - The matrix to apply to.
+	* @return The matrix after application
+	*/
+	Matrix log_softmax(const Matrix& input);
+
 	/**
 	* Applies a relu filter to a matrix.
 	* @param input - The matrix to apply to.
@@ -19,8 +55,41 @@ namespace activation
 	*/
 	Matrix relu(const Matrix& input);
 
+	/**
+	* Applies a Softmax filter in place to every column of a raw
+	* row-major buffer, each column being an independent sample.
+	* Several columns are vectorized across the samples, a single one
+	* along its values; either way a sample gets the same result.
+	* @param data - The buffer to apply to.
+	* @param rows - The row count of the buffer (values per sample).
+	* @param cols - The column count of the buffer (samples).
+	*/
+	void softmax_columns(float* data, int rows, int cols);
+
+	/**
+	* Applies a log-Softmax filter in place to every column of a raw
+	* row-major buffer, each column being an independent sample.
+	* @param data - The buffer to apply to.
+	* @param rows - The row count of the buffer (values per sample).
+	* @param cols - The column count of the buffer (samples).
+	*/
+	void log_softmax_columns(float* data, int rows, int cols);
+
 	// Generic activation function pointer definition
 	using ActivationPfn = decltype(&relu);
+
+	/**
+	* Applies an activation function to every column of a matrix
+	* or view separately, each column being an independent sample.
+	* For a single-column matrix this is the activation itself.
+	* ReLU and Softmax read the view in place, other activations
+	* are given a copy of every column.
+	* @param activation_func - The activation to apply.
+	* @param input - The matrix or view to apply to.
+	* @return The matrix after application
+	*/
+	Matrix apply_columns(ActivationPfn activation_func,
+						 const MatrixView& input);
 }
 
 #endif //ACTIVATION_H
\ No newline at end of file
@@ -1,15 +1,88 @@
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
 #include "Dense.h"
+#include "Gemm.h"
+#include "Gemv.h"
+
+/**
+* Converts the weights to 16 bits, for the FP16 and BF16 formats.
+* @return The converted weights, nullptr for any other format.
+*/
+static HalfMatrix* half_weights(const Matrix& weights, weight_format format)
+{
+	switch (format)
+	{
+	case weight_format::FP16:
+		return new HalfMatrix(weights, half_format::FP16);
+	case weight_format::BF16:
+		return new HalfMatrix(weights, half_format::BF16);
+	default:
+		return nullptr;
+	}
+}
+
+/**
+* Pads FP32 weights so every row starts on a Matrix::ALIGNMENT boundary,
+* unless they already do. Borrowed (mapped) weights are kept as they are.
+* @return The weights to multiply by.
+*/
+static Matrix aligned_weights(Matrix weights)
+{
+	const float* values = static_cast<const Matrix&>(weights).data();
+	if (weights.is_borrowed() ||
+		((0 == (weights.get_stride() % Matrix::PADDING)) &&
+		 (0 == (reinterpret_cast<uintptr_t>(values) % Matrix::ALIGNMENT))))
+	{
+		return weights;
+	}
+
+	return Matrix(weights, matrix_layout::PADDED);
+}
 
 // See documentation at header file
 Dense::Dense(Matrix weights,
 			 Matrix bias,
-			 activation::ActivationPfn activation_func) :
-	_activation_func(activation_func), _weights(weights), _bias(bias)
-{}
+			 activation::ActivationPfn activation_func,
+			 weight_format format) :
+	_activation_func(activation_func),
+	_format(format),
+	_dims({weights.get_rows(), weights.get_cols()}),
+	_quantized((weight_format::INT8 == format) ?
+			   new QuantizedMatrix(weights) : nullptr),
+	_half(half_weights(weights, format)),
+	_sparse((weight_format::SPARSE == format) ?
+			new SparseMatrix(weights) : nullptr),
+	// Reduced formats only keep their converted copy
+	_weights((weight_format::FP32 == format) ?
+			 aligned_weights(std::move(weights)) : Matrix()),
+	_bias(std::move(bias))
+{
+	if ((_bias.get_rows() != _dims.rows) || (1 != _bias.get_cols()))
+	{
+		throw std::length_error(INCOMPATIBLE_DIMENSIONS_EX);
+	}
+}
 
 // See documentation at header file
 Matrix Dense::get_weights() const
 {
+	if (nullptr != _quantized)
+	{
+		return _quantized->to_matrix();
+	}
+	if (nullptr != _half)
+	{
+		return _half->to_matrix();
+	}
+	if (nullptr != _sparse)
+	{
+		return _sparse->to_matrix();
+	}
+
 	return _weights;
 }
 
@@ -25,8 +98,229 @@ activation::ActivationPfn Dense::get_activation() const
 	return _activation_func;
 }
 
+// See documentation at header file
+weight_format Dense::get_weight_format() const
+{
+	return _format;
+}
+
 // See documentation at header file
 Matrix Dense::operator()(const Matrix& input) const
 {
-	return _activation_func((_weights * input) + _bias);
+	return operator()(MatrixView(input));
+}
+
+// See documentation at header file
+Matrix Dense::operator()(const MatrixView& input) const
+{
+	if (input.get_rows() != _dims.cols)
+	{
+		throw std::length_error(INCOMPATIBLE_DIMENSIONS_EX);
+	}
+
+	Matrix output(_dims.rows, input.get_cols());
+	forward(input, output.data());
+	return output;
+}
+
+// See documentation at header file
+void Dense::forward(const float* input, float* output, int batch) const
+{
+	forward(MatrixView(input, _dims.cols, batch, batch), output);
+}
+
+// See documentation at header file
+void Dense::forward(const MatrixView& input, float* output) const
+{
+	const int batch = input.get_cols();
+	const bool fused_relu = (activation::relu == _activation_func);
+	MLP_INSTRUMENT(_counters.add_call(batch, forward_flops(batch),
+									  forward_bytes(batch)));
+
+	{
+		MLP_INSTRUMENT(const instrumentation::ScopedTimer timer(
+			_counters, instrumentation::step::PRODUCT));
+		multiply(input, output, {_bias.data(), fused_relu});
+	}
+
+	if (!fused_relu)
+	{
+		MLP_INSTRUMENT(const instrumentation::ScopedTimer timer(
+			_counters, instrumentation::step::ACTIVATION));
+		apply_activation(output, batch);
+	}
+}
+
+// See documentation at header file
+void Dense::multiply(const MatrixView& input, float* output,
+					 const epilogue& post) const
+{
+	const int batch = input.get_cols();
+	if (nullptr != _quantized)
+	{
+		forward_int8(input, output, post);
+	}
+	else if (nullptr != _half)
+	{
+		if ((1 == batch) && (1 == input.row_step()))
+		{
+			gemv::multiply(*_half, input.data(), output, post);
+		}
+		else
+		{
+			gemm::multiply(*_half, input, output, batch, post);
+		}
+	}
+	else if (nullptr != _sparse)
+	{
+		if ((1 == batch) && (1 == input.row_step()))
+		{
+			gemv::multiply(*_sparse, input.data(), output, post);
+		}
+		else
+		{
+			gemm::multiply(*_sparse, input, output, batch, post);
+		}
+	}
+	else if ((1 == batch) && (1 == input.row_step()))
+	{
+		// Images and ReLU outputs are mostly zeros, which are skipped
+		const Matrix& weight_columns = columns();
+		gemv::multiply_sparse_input(
+			_dims.rows, _dims.cols, _weights.data(), _weights.get_stride(),
+			weight_columns.data(), weight_columns.get_stride(), input.data(),
+			output, post);
+	}
+	else if (1 == batch)
+	{
+		gemv::multiply(_weights, input, output, post);
+	}
+	else
+	{
+		gemm::multiply(_weights, input, output, batch, post);
+	}
+}
+
+// See documentation at header file
+const Matrix& Dense::columns() const
+{
+	std::call_once(_columns_built, [this]()
+	{
+		_columns = MatrixView(_weights).transpose().to_matrix();
+	});
+	return _columns;
+}
+
+// See documentation at header file
+void Dense::apply_activation(float* output, int batch) const
+{
+	const int rows = _dims.rows;
+	if (activation::softmax == _activation_func)
+	{
+		activation::softmax_columns(output, rows, batch);
+		return;
+	}
+
+	if (activation::log_softmax == _activation_func)
+	{
+		activation::log_softmax_columns(output, rows, batch);
+		return;
+	}
+
+	// Any other activation goes through its Matrix interface
+	const Matrix activated = activation::apply_columns(
+		_activation_func, MatrixView(output, rows, batch, batch));
+	std::copy(activated.data(), activated.data() + (rows * batch), output);
+}
+
+// See documentation at header file
+void Dense::forward_int8(const MatrixView& input, float* output,
+						 const epilogue& post) const
+{
+	const int rows = _dims.rows;
+	const int batch = input.get_cols();
+	if ((1 == batch) && (1 == input.row_step()))
+	{
+		gemv::multiply(*_quantized, input.data(), output, post);
+		return;
+	}
+
+	// Every sample is gathered into a column buffer, and its result
+	// scattered into its output column
+	thread_local std::vector<float> sample;
+	thread_local std::vector<float> result;
+	sample.resize(static_cast<size_t>(input.get_rows()));
+	result.resize(static_cast<size_t>(rows));
+	for (int col = 0; col < batch; col++)
+	{
+		for (int row = 0; row < input.get_rows(); row++)
+		{
+			sample[row] = input.data()[(row * input.row_step()) +
+									   (col * input.col_step())];
+		}
+
+		gemv::multiply(*_quantized, sample.data(), result.data(), post);
+		for (int row = 0; row < rows; row++)
+		{
+			output[(row * batch) + col] = result[row];
+		}
+	}
+}
+
+// See documentation at header file
+uint64_t Dense::forward_flops(int batch) const
+{
+	// A multiply-add per (stored) weight, then the bias, then ReLU
+	// when fused
+	const uint64_t weights = (nullptr != _sparse) ?
+		static_cast<uint64_t>(_sparse->get_nonzeros()) :
+		static_cast<uint64_t>(_dims.rows) * _dims.cols;
+	const uint64_t per_output = (activation::relu == _activation_func) ?
+								2 : 1;
+	return ((2 * weights) + (per_output * _dims.rows)) * batch;
+}
+
+// See documentation at header file
+uint64_t Dense::forward_bytes(int batch) const
+{
+	uint64_t weight_size = sizeof(float);
+	if (nullptr != _sparse)
+	{
+		// A value and a column index per stored weight, and the rows
+		return ((sizeof(float) + sizeof(int32_t)) *
+				static_cast<uint64_t>(_sparse->get_nonzeros())) +
+			   (sizeof(int32_t) * (_dims.rows + 1)) +
+			   (sizeof(float) * _dims.rows) +
+			   (sizeof(float) * batch * (_dims.rows + _dims.cols));
+	}
+	if (nullptr != _quantized)
+	{
+		weight_size = sizeof(int8_t);
+	}
+	else if (nullptr != _half)
+	{
+		weight_size = sizeof(uint16_t);
+	}
+
+	return (weight_size * _dims.rows * _dims.cols) +
+		   (sizeof(float) * _dims.rows) +
+		   (sizeof(float) * batch * (_dims.rows + _dims.cols));
+}
+
+// See documentation at header file
+instrumentation::layer_counters Dense::get_counters() const
+{
+#if MLP_INSTRUMENTATION
+	return _counters.read();
+#else
+	return {};
+#endif
+}
+
+// See documentation at header file
+void Dense::reset_counters() const
+{
+#if MLP_INSTRUMENTATION
+	_counters.reset();
+#endif
 }
@@ -1,11 +1,44 @@
 #ifndef DENSE_H
 #define DENSE_H
 
+#include <memory>
+#include <mutex>
+
 #include "Activation.h"
+#include "Epilogue.h"
+#include "HalfMatrix.h"
+#include "Instrumentation.h"
+#include "QuantizedMatrix.h"
+#include "SparseMatrix.h"
+
+/**
+* Storage format of the weights used by the layer's product.
+*/
+enum class weight_format
+{
+	// Single-precision floating-point
+	FP32 = 0,
+	// Symmetric int8, one scale per output row, with the input
+	// quantized per sample (see QuantizedMatrix)
+	INT8,
+	// IEEE half precision, widened to float by the kernels
+	FP16,
+	// bfloat16, widened to float by the kernels
+	BF16,
+	// Only the non-zero weights, in compressed sparse rows, for
+	// pruned models (see SparseMatrix). A gathered weight costs several
+	// dense ones, so single samples only gain on heavily pruned layers
+	// (about a tenth of the weights kept), batches from about half
+	SPARSE
+};
 
 /**
  * @class Dense
- * @brief Represents a layer of a neural network
+ * @brief Represents a layer of a neural network.
+ *		  The layer is immutable once constructed, and its const
+ *		  members are safe to call concurrently: forward only writes
+ *		  the caller's output, and the product kernels keep their
+ *		  scratch buffers per thread.
  */
 class Dense
 {
@@ -13,13 +46,24 @@ public:
 
 	/**
 	* Constructs a layer.
-	* @param weights - The weights matrix.
+	* @param weights - The weights matrix. Owned FP32 weights are
+	*				   stored padded when their rows would not start
+	*				   cache line aligned, and FP32 weights are also
+	*				   kept column-major, for sparse samples (see
+	*				   gemv::multiply_sparse_input).
 	* @param bias - The bias matrix.
 	* @param activation_func - The activation to perform
+	* @param format - The format of the weights in the product. The
+	*				  weights are converted once, here, and only the
+	*				  converted copy is kept. The bias and activations
+	*				  are always floating-point.
+	* @throws std::length_error in case the bias is not a single
+	*		  column with the weights row count.
 	*/
 	Dense(Matrix weights, 
 		  Matrix bias, 
-		  activation::ActivationPfn activation_func);
+		  activation::ActivationPfn activation_func,
+		  weight_format format = weight_format::FP32);
 
 	// Explicitly defining behavior to prevent implicit behavior
 	Dense() = delete;
@@ -28,7 +72,8 @@ public:
 	~Dense() = default;
 
 	/**
-	* Gets the weights matrix
+	* Gets the weights matrix, widened back to floating-point for
+	* the reduced formats.
 	* @return The weights matrix.
 	*/
 	Matrix get_weights() const;
@@ -45,19 +90,135 @@ public:
 	*/
 	activation::ActivationPfn get_activation() const;
 
+	/**
+	* Gets the format of the weights in the product.
+	* @return The weight format.
+	*/
+	weight_format get_weight_format() const;
+
 	/**
 	* Executes the activation function with the given input matrix.
-	* @return The result matrix from the activation.
+	* Every column of the input is an independent sample, so a batch
+	* of N samples is computed with a single matrix product.
+	* @param input - The input, one sample per column.
+	* @throws std::length_error in case the input row count is not
+	*		  the weights column count.
+	* @return The result matrix from the activation, one column
+	*		  per sample.
 	*/
 	Matrix operator()(const Matrix& input) const;
 
+	/**
+	* Same as above, reading the input through a view (such as a
+	* slice of a larger buffer, or a transposed view) without copying.
+	* @param input - The input view, one sample per column.
+	* @throws std::length_error in case the input row count is not
+	*		  the weights column count.
+	* @return The result matrix from the activation, one column
+	*		  per sample.
+	*/
+	Matrix operator()(const MatrixView& input) const;
+
+	/**
+	* Computes the layer on raw buffers, in a single fused pass:
+	* the bias is added and ReLU applied to every output value as it
+	* leaves the product kernel's registers. Softmax, which needs
+	* the whole output of a sample, is then applied in place.
+	* The input size is the weights column count, the output size
+	* is the weights row count. Dimensions are not checked.
+	* @param input - The input, row-major (input size x batch),
+	*				 one sample per column.
+	* @param output - The caller-provided output buffer, row-major
+	*				  (output size x batch). May not overlap the input.
+	* @param batch - The number of samples.
+	*/
+	void forward(const float* input, float* output, int batch = 1) const;
+
+	/**
+	* Same as above, reading the input through a view, which may be
+	* strided or transposed. The batch is the view column count.
+	* Dimensions are not checked.
+	* @param input - The input view (input size x batch).
+	* @param output - The caller-provided output buffer, row-major
+	*				  (output size x batch). May not overlap the input.
+	*/
+	void forward(const MatrixView& input, float* output) const;
+
+	/**
+	* Gets the work counted by the forward calls of every thread, all 0
+	* unless built with MLP_INSTRUMENTATION.
+	* @return The layer counters.
+	*/
+	instrumentation::layer_counters get_counters() const;
+
+	/**
+	* Sets the counted work back to 0.
+	*/
+	void reset_counters() const;
+
 private:
 	// Activation function
 	const activation::ActivationPfn _activation_func;
-	// Weights matrix
+	// Format of the weights in the product
+	const weight_format _format;
+	// Dimensions of the weights
+	const matrix_dims _dims;
+	// Quantized weights, for the INT8 format only
+	const std::unique_ptr<const QuantizedMatrix> _quantized;
+	// 16-bit weights, for the FP16 and BF16 formats only
+	const std::unique_ptr<const HalfMatrix> _half;
+	// Non-zero weights, for the SPARSE format only
+	const std::unique_ptr<const SparseMatrix> _sparse;
+	// Weights matrix, for the FP32 format only
 	const Matrix _weights;
+	// Column-major copy of the weights, so single samples sum only the
+	// columns of their non-zero values. Built by the first FP32 single
+	// sample (see columns), so loading and batch-only layers do not
+	// read every weight or hold a second copy of them.
+	mutable Matrix _columns;
+	mutable std::once_flag _columns_built;
 	// Bias matrix
 	const Matrix _bias;
+#if MLP_INSTRUMENTATION
+	// Work counted by the forward calls
+	mutable instrumentation::Counters _counters;
+#endif
+
+	/**
+	* Gets the column-major copy of the FP32 weights, building it on
+	* the first call. Safe to call concurrently.
+	*/
+	const Matrix& columns() const;
+
+	/**
+	* Computes the product of the input into the output in the weight
+	* format, with the epilogue fused.
+	*/
+	void multiply(const MatrixView& input, float* output,
+				  const epilogue& post) const;
+
+	/**
+	* Computes the INT8 product of the input into the output, sample
+	* by sample, with the bias and ReLU fused.
+	*/
+	void forward_int8(const MatrixView& input, float* output,
+					  const epilogue& post) const;
+
+	/**
+	* Applies an activation other than ReLU to the product output,
+	* in place.
+	*/
+	void apply_activation(float* output, int batch) const;
+
+	/**
+	* Gets the floating-point operations of a forward call.
+	*/
+	uint64_t forward_flops(int batch) const;
+
+	/**
+	* Gets the bytes read or written by a forward call.
+	*/
+	uint64_t forward_bytes(int batch) const;
 };
 
 #endif //DENSE_H
@@ -0,0 +1,21 @@
+#ifndef EPILOGUE_H
+#define EPILOGUE_H
+
+/**
+ * @struct epilogue
+ * @brief Operations fused into the store of a product kernel, applied
+ *		  to every result value while it is still in registers.
+ * @var bias - Value added to every result row (one value per row),
+ *			   nullptr for none.
+ * @var relu - Whether negative results are clamped to 0, after the bias.
+ */
+typedef struct epilogue
+{
+	const float* bias;
+	bool relu;
+} epilogue;
+
+// Epilogue storing the plain product
+constexpr epilogue no_epilogue = {nullptr, false};
+
+#endif //EPILOGUE_H
@@ -0,0 +1,666 @@
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "Gemm.h"
+#include "Gemv.h"
+#include "WorkStealingPool.h"
+
+// Exception descriptions
+#define INVALID_THREADS_EX ("Invalid thread count")
+
+#if SIMD_X86
+#include <immintrin.h>
+#endif
+
+// Micro-kernel prototype, see micro_kernel_scalar
+using MicroKernelPfn = void (*)(int kc,
+								const float* packed_lhs,
+								const float* packed_rhs,
+								float* result, int result_stride,
+								int mr, int nr, bool accumulate,
+								const epilogue& post);
+
+/**
+* Packs an mc x kc block of lhs into MR-row micro-panels.
+* Each micro-panel stores, for every k, MR consecutive values of
+* a single lhs column, so the micro-kernel reads it sequentially.
+* Rows beyond mc are padded with zeros.
+* @param row_step - Distance in floats between two lhs rows.
+* @param col_step - Distance in floats between two lhs columns
+*					(1 unless lhs is read transposed).
+*/
+static void pack_lhs(int mc, int kc,
+					 const float* lhs, int row_step, int col_step,
+					 float* packed)
+{
+	for (int panel_row = 0; panel_row < mc; panel_row += gemm::MR)
+	{
+		const int panel_rows = std::min(gemm::MR, mc - panel_row);
+		for (int k_index = 0; k_index < kc; k_index++)
+		{
+			for (int row = 0; row < gemm::MR; row++)
+			{
+				*packed++ = (row < panel_rows) ?
+					lhs[((panel_row + row) * row_step) +
+						(k_index * col_step)] :
+					0.0F;
+			}
+		}
+	}
+}
+
+/**
+* Packs a kc x nc block of rhs into NR-column micro-panels.
+* Each micro-panel stores, for every k, NR consecutive values of
+* a single rhs row. Columns beyond nc are padded with zeros.
+* @param row_step - Distance in floats between two rhs rows.
+* @param col_step - Distance in floats between two rhs columns
+*					(1 unless rhs is read transposed).
+*/
+static void pack_rhs(int kc, int nc,
+					 const float* rhs, int row_step, int col_step,
+					 float* packed)
+{
+	for (int panel_col = 0; panel_col < nc; panel_col += gemm::NR)
+	{
+		const int panel_cols = std::min(gemm::NR, nc - panel_col);
+		for (int k_index = 0; k_index < kc; k_index++)
+		{
+			const float* rhs_row =
+				rhs + (k_index * row_step) + (panel_col * col_step);
+			if (1 == col_step)
+			{
+				// Plain rows, kept as a separate loop so it vectorizes
+				for (int col = 0; col < gemm::NR; col++)
+				{
+					*packed++ = (col < panel_cols) ? rhs_row[col] : 0.0F;
+				}
+				continue;
+			}
+
+			for (int col = 0; col < gemm::NR; col++)
+			{
+				*packed++ = (col < panel_cols) ?
+					rhs_row[col * col_step] : 0.0F;
+			}
+		}
+	}
+}
+
+/**
+* Writes a computed MR x NR tile back to the result.
+* Only the valid mr x nr corner is written.
+* @param accumulate - Whether to add to the existing result values
+*					  (true for every depth block but the first).
+* @param post - The epilogue, with the bias of the tile's first row.
+*				Only given for the last depth block.
+*/
+static void store_tile(const float (&tile)[gemm::MR][gemm::NR],
+					   float* result, int result_stride,
+					   int mr, int nr, bool accumulate,
+					   const epilogue& post)
+{
+	for (int row = 0; row < mr; row++)
+	{
+		float* result_row = result + (row * result_stride);
+		const float bias = (nullptr != post.bias) ? post.bias[row] : 0.0F;
+		for (int col = 0; col < nr; col++)
+		{
+			float value = accumulate ?
+				result_row[col] + tile[row][col] : tile[row][col];
+			value += bias;
+			result_row[col] = (post.relu && (value < 0)) ? 0.0F : value;
+		}
+	}
+}
+
+/**
+* Computes an MR x NR tile of the result from packed micro-panels,
+* keeping the whole tile in an accumulator the compiler can hold
+* in registers. Portable kernel.
+*/
+static void micro_kernel_scalar(int kc,
+								const float* packed_lhs,
+								const float* packed_rhs,
+								float* result, int result_stride,
+								int mr, int nr, bool accumulate,
+								const epilogue& post)
+{
+	float tile[gemm::MR][gemm::NR] = {};
+
+	for (int k_index = 0; k_index < kc; k_index++)
+	{
+		for (int row = 0; row < gemm::MR; row++)
+		{
+			const float lhs_value = packed_lhs[row];
+			for (int col = 0; col < gemm::NR; col++)
+			{
+				tile[row][col] += lhs_value * packed_rhs[col];
+			}
+		}
+
+		packed_lhs += gemm::MR;
+		packed_rhs += gemm::NR;
+	}
+
+	store_tile(tile, result, result_stride, mr, nr, accumulate, post);
+}
+
+#if SIMD_X86
+
+/**
+* AVX2/FMA micro-kernel, the tile is held in MR x 2 registers.
+*/
+SIMD_TARGET("avx2,fma")
+static void micro_kernel_avx2(int kc,
+							  const float* packed_lhs,
+							  const float* packed_rhs,
+							  float* result, int result_stride,
+							  int mr, int nr, bool accumulate,
+							  const epilogue& post)
+{
+	constexpr int lanes = 8;
+	__m256 low[gemm::MR];
+	__m256 high[gemm::MR];
+	for (int row = 0; row < gemm::MR; row++)
+	{
+		low[row] = _mm256_setzero_ps();
+		high[row] = _mm256_setzero_ps();
+	}
+
+	for (int k_index = 0; k_index < kc; k_index++)
+	{
+		const __m256 rhs_low = _mm256_loadu_ps(packed_rhs);
+		const __m256 rhs_high = _mm256_loadu_ps(packed_rhs + lanes);
+		for (int row = 0; row < gemm::MR; row++)
+		{
+			const __m256 lhs_value = _mm256_broadcast_ss(packed_lhs + row);
+			low[row] = _mm256_fmadd_ps(lhs_value, rhs_low, low[row]);
+			high[row] = _mm256_fmadd_ps(lhs_value, rhs_high, high[row]);
+		}
+
+		packed_lhs += gemm::MR;
+		packed_rhs += gemm::NR;
+	}
+
+	if ((gemm::MR == mr) && (gemm::NR == nr))
+	{
+		for (int row = 0; row < gemm::MR; row++)
+		{
+			float* result_row = result + (row * result_stride);
+			if (accumulate)
+			{
+				low[row] = _mm256_add_ps(low[row],
+										 _mm256_loadu_ps(result_row));
+				high[row] = _mm256_add_ps(high[row],
+										  _mm256_loadu_ps(result_row + lanes));
+			}
+			if (nullptr != post.bias)
+			{
+				const __m256 bias = _mm256_broadcast_ss(post.bias + row);
+				low[row] = _mm256_add_ps(low[row], bias);
+				high[row] = _mm256_add_ps(high[row], bias);
+			}
+			if (post.relu)
+			{
+				low[row] = _mm256_max_ps(low[row], _mm256_setzero_ps());
+				high[row] = _mm256_max_ps(high[row], _mm256_setzero_ps());
+			}
+			_mm256_storeu_ps(result_row, low[row]);
+			_mm256_storeu_ps(result_row + lanes, high[row]);
+		}
+		return;
+	}
+
+	float tile[gemm::MR][gemm::NR];
+	for (int row = 0; row < gemm::MR; row++)
+	{
+		_mm256_storeu_ps(tile[row], low[row]);
+		_mm256_storeu_ps(tile[row] + lanes, high[row]);
+	}
+	store_tile(tile, result, result_stride, mr, nr, accumulate, post);
+}
+
+/**
+* AVX-512 micro-kernel, every row of the tile is a single register,
+* partial tiles are stored through a column mask.
+*/
+SIMD_AVX512_BEGIN
+SIMD_TARGET("avx512f,avx2,fma")
+static void micro_kernel_avx512(int kc,
+								const float* packed_lhs,
+								const float* packed_rhs,
+								float* result, int result_stride,
+								int mr, int nr, bool accumulate,
+								const epilogue& post)
+{
+	__m512 tile[gemm::MR];
+	for (int row = 0; row < gemm::MR; row++)
+	{
+		tile[row] = _mm512_setzero_ps();
+	}
+
+	for (int k_index = 0; k_index < kc; k_index++)
+	{
+		const __m512 rhs_values = _mm512_loadu_ps(packed_rhs);
+		for (int row = 0; row < gemm::MR; row++)
+		{
+			tile[row] = _mm512_fmadd_ps(
+				_mm512_set1_ps(packed_lhs[row]), rhs_values, tile[row]);
+		}
+
+		packed_lhs += gemm::MR;
+		packed_rhs += gemm::NR;
+	}
+
+	const __mmask16 mask = static_cast<__mmask16>((1U << nr) - 1U);
+	for (int row = 0; row < mr; row++)
+	{
+		float* result_row = result + (row * result_stride);
+		if (accumulate)
+		{
+			tile[row] = _mm512_add_ps(
+				tile[row], _mm512_maskz_loadu_ps(mask, result_row));
+		}
+		if (nullptr != post.bias)
+		{
+			tile[row] = _mm512_add_ps(tile[row], _mm512_set1_ps(post.bias[row]));
+		}
+		if (post.relu)
+		{
+			tile[row] = _mm512_max_ps(tile[row], _mm512_setzero_ps());
+		}
+		_mm512_mask_storeu_ps(result_row, mask, tile[row]);
+	}
+}
+SIMD_AVX512_END
+
+#endif
+
+/**
+* Selects the micro-kernel for the given instruction set.
+*/
+static MicroKernelPfn select_micro_kernel(simd::isa set)
+{
+	switch (set)
+	{
+#if SIMD_X86
+	case simd::isa::AVX512:
+		return micro_kernel_avx512;
+	case simd::isa::AVX2:
+		return micro_kernel_avx2;
+#endif
+	default:
+		return micro_kernel_scalar;
+	}
+}
+
+/**
+* Rounds value up to the nearest multiple of the given step.
+*/
+static int round_up(int value, int step)
+{
+	return ((value + step - 1) / step) * step;
+}
+
+/**
+* Creates the pool for the given thread count.
+* @return The pool, nullptr for a single thread.
+*/
+static std::shared_ptr<WorkStealingPool> make_pool(int threads)
+{
+	return (1 < threads) ?
+		std::make_shared<WorkStealingPool>(threads) : nullptr;
+}
+
+// Guards the parallel products pool
+static std::mutex pool_mutex;
+
+/**
+* Gets the pool running parallel products, created for the hardware
+* thread count on first use (see gemm::set_thread_count).
+* Must be called with pool_mutex held.
+*/
+static std::shared_ptr<WorkStealingPool>& shared_pool()
+{
+	static std::shared_ptr<WorkStealingPool> pool = make_pool(
+		std::max(1, static_cast<int>(std::thread::hardware_concurrency())));
+	return pool;
+}
+
+/**
+* Gets the pool to compute a product with.
+* @return The shared pool, nullptr for products below the parallel
+*		  threshold or when single-threaded.
+*/
+static std::shared_ptr<WorkStealingPool> parallel_pool(int rows, int cols,
+													   int depth)
+{
+	if (static_cast<long long>(rows) * cols * depth <
+		gemm::PARALLEL_THRESHOLD)
+	{
+		return nullptr;
+	}
+
+	std::lock_guard<std::mutex> lock(pool_mutex);
+	return shared_pool();
+}
+
+/**
+* Calculates result = lhs * rhs, with rhs addressed by its row and
+* column steps, so it may be read transposed. Blocks of lhs are packed
+* by the given callable, so lhs may be stored in any format.
+* See gemm::multiply for the other parameters.
+* @param pack_lhs_block - Called as (row_block, depth_block, mc, kc,
+*						   packed) to pack the mc x kc block of lhs at
+*						   (row_block, depth_block), see pack_lhs.
+*/
+template <typename LhsPacker>
+static void multiply_blocked(simd::isa set, int rows, int cols, int depth,
+							 LhsPacker&& pack_lhs_block,
+							 const float* rhs,
+							 int rhs_row_step, int rhs_col_step,
+							 float* result, int result_stride,
+							 const epilogue& post)
+{
+	using gemm::MR;
+	using gemm::NR;
+	using gemm::MC;
+	using gemm::KC;
+	using gemm::NC;
+
+	// Packing buffers are kept per thread, so steady-state products
+	// do not touch the allocator
+	thread_local std::vector<float> packed_rhs;
+	const MicroKernelPfn micro_kernel = select_micro_kernel(set);
+	const std::shared_ptr<WorkStealingPool> pool =
+		parallel_pool(rows, cols, depth);
+
+	const auto lhs_size = static_cast<size_t>(
+		round_up(std::min(rows, MC), MR) * std::min(depth, KC));
+	const auto rhs_size = static_cast<size_t>(
+		round_up(std::min(cols, NC), NR) * std::min(depth, KC));
+	if (packed_rhs.size() < rhs_size)
+	{
+		packed_rhs.resize(rhs_size);
+	}
+
+	for (int col_block = 0; col_block < cols; col_block += NC)
+	{
+		const int nc = std::min(NC, cols - col_block);
+
+		for (int depth_block = 0; depth_block < depth; depth_block += KC)
+		{
+			const int kc = std::min(KC, depth - depth_block);
+			const bool last_depth_block = (depth_block + kc == depth);
+			pack_rhs(kc, nc,
+					 rhs + (depth_block * rhs_row_step) +
+						 (col_block * rhs_col_step),
+					 rhs_row_step, rhs_col_step, packed_rhs.data());
+
+			// Computes the tile of a row block over the panel columns
+			// [first_col, last_col) of the packed rhs, on any thread:
+			// the rhs panels (of this thread) are shared, the lhs is
+			// packed per thread
+			const float* rhs_panels = packed_rhs.data();
+			const auto compute_tile =
+				[&](int row_block, int first_col, int last_col)
+			{
+				thread_local std::vector<float> packed_lhs;
+				if (packed_lhs.size() < lhs_size)
+				{
+					packed_lhs.resize(lhs_size);
+				}
+
+				const int mc = std::min(MC, rows - row_block);
+				pack_lhs_block(row_block, depth_block, mc, kc,
+							   packed_lhs.data());
+
+				for (int panel_col = first_col;
+					 panel_col < last_col;
+					 panel_col += NR)
+				{
+					for (int panel_row = 0;
+						 panel_row < mc;
+						 panel_row += MR)
+					{
+						// The epilogue is applied once the sums are final
+						const int first_row = row_block + panel_row;
+						const epilogue tile_post = last_depth_block ?
+							epilogue{(nullptr != post.bias) ?
+										 post.bias + first_row : nullptr,
+									 post.relu} :
+							no_epilogue;
+						micro_kernel(
+							kc,
+							packed_lhs.data() + (panel_row * kc),
+							rhs_panels + (panel_col * kc),
+							result + (first_row * result_stride) +
+								col_block + panel_col,
+							result_stride,
+							std::min(MR, mc - panel_row),
+							std::min(NR, nc - panel_col),
+							0 != depth_block,
+							tile_post);
+					}
+				}
+			};
+
+			if (nullptr == pool)
+			{
+				for (int row_block = 0; row_block < rows; row_block += MC)
+				{
+					compute_tile(row_block, 0, nc);
+				}
+				continue;
+			}
+
+			// Splitting the columns too, so there are enough tiles for
+			// every thread even with few row blocks
+			const int row_blocks = (rows + MC - 1) / MC;
+			const int wanted_splits =
+				((gemm::TILES_PER_THREAD * pool->get_threads()) +
+				 row_blocks - 1) / row_blocks;
+			const int split_cols = round_up(
+				(nc + wanted_splits - 1) / wanted_splits, NR);
+			const int splits = (nc + split_cols - 1) / split_cols;
+			pool->run(row_blocks * splits, [&](int tile)
+			{
+				const int first_col = (tile % splits) * split_cols;
+				compute_tile((tile / splits) * MC, first_col,
+							 std::min(nc, first_col + split_cols));
+			});
+		}
+	}
+}
+
+/**
+* Calculates result = lhs * rhs, with both operands addressed by
+* their row and column steps, so either may be read transposed.
+* See gemm::multiply for the other parameters.
+*/
+static void multiply_strided(simd::isa set, int rows, int cols, int depth,
+							 const float* lhs,
+							 int lhs_row_step, int lhs_col_step,
+							 const float* rhs,
+							 int rhs_row_step, int rhs_col_step,
+							 float* result, int result_stride,
+							 const epilogue& post)
+{
+	multiply_blocked(
+		set, rows, cols, depth,
+		[=](int row_block, int depth_block, int mc, int kc, float* packed)
+		{
+			pack_lhs(mc, kc,
+					 lhs + (row_block * lhs_row_step) +
+						 (depth_block * lhs_col_step),
+					 lhs_row_step, lhs_col_step, packed);
+		},
+		rhs, rhs_row_step, rhs_col_step, result, result_stride, post);
+}
+
+// See documentation at header file
+void gemm::multiply(int rows, int cols, int depth,
+					const float* lhs, int lhs_stride,
+					const float* rhs, int rhs_stride,
+					float* result, int result_stride,
+					const epilogue& post)
+{
+	multiply(simd::active_isa(), rows, cols, depth,
+			 lhs, lhs_stride, rhs, rhs_stride, result, result_stride, post);
+}
+
+// See documentation at header file
+void gemm::multiply(simd::isa set, int rows, int cols, int depth,
+					const float* lhs, int lhs_stride,
+					const float* rhs, int rhs_stride,
+					float* result, int result_stride,
+					const epilogue& post)
+{
+	multiply_strided(set, rows, cols, depth,
+					 lhs, lhs_stride, 1, rhs, rhs_stride, 1,
+					 result, result_stride, post);
+}
+
+// See documentation at header file
+void gemm::multiply(const MatrixView& lhs, const MatrixView& rhs,
+					float* result, int result_stride,
+					const epilogue& post)
+{
+	multiply_strided(simd::active_isa(),
+					 lhs.get_rows(), rhs.get_cols(), lhs.get_cols(),
+					 lhs.data(), lhs.row_step(), lhs.col_step(),
+					 rhs.data(), rhs.row_step(), rhs.col_step(),
+					 result, result_stride, post);
+}
+
+// See documentation at header file
+void gemm::multiply(const HalfMatrix& lhs, const MatrixView& rhs,
+					float* result, int result_stride,
+					const epilogue& post)
+{
+	multiply_blocked(
+		simd::active_isa(), lhs.get_rows(), rhs.get_cols(), lhs.get_cols(),
+		[&](int row_block, int depth_block, int mc, int kc, float* packed)
+		{
+			// Every lhs block is widened once, by the thread packing
+			// it, then packed as a float block
+			thread_local std::vector<float> widened;
+			if (widened.size() < static_cast<size_t>(mc * kc))
+			{
+				widened.resize(static_cast<size_t>(mc * kc));
+			}
+
+			for (int row = 0; row < mc; row++)
+			{
+				HalfMatrix::widen(
+					lhs.data() + ((row_block + row) * lhs.get_cols()) +
+						depth_block,
+					kc, lhs.get_format(), widened.data() + (row * kc));
+			}
+			pack_lhs(mc, kc, widened.data(), kc, 1, packed);
+		},
+		rhs.data(), rhs.row_step(), rhs.col_step(),
+		result, result_stride, post);
+}
+
+// See documentation at header file
+void gemm::multiply(const SparseMatrix& lhs, const MatrixView& rhs,
+					float* result, int result_stride,
+					const epilogue& post)
+{
+	multiply(simd::active_isa(), lhs, rhs, result, result_stride, post);
+}
+
+// See documentation at header file
+void gemm::multiply(simd::isa set, const SparseMatrix& lhs,
+					const MatrixView& rhs, float* result, int result_stride,
+					const epilogue& post)
+{
+	const int depth = rhs.get_rows();
+	const int cols = rhs.get_cols();
+
+	// The kernels read rhs rows as vectors, a transposed (or otherwise
+	// strided) rhs is packed once, into a per-thread buffer
+	thread_local std::vector<float> packed_rhs;
+	const float* rhs_data = rhs.data();
+	int rhs_stride = rhs.row_step();
+	if (1 != rhs.col_step())
+	{
+		packed_rhs.resize(static_cast<size_t>(depth) * cols);
+		for (int row = 0; row < depth; row++)
+		{
+			for (int col = 0; col < cols; col++)
+			{
+				packed_rhs[(row * cols) + col] =
+					rhs_data[(row * rhs.row_step()) + (col * rhs.col_step())];
+			}
+		}
+		rhs_data = packed_rhs.data();
+		rhs_stride = cols;
+	}
+
+	const int32_t* starts = lhs.row_starts();
+	const auto compute_rows = [&](int first_row, int last_row)
+	{
+		for (int row = first_row; row < last_row; row++)
+		{
+			float* result_row = result + (row * result_stride);
+			gemv::sum_rows(set, starts[row + 1] - starts[row],
+						   lhs.values() + starts[row],
+						   lhs.col_indices() + starts[row],
+						   rhs_data, rhs_stride, cols, result_row);
+
+			const float bias = (nullptr != post.bias) ? post.bias[row] : 0.0F;
+			for (int col = 0; col < cols; col++)
+			{
+				const float value = result_row[col] + bias;
+				result_row[col] = (post.relu && (value < 0)) ? 0.0F : value;
+			}
+		}
+	};
+
+	// The work is a multiply-add per stored cell and result column
+	const std::shared_ptr<WorkStealingPool> pool =
+		parallel_pool(lhs.get_nonzeros(), cols, 1);
+	if (nullptr == pool)
+	{
+		compute_rows(0, lhs.get_rows());
+		return;
+	}
+
+	const int blocks = (lhs.get_rows() + gemm::MR - 1) / gemm::MR;
+	pool->run(blocks, [&](int block)
+	{
+		compute_rows(block * gemm::MR,
+					 std::min(lhs.get_rows(), (block + 1) * gemm::MR));
+	});
+}
+
+// See documentation at header file
+void gemm::set_thread_count(int threads)
+{
+	if (0 >= threads)
+	{
+		throw std::length_error(INVALID_THREADS_EX);
+	}
+
+	std::lock_guard<std::mutex> lock(pool_mutex);
+	if (threads != ((nullptr != shared_pool()) ?
+					shared_pool()->get_threads() : 1))
+	{
+		// Products running on the previous pool keep it alive
+		shared_pool() = make_pool(threads);
+	}
+}
+
+// See documentation at header file
+int gemm::get_thread_count()
+{
+	std::lock_guard<std::mutex> lock(pool_mutex);
+	return (nullptr != shared_pool()) ? shared_pool()->get_threads() : 1;
+}
@@ -0,0 +1,143 @@
+#ifndef GEMM_H
+#define GEMM_H
+
+#include "Epilogue.h"
+#include "HalfMatrix.h"
+#include "MatrixView.h"
+#include "Simd.h"
+#include "SparseMatrix.h"
+
+/**
+* General matrix-matrix multiplication (GEMM) engine.
+* All matrices are row-major, addressed by a base pointer and a
+* leading dimension (the distance, in floats, between two rows).
+*
+* The product is computed over packed panels of both operands,
+* blocked for the L1/L2 caches, with a register-tiled micro-kernel
+* computing MR x NR blocks of the result at a time. The micro-kernel
+* is selected at runtime for the CPU (see simd::active_isa).
+*
+* Large products are split into result tiles (row blocks, and column
+* ranges when there are few of them), computed in parallel on a
+* work-stealing pool for every depth block.
+*/
+namespace gemm
+{
+	// Micro-kernel register tile height (rows of the result)
+	constexpr int MR = 6;
+	// Micro-kernel register tile width (columns of the result)
+	constexpr int NR = 16;
+	// Rows of lhs packed per L2 block (multiple of MR)
+	constexpr int MC = 120;
+	// Shared dimension packed per L1 block
+	constexpr int KC = 256;
+	// Columns of rhs packed per L3 block (multiple of NR)
+	constexpr int NC = 2048;
+	// Products of at least this many multiply-adds (rows * cols * depth)
+	// are split over the threads, smaller ones stay on the caller
+	constexpr long long PARALLEL_THRESHOLD = 1LL << 24;
+	// Result tiles scheduled per thread, for load balancing
+	constexpr int TILES_PER_THREAD = 4;
+
+	/**
+	* Calculates result = lhs * rhs.
+	* The result is overwritten, it may not overlap the operands.
+	* @param rows - Row count of lhs and of the result.
+	* @param cols - Column count of rhs and of the result.
+	* @param depth - Column count of lhs, row count of rhs.
+	* @param lhs - The left-hand side matrix (rows x depth).
+	* @param lhs_stride - Leading dimension of lhs.
+	* @param rhs - The right-hand side matrix (depth x cols).
+	* @param rhs_stride - Leading dimension of rhs.
+	* @param result - The result matrix (rows x cols).
+	* @param result_stride - Leading dimension of the result.
+	* @param post - Bias (one value per result row) and activation
+	*				fused into the final store of every tile.
+	*/
+	void multiply(int rows, int cols, int depth,
+				  const float* lhs, int lhs_stride,
+				  const float* rhs, int rhs_stride,
+				  float* result, int result_stride,
+				  const epilogue& post = no_epilogue);
+
+	/**
+	* Same as above, with an explicitly selected micro-kernel.
+	* The instruction set must be supported by the CPU.
+	* @param set - The instruction set of the micro-kernel to use.
+	*/
+	void multiply(simd::isa set, int rows, int cols, int depth,
+				  const float* lhs, int lhs_stride,
+				  const float* rhs, int rhs_stride,
+				  float* result, int result_stride,
+				  const epilogue& post = no_epilogue);
+
+	/**
+	* Calculates result = lhs * rhs over views, either of which may be
+	* transposed; transposed operands are read in place while packing.
+	* Dimensions are not checked, the lhs column count must be the
+	* rhs row count.
+	* @param lhs - The left-hand side view (rows x depth).
+	* @param rhs - The right-hand side view (depth x cols).
+	* @param result - The result matrix (rows x cols).
+	* @param result_stride - Leading dimension of the result.
+	* @param post - Bias and activation fused into the final store.
+	*/
+	void multiply(const MatrixView& lhs, const MatrixView& rhs,
+				  float* result, int result_stride,
+				  const epilogue& post = no_epilogue);
+
+	/**
+	* Calculates result = lhs * rhs with a 16-bit lhs, widened to
+	* floats block by block as it is packed, so the float copy of lhs
+	* never exceeds an MC x KC block.
+	* @param lhs - The left-hand side matrix (rows x depth).
+	* @param rhs - The right-hand side view (depth x cols).
+	* @param result - The result matrix (rows x cols).
+	* @param result_stride - Leading dimension of the result.
+	* @param post - Bias and activation fused into the final store.
+	*/
+	void multiply(const HalfMatrix& lhs, const MatrixView& rhs,
+				  float* result, int result_stride,
+				  const epilogue& post = no_epilogue);
+
+	/**
+	* Calculates result = lhs * rhs with a sparse lhs, in time
+	* proportional to its stored cells: every result row sums the rhs
+	* rows selected by the row's cells, a register block of result
+	* columns at a time. Products above the PARALLEL_THRESHOLD (in
+	* stored cells x cols) are split by rows across threads.
+	* @param lhs - The sparse left-hand side matrix (rows x depth).
+	* @param rhs - The right-hand side view (depth x cols).
+	* @param result - The result matrix (rows x cols).
+	* @param result_stride - Leading dimension of the result.
+	* @param post - Bias and activation fused into the final store.
+	*/
+	void multiply(const SparseMatrix& lhs, const MatrixView& rhs,
+				  float* result, int result_stride,
+				  const epilogue& post = no_epilogue);
+
+	/**
+	* Same as above, with an explicitly selected kernel.
+	* The instruction set must be supported by the CPU.
+	* @param set - The instruction set of the kernel to use.
+	*/
+	void multiply(simd::isa set, const SparseMatrix& lhs,
+				  const MatrixView& rhs, float* result, int result_stride,
+				  const epilogue& post = no_epilogue);
+
+	/**
+	* Sets the number of threads computing products above the
+	* PARALLEL_THRESHOLD, the calling thread included. Defaults to
+	* the hardware thread count.
+	* @param threads - The thread count, 1 for single-threaded products.
+	* @throws std::length_error in case threads is not positive.
+	*/
+	void set_thread_count(int threads);
+
+	/**
+	* Gets the number of threads computing large products.
+	*/
+	int get_thread_count();
+}
+
+#endif //GEMM_H
@@ -0,0 +1,1246 @@
+#include <algorithm>
+#include <vector>
+
+#include "Gemv.h"
+#include "SimdHelpers.h"
+
+/**
+* Applies the epilogue to the finished sum of a result row.
+*/
+static inline float finish_row(float sum, int row, const epilogue& post)
+{
+	if (nullptr != post.bias)
+	{
+		sum += post.bias[row];
+	}
+
+	return (post.relu && (sum < 0)) ? 0.0F : sum;
+}
+
+/**
+* Portable kernel, ROW_BLOCK independent scalar accumulators.
+*/
+static void multiply_scalar(int rows, int cols,
+							const float* matrix, int stride,
+							const float* vector, float* result,
+							const epilogue& post)
+{
+	int row = 0;
+	for (; row + gemv::ROW_BLOCK <= rows; row += gemv::ROW_BLOCK)
+	{
+		float sums[gemv::ROW_BLOCK] = {};
+		for (int col = 0; col < cols; col++)
+		{
+			for (int block_row = 0; block_row < gemv::ROW_BLOCK; block_row++)
+			{
+				sums[block_row] +=
+					matrix[((row + block_row) * stride) + col] * vector[col];
+			}
+		}
+
+		for (int block_row = 0; block_row < gemv::ROW_BLOCK; block_row++)
+		{
+			result[row + block_row] =
+				finish_row(sums[block_row], row + block_row, post);
+		}
+	}
+
+	for (; row < rows; row++)
+	{
+		float sum = 0;
+		for (int col = 0; col < cols; col++)
+		{
+			sum += matrix[(row * stride) + col] * vector[col];
+		}
+		result[row] = finish_row(sum, row, post);
+	}
+}
+
+/**
+* Kernel for a transposed matrix, stored as cols x rows, so every
+* column of the matrix is a contiguous stored row. Accumulates the
+* scaled stored rows into the result, which vectorizes without
+* horizontal sums.
+*/
+static void multiply_transposed(int rows, int cols,
+								const float* matrix, int stride,
+								const float* vector, float* result,
+								const epilogue& post)
+{
+	for (int row = 0; row < rows; row++)
+	{
+		result[row] = 0;
+	}
+
+	for (int col = 0; col < cols; col++)
+	{
+		const float* stored_row = matrix + (col * stride);
+		const float vector_value = vector[col];
+		for (int row = 0; row < rows; row++)
+		{
+			result[row] += stored_row[row] * vector_value;
+		}
+	}
+
+	for (int row = 0; row < rows; row++)
+	{
+		result[row] = finish_row(result[row], row, post);
+	}
+}
+
+/**
+* Portable kernel of gemv::sum_rows, adding every selected row scaled
+* into the result.
+*/
+static void sum_rows_scalar(int count, const float* values,
+							const int32_t* indices,
+							const float* matrix, int stride, int cols,
+							float* result)
+{
+	std::fill(result, result + cols, 0.0F);
+	for (int index = 0; index < count; index++)
+	{
+		const float value = values[index];
+		const float* matrix_row = matrix + (indices[index] * stride);
+		for (int col = 0; col < cols; col++)
+		{
+			result[col] += value * matrix_row[col];
+		}
+	}
+}
+
+/**
+* Portable kernel of gemv::compact.
+*/
+static int compact_scalar(const float* vector, int size, int32_t* indices,
+						  float* values)
+{
+	int count = 0;
+	for (int index = 0; index < size; index++)
+	{
+		if (0.0F != vector[index])
+		{
+			indices[count] = index;
+			values[count] = vector[index];
+			count++;
+		}
+	}
+
+	return count;
+}
+
+/**
+* Portable int8 kernel, one int32 accumulator per row. The quantized
+* rows and vector are zero padded, so whole strides are summed.
+*/
+static void multiply_int8_scalar(const QuantizedMatrix& matrix,
+								 const int8_t* vector, float vector_scale,
+								 float* result, const epilogue& post)
+{
+	const int stride = matrix.get_stride();
+	for (int row = 0; row < matrix.get_rows(); row++)
+	{
+		const int8_t* matrix_row = matrix.data() + (row * stride);
+		int32_t sum = 0;
+		for (int col = 0; col < stride; col++)
+		{
+			sum += static_cast<int32_t>(matrix_row[col]) * vector[col];
+		}
+		result[row] = finish_row(
+			sum * matrix.scales()[row] * vector_scale, row, post);
+	}
+}
+
+/**
+* Portable kernel for 16-bit matrices, widening every value.
+*/
+static void multiply_half_scalar(const HalfMatrix& matrix,
+								 const float* vector, float* result,
+								 const epilogue& post)
+{
+	const int cols = matrix.get_cols();
+	for (int row = 0; row < matrix.get_rows(); row++)
+	{
+		const uint16_t* matrix_row = matrix.data() + (row * cols);
+		float sum = 0;
+		for (int col = 0; col < cols; col++)
+		{
+			sum += HalfMatrix::widen(matrix_row[col], matrix.get_format()) *
+				   vector[col];
+		}
+		result[row] = finish_row(sum, row, post);
+	}
+}
+
+/**
+* Portable sparse kernel, a dot product of every row's stored values
+* with the vector values at their columns.
+*/
+static void multiply_sparse_scalar(const SparseMatrix& matrix,
+								   const float* vector, float* result,
+								   const epilogue& post)
+{
+	const int32_t* starts = matrix.row_starts();
+	const int32_t* columns = matrix.col_indices();
+	const float* values = matrix.values();
+	for (int row = 0; row < matrix.get_rows(); row++)
+	{
+		float sum = 0;
+		for (int32_t index = starts[row]; index < starts[row + 1]; index++)
+		{
+			sum += values[index] * vector[columns[index]];
+		}
+		result[row] = finish_row(sum, row, post);
+	}
+}
+
+#if SIMD_X86
+
+/**
+* Sums the 16 lanes of an AVX-512 register.
+*/
+SIMD_AVX512_BEGIN
+SIMD_TARGET("avx512f,avx2,fma")
+static float horizontal_sum_avx512(__m512 value)
+{
+	// Folding the upper 256 bits onto the lower ones
+	const __m512 folded = _mm512_add_ps(
+		value, _mm512_shuffle_f32x4(value, value, 0x4E));
+	return horizontal_sum_avx2(_mm512_castps512_ps256(folded));
+}
+SIMD_AVX512_END
+
+/**
+* AVX2/FMA kernel for a block of BlockRows rows. Every row keeps two
+* accumulators, so 2 * BlockRows independent FMA chains are in flight.
+*/
+template <int BlockRows>
+SIMD_TARGET("avx2,fma")
+static void block_avx2(int cols, const float* matrix, int stride,
+					   const float* vector, float* result,
+					   int first_row, const epilogue& post)
+{
+	constexpr int lanes = 8;
+	__m256 low[BlockRows];
+	__m256 high[BlockRows];
+	for (int block_row = 0; block_row < BlockRows; block_row++)
+	{
+		low[block_row] = _mm256_setzero_ps();
+		high[block_row] = _mm256_setzero_ps();
+	}
+
+	int col = 0;
+	for (; col + (2 * lanes) <= cols; col += 2 * lanes)
+	{
+		const __m256 vector_low = _mm256_loadu_ps(vector + col);
+		const __m256 vector_high = _mm256_loadu_ps(vector + col + lanes);
+		for (int block_row = 0; block_row < BlockRows; block_row++)
+		{
+			const float* matrix_row = matrix + (block_row * stride) + col;
+			low[block_row] = _mm256_fmadd_ps(
+				_mm256_loadu_ps(matrix_row), vector_low, low[block_row]);
+			high[block_row] = _mm256_fmadd_ps(
+				_mm256_loadu_ps(matrix_row + lanes), vector_high,
+				high[block_row]);
+		}
+	}
+
+	for (int block_row = 0; block_row < BlockRows; block_row++)
+	{
+		const float* matrix_row = matrix + (block_row * stride);
+		float sum = horizontal_sum_avx2(
+			_mm256_add_ps(low[block_row], high[block_row]));
+		for (int tail = col; tail < cols; tail++)
+		{
+			sum += matrix_row[tail] * vector[tail];
+		}
+		result[block_row] = finish_row(sum, first_row + block_row, post);
+	}
+}
+
+/**
+* AVX2/FMA kernel, full row blocks then the leftover rows one by one.
+*/
+SIMD_TARGET("avx2,fma")
+static void multiply_avx2(int rows, int cols,
+						  const float* matrix, int stride,
+						  const float* vector, float* result,
+						  const epilogue& post)
+{
+	int row = 0;
+	for (; row + gemv::ROW_BLOCK <= rows; row += gemv::ROW_BLOCK)
+	{
+		block_avx2<gemv::ROW_BLOCK>(
+			cols, matrix + (row * stride), stride, vector, result + row,
+			row, post);
+	}
+	for (; row < rows; row++)
+	{
+		block_avx2<1>(
+			cols, matrix + (row * stride), stride, vector, result + row,
+			row, post);
+	}
+}
+
+/**
+* AVX-512 kernel for a block of BlockRows rows, same structure as the
+* AVX2 kernel over 16 lanes, with the column tail handled by masked
+* loads.
+*/
+SIMD_AVX512_BEGIN
+template <int BlockRows>
+SIMD_TARGET("avx512f,avx2,fma")
+static void block_avx512(int cols, const float* matrix, int stride,
+						 const float* vector, float* result,
+						 int first_row, const epilogue& post)
+{
+	constexpr int lanes = 16;
+	__m512 low[BlockRows];
+	__m512 high[BlockRows];
+	for (int block_row = 0; block_row < BlockRows; block_row++)
+	{
+		low[block_row] = _mm512_setzero_ps();
+		high[block_row] = _mm512_setzero_ps();
+	}
+
+	int col = 0;
+	for (; col + (2 * lanes) <= cols; col += 2 * lanes)
+	{
+		const __m512 vector_low = _mm512_loadu_ps(vector + col);
+		const __m512 vector_high = _mm512_loadu_ps(vector + col + lanes);
+		for (int block_row = 0; block_row < BlockRows; block_row++)
+		{
+			const float* matrix_row = matrix + (block_row * stride) + col;
+			low[block_row] = _mm512_fmadd_ps(
+				_mm512_loadu_ps(matrix_row), vector_low, low[block_row]);
+			high[block_row] = _mm512_fmadd_ps(
+				_mm512_loadu_ps(matrix_row + lanes), vector_high,
+				high[block_row]);
+		}
+	}
+
+	// Up to two partial chunks remain, the last one masked
+	for (; col < cols; col += lanes)
+	{
+		const int chunk = (cols - col < lanes) ? (cols - col) : lanes;
+		const __mmask16 mask = static_cast<__mmask16>((1U << chunk) - 1U);
+		const __m512 vector_chunk = _mm512_maskz_loadu_ps(mask, vector + col);
+		for (int block_row = 0; block_row < BlockRows; block_row++)
+		{
+			low[block_row] = _mm512_fmadd_ps(
+				_mm512_maskz_loadu_ps(
+					mask, matrix + (block_row * stride) + col),
+				vector_chunk, low[block_row]);
+		}
+	}
+
+	for (int block_row = 0; block_row < BlockRows; block_row++)
+	{
+		result[block_row] = finish_row(
+			horizontal_sum_avx512(
+				_mm512_add_ps(low[block_row], high[block_row])),
+			first_row + block_row, post);
+	}
+}
+SIMD_AVX512_END
+
+/**
+* AVX-512 kernel, full row blocks then the leftover rows one by one.
+*/
+SIMD_AVX512_BEGIN
+SIMD_TARGET("avx512f,avx2,fma")
+static void multiply_avx512(int rows, int cols,
+							const float* matrix, int stride,
+							const float* vector, float* result,
+							const epilogue& post)
+{
+	int row = 0;
+	for (; row + gemv::ROW_BLOCK <= rows; row += gemv::ROW_BLOCK)
+	{
+		block_avx512<gemv::ROW_BLOCK>(
+			cols, matrix + (row * stride), stride, vector, result + row,
+			row, post);
+	}
+	for (; row < rows; row++)
+	{
+		block_avx512<1>(
+			cols, matrix + (row * stride), stride, vector, result + row,
+			row, post);
+	}
+}
+SIMD_AVX512_END
+
+/**
+* Loads 8 16-bit values of the given format, widened to floats.
+*/
+template <half_format Format>
+SIMD_TARGET("avx2,fma,f16c")
+static inline __m256 load_half_avx2(const uint16_t* values)
+{
+	const __m128i raw =
+		_mm_loadu_si128(reinterpret_cast<const __m128i*>(values));
+	if (half_format::FP16 == Format)
+	{
+		return _mm256_cvtph_ps(raw);
+	}
+
+	// bfloat16 is the upper half of a float
+	return _mm256_castsi256_ps(
+		_mm256_slli_epi32(_mm256_cvtepu16_epi32(raw), 16));
+}
+
+/**
+* Loads 16 16-bit values of the given format, widened to floats.
+*/
+SIMD_AVX512_BEGIN
+template <half_format Format>
+SIMD_TARGET("avx512f,avx2,fma,f16c")
+static inline __m512 load_half_avx512(const uint16_t* values)
+{
+	const __m256i raw =
+		_mm256_loadu_si256(reinterpret_cast<const __m256i*>(values));
+	if (half_format::FP16 == Format)
+	{
+		return _mm512_cvtph_ps(raw);
+	}
+
+	return _mm512_castsi512_ps(
+		_mm512_slli_epi32(_mm512_cvtepu16_epi32(raw), 16));
+}
+SIMD_AVX512_END
+
+/**
+* AVX2 kernel for a block of BlockRows rows of a 16-bit matrix, the
+* structure of block_avx2 with the matrix widened as it is loaded.
+*/
+template <half_format Format, int BlockRows>
+SIMD_TARGET("avx2,fma,f16c")
+static void block_half_avx2(int cols, const uint16_t* matrix,
+							const float* vector, float* result,
+							int first_row, const epilogue& post)
+{
+	constexpr int lanes = 8;
+	__m256 low[BlockRows];
+	__m256 high[BlockRows];
+	for (int block_row = 0; block_row < BlockRows; block_row++)
+	{
+		low[block_row] = _mm256_setzero_ps();
+		high[block_row] = _mm256_setzero_ps();
+	}
+
+	int col = 0;
+	for (; col + (2 * lanes) <= cols; col += 2 * lanes)
+	{
+		const __m256 vector_low = _mm256_loadu_ps(vector + col);
+		const __m256 vector_high = _mm256_loadu_ps(vector + col + lanes);
+		for (int block_row = 0; block_row < BlockRows; block_row++)
+		{
+			const uint16_t* matrix_row = matrix + (block_row * cols) + col;
+			low[block_row] = _mm256_fmadd_ps(
+				load_half_avx2<Format>(matrix_row), vector_low,
+				low[block_row]);
+			high[block_row] = _mm256_fmadd_ps(
+				load_half_avx2<Format>(matrix_row + lanes), vector_high,
+				high[block_row]);
+		}
+	}
+
+	// The tail is copied into zero padded chunks, widened as a whole
+	for (; col < cols; col += lanes)
+	{
+		const int chunk = std::min(lanes, cols - col);
+		float vector_tail[lanes] = {};
+		std::copy(vector + col, vector + col + chunk, vector_tail);
+		const __m256 vector_chunk = _mm256_loadu_ps(vector_tail);
+		for (int block_row = 0; block_row < BlockRows; block_row++)
+		{
+			const uint16_t* matrix_row = matrix + (block_row * cols) + col;
+			uint16_t matrix_tail[lanes] = {};
+			std::copy(matrix_row, matrix_row + chunk, matrix_tail);
+			low[block_row] = _mm256_fmadd_ps(
+				load_half_avx2<Format>(matrix_tail), vector_chunk,
+				low[block_row]);
+		}
+	}
+
+	for (int block_row = 0; block_row < BlockRows; block_row++)
+	{
+		result[block_row] = finish_row(
+			horizontal_sum_avx2(
+				_mm256_add_ps(low[block_row], high[block_row])),
+			first_row + block_row, post);
+	}
+}
+
+/**
+* AVX-512 kernel for a block of BlockRows rows of a 16-bit matrix.
+*/
+SIMD_AVX512_BEGIN
+template <half_format Format, int BlockRows>
+SIMD_TARGET("avx512f,avx2,fma,f16c")
+static void block_half_avx512(int cols, const uint16_t* matrix,
+							  const float* vector, float* result,
+							  int first_row, const epilogue& post)
+{
+	constexpr int lanes = 16;
+	__m512 low[BlockRows];
+	__m512 high[BlockRows];
+	for (int block_row = 0; block_row < BlockRows; block_row++)
+	{
+		low[block_row] = _mm512_setzero_ps();
+		high[block_row] = _mm512_setzero_ps();
+	}
+
+	int col = 0;
+	for (; col + (2 * lanes) <= cols; col += 2 * lanes)
+	{
+		const __m512 vector_low = _mm512_loadu_ps(vector + col);
+		const __m512 vector_high = _mm512_loadu_ps(vector + col + lanes);
+		for (int block_row = 0; block_row < BlockRows; block_row++)
+		{
+			const uint16_t* matrix_row = matrix + (block_row * cols) + col;
+			low[block_row] = _mm512_fmadd_ps(
+				load_half_avx512<Format>(matrix_row), vector_low,
+				low[block_row]);
+			high[block_row] = _mm512_fmadd_ps(
+				load_half_avx512<Format>(matrix_row + lanes), vector_high,
+				high[block_row]);
+		}
+	}
+
+	// Up to two partial chunks remain, the last one zero padded
+	for (; col < cols; col += lanes)
+	{
+		const int chunk = std::min(lanes, cols - col);
+		const __mmask16 mask = static_cast<__mmask16>((1U << chunk) - 1U);
+		const __m512 vector_chunk = _mm512_maskz_loadu_ps(mask, vector + col);
+		for (int block_row = 0; block_row < BlockRows; block_row++)
+		{
+			const uint16_t* matrix_row = matrix + (block_row * cols) + col;
+			uint16_t matrix_tail[lanes] = {};
+			std::copy(matrix_row, matrix_row + chunk, matrix_tail);
+			low[block_row] = _mm512_fmadd_ps(
+				load_half_avx512<Format>(matrix_tail), vector_chunk,
+				low[block_row]);
+		}
+	}
+
+	for (int block_row = 0; block_row < BlockRows; block_row++)
+	{
+		result[block_row] = finish_row(
+			horizontal_sum_avx512(
+				_mm512_add_ps(low[block_row], high[block_row])),
+			first_row + block_row, post);
+	}
+}
+SIMD_AVX512_END
+
+/**
+* AVX2 16-bit kernel, full row blocks then the leftover rows one by one.
+*/
+template <half_format Format>
+SIMD_TARGET("avx2,fma,f16c")
+static void multiply_half_avx2(const HalfMatrix& matrix, const float* vector,
+							   float* result, const epilogue& post)
+{
+	const int cols = matrix.get_cols();
+	int row = 0;
+	for (; row + gemv::ROW_BLOCK <= matrix.get_rows(); row += gemv::ROW_BLOCK)
+	{
+		block_half_avx2<Format, gemv::ROW_BLOCK>(
+			cols, matrix.data() + (row * cols), vector, result + row, row,
+			post);
+	}
+	for (; row < matrix.get_rows(); row++)
+	{
+		block_half_avx2<Format, 1>(
+			cols, matrix.data() + (row * cols), vector, result + row, row,
+			post);
+	}
+}
+
+/**
+* AVX-512 16-bit kernel, full row blocks then the leftover rows one
+* by one.
+*/
+SIMD_AVX512_BEGIN
+template <half_format Format>
+SIMD_TARGET("avx512f,avx2,fma,f16c")
+static void multiply_half_avx512(const HalfMatrix& matrix,
+								 const float* vector, float* result,
+								 const epilogue& post)
+{
+	const int cols = matrix.get_cols();
+	int row = 0;
+	for (; row + gemv::ROW_BLOCK <= matrix.get_rows(); row += gemv::ROW_BLOCK)
+	{
+		block_half_avx512<Format, gemv::ROW_BLOCK>(
+			cols, matrix.data() + (row * cols), vector, result + row, row,
+			post);
+	}
+	for (; row < matrix.get_rows(); row++)
+	{
+		block_half_avx512<Format, 1>(
+			cols, matrix.data() + (row * cols), vector, result + row, row,
+			post);
+	}
+}
+SIMD_AVX512_END
+
+/**
+* Sums the 8 int32 lanes of an AVX register.
+*/
+SIMD_TARGET("avx2,fma")
+static int32_t horizontal_sum_avx2(__m256i value)
+{
+	__m128i sum = _mm_add_epi32(_mm256_castsi256_si128(value),
+								_mm256_extracti128_si256(value, 1));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+	return _mm_cvtsi128_si32(sum);
+}
+
+/**
+* AVX2 int8 kernel for a block of BlockRows rows. pmaddubsw multiplies
+* unsigned by signed bytes, so the weights are made non-negative and
+* their signs moved onto the vector. With both sides within
+* [-127, 127], the pairwise int16 sums cannot saturate; pmaddwd then
+* widens them into int32 accumulators.
+*/
+template <int BlockRows>
+SIMD_TARGET("avx2,fma")
+static void block_int8_avx2(const QuantizedMatrix& matrix, int first_row,
+							const int8_t* vector, float vector_scale,
+							float* result, const epilogue& post)
+{
+	constexpr int lanes = 32;
+	const int stride = matrix.get_stride();
+	const int8_t* block = matrix.data() + (first_row * stride);
+	const __m256i ones = _mm256_set1_epi16(1);
+	__m256i sums[BlockRows];
+	for (int block_row = 0; block_row < BlockRows; block_row++)
+	{
+		sums[block_row] = _mm256_setzero_si256();
+	}
+
+	for (int col = 0; col < stride; col += lanes)
+	{
+		const __m256i vector_chunk = _mm256_loadu_si256(
+			reinterpret_cast<const __m256i*>(vector + col));
+		for (int block_row = 0; block_row < BlockRows; block_row++)
+		{
+			const __m256i weights = _mm256_loadu_si256(
+				reinterpret_cast<const __m256i*>(
+					block + (block_row * stride) + col));
+			const __m256i pairs = _mm256_maddubs_epi16(
+				_mm256_sign_epi8(weights, weights),
+				_mm256_sign_epi8(vector_chunk, weights));
+			sums[block_row] = _mm256_add_epi32(
+				sums[block_row], _mm256_madd_epi16(pairs, ones));
+		}
+	}
+
+	for (int block_row = 0; block_row < BlockRows; block_row++)
+	{
+		const int row = first_row + block_row;
+		result[row] = finish_row(
+			horizontal_sum_avx2(sums[block_row]) * matrix.scales()[row] *
+				vector_scale,
+			row, post);
+	}
+}
+
+/**
+* AVX2 int8 kernel, full row blocks then the leftover rows one by one.
+*/
+SIMD_TARGET("avx2,fma")
+static void multiply_int8_avx2(const QuantizedMatrix& matrix,
+							   const int8_t* vector, float vector_scale,
+							   float* result, const epilogue& post)
+{
+	int row = 0;
+	for (; row + gemv::ROW_BLOCK <= matrix.get_rows(); row += gemv::ROW_BLOCK)
+	{
+		block_int8_avx2<gemv::ROW_BLOCK>(matrix, row, vector, vector_scale,
+										 result, post);
+	}
+	for (; row < matrix.get_rows(); row++)
+	{
+		block_int8_avx2<1>(matrix, row, vector, vector_scale, result, post);
+	}
+}
+
+/**
+* AVX-512 VNNI int8 kernel for a block of BlockRows rows. vpdpbusd
+* multiplies unsigned by signed bytes and accumulates groups of four
+* straight into int32, so only the sign transfer of the AVX2 kernel
+* remains.
+*/
+SIMD_AVX512_BEGIN
+template <int BlockRows>
+SIMD_TARGET("avx512f,avx512bw,avx512vnni,avx2,fma")
+static void block_int8_vnni(const QuantizedMatrix& matrix, int first_row,
+							const int8_t* vector, float vector_scale,
+							float* result, const epilogue& post)
+{
+	constexpr int lanes = 64;
+	const int stride = matrix.get_stride();
+	const int8_t* block = matrix.data() + (first_row * stride);
+	const __m512i zero = _mm512_setzero_si512();
+	__m512i sums[BlockRows];
+	for (int block_row = 0; block_row < BlockRows; block_row++)
+	{
+		sums[block_row] = _mm512_setzero_si512();
+	}
+
+	for (int col = 0; col < stride; col += lanes)
+	{
+		const __m512i vector_chunk = _mm512_loadu_si512(vector + col);
+		for (int block_row = 0; block_row < BlockRows; block_row++)
+		{
+			const __m512i weights = _mm512_loadu_si512(
+				block + (block_row * stride) + col);
+			const __m512i signed_vector = _mm512_mask_sub_epi8(
+				vector_chunk, _mm512_movepi8_mask(weights), zero,
+				vector_chunk);
+			sums[block_row] = _mm512_dpbusd_epi32(
+				sums[block_row], _mm512_abs_epi8(weights), signed_vector);
+		}
+	}
+
+	for (int block_row = 0; block_row < BlockRows; block_row++)
+	{
+		const int row = first_row + block_row;
+		result[row] = finish_row(
+			_mm512_reduce_add_epi32(sums[block_row]) * matrix.scales()[row] *
+				vector_scale,
+			row, post);
+	}
+}
+SIMD_AVX512_END
+
+/**
+* AVX-512 VNNI int8 kernel, full row blocks then the leftover rows
+* one by one.
+*/
+SIMD_AVX512_BEGIN
+SIMD_TARGET("avx512f,avx512bw,avx512vnni,avx2,fma")
+static void multiply_int8_vnni(const QuantizedMatrix& matrix,
+							   const int8_t* vector, float vector_scale,
+							   float* result, const epilogue& post)
+{
+	int row = 0;
+	for (; row + gemv::ROW_BLOCK <= matrix.get_rows(); row += gemv::ROW_BLOCK)
+	{
+		block_int8_vnni<gemv::ROW_BLOCK>(matrix, row, vector, vector_scale,
+										 result, post);
+	}
+	for (; row < matrix.get_rows(); row++)
+	{
+		block_int8_vnni<1>(matrix, row, vector, vector_scale, result, post);
+	}
+}
+SIMD_AVX512_END
+
+/**
+* AVX2 sparse kernel, gathering 8 vector values per stored block,
+* the leftover cells of a row one by one.
+*/
+SIMD_TARGET("avx2,fma")
+static void multiply_sparse_avx2(const SparseMatrix& matrix,
+								 const float* vector, float* result,
+								 const epilogue& post)
+{
+	const int32_t* starts = matrix.row_starts();
+	const int32_t* columns = matrix.col_indices();
+	const float* values = matrix.values();
+	for (int row = 0; row < matrix.get_rows(); row++)
+	{
+		__m256 sums = _mm256_setzero_ps();
+		int32_t index = starts[row];
+		for (; index + 8 <= starts[row + 1]; index += 8)
+		{
+			const __m256i indices = _mm256_loadu_si256(
+				reinterpret_cast<const __m256i*>(columns + index));
+			sums = _mm256_fmadd_ps(
+				_mm256_loadu_ps(values + index),
+				_mm256_i32gather_ps(vector, indices, sizeof(float)), sums);
+		}
+
+		float sum = horizontal_sum_avx2(sums);
+		for (; index < starts[row + 1]; index++)
+		{
+			sum += values[index] * vector[columns[index]];
+		}
+		result[row] = finish_row(sum, row, post);
+	}
+}
+
+/**
+* AVX-512 sparse kernel, gathering 16 vector values per stored block,
+* the last block of a row masked.
+*/
+SIMD_AVX512_BEGIN
+SIMD_TARGET("avx512f,avx2,fma")
+static void multiply_sparse_avx512(const SparseMatrix& matrix,
+								   const float* vector, float* result,
+								   const epilogue& post)
+{
+	const int32_t* starts = matrix.row_starts();
+	const int32_t* columns = matrix.col_indices();
+	const float* values = matrix.values();
+	for (int row = 0; row < matrix.get_rows(); row++)
+	{
+		__m512 sums = _mm512_setzero_ps();
+		for (int32_t index = starts[row]; index < starts[row + 1];
+			 index += 16)
+		{
+			const int32_t remaining = starts[row + 1] - index;
+			const __mmask16 mask = (16 <= remaining) ? 0xFFFF :
+				static_cast<__mmask16>((1U << remaining) - 1);
+			const __m512i indices =
+				_mm512_maskz_loadu_epi32(mask, columns + index);
+			sums = _mm512_fmadd_ps(
+				_mm512_maskz_loadu_ps(mask, values + index),
+				_mm512_mask_i32gather_ps(_mm512_setzero_ps(), mask, indices,
+										 vector, sizeof(float)),
+				sums);
+		}
+		result[row] = finish_row(horizontal_sum_avx512(sums), row, post);
+	}
+}
+SIMD_AVX512_END
+
+/**
+* AVX2 kernel of gemv::sum_rows. Blocks of 32 result columns are held
+* in 4 registers over every selected row, then single registers, then
+* the leftover columns one by one.
+*/
+SIMD_TARGET("avx2,fma")
+static void sum_rows_avx2(int count, const float* values,
+						  const int32_t* indices,
+						  const float* matrix, int stride, int cols,
+						  float* result)
+{
+	int col = 0;
+	for (; col + 32 <= cols; col += 32)
+	{
+		__m256 sums[4] = {_mm256_setzero_ps(), _mm256_setzero_ps(),
+						  _mm256_setzero_ps(), _mm256_setzero_ps()};
+		for (int index = 0; index < count; index++)
+		{
+			const __m256 value = _mm256_set1_ps(values[index]);
+			const float* matrix_row = matrix + (indices[index] * stride) + col;
+			for (int lane = 0; lane < 4; lane++)
+			{
+				sums[lane] = _mm256_fmadd_ps(
+					value, _mm256_loadu_ps(matrix_row + (lane * 8)), sums[lane]);
+			}
+		}
+		for (int lane = 0; lane < 4; lane++)
+		{
+			_mm256_storeu_ps(result + col + (lane * 8), sums[lane]);
+		}
+	}
+	for (; col + 8 <= cols; col += 8)
+	{
+		__m256 sum = _mm256_setzero_ps();
+		for (int index = 0; index < count; index++)
+		{
+			sum = _mm256_fmadd_ps(
+				_mm256_set1_ps(values[index]),
+				_mm256_loadu_ps(matrix + (indices[index] * stride) + col),
+				sum);
+		}
+		_mm256_storeu_ps(result + col, sum);
+	}
+	for (; col < cols; col++)
+	{
+		float sum = 0;
+		for (int index = 0; index < count; index++)
+		{
+			sum += values[index] * matrix[(indices[index] * stride) + col];
+		}
+		result[col] = sum;
+	}
+}
+
+/**
+* AVX-512 kernel of gemv::sum_rows. Blocks of 64 result columns are
+* held in 4 registers over every selected row, then single (masked)
+* registers.
+*/
+SIMD_AVX512_BEGIN
+SIMD_TARGET("avx512f,avx2,fma")
+static void sum_rows_avx512(int count, const float* values,
+							const int32_t* indices,
+							const float* matrix, int stride, int cols,
+							float* result)
+{
+	int col = 0;
+	for (; col + 64 <= cols; col += 64)
+	{
+		__m512 sums[4] = {_mm512_setzero_ps(), _mm512_setzero_ps(),
+						  _mm512_setzero_ps(), _mm512_setzero_ps()};
+		for (int index = 0; index < count; index++)
+		{
+			const __m512 value = _mm512_set1_ps(values[index]);
+			const float* matrix_row = matrix + (indices[index] * stride) + col;
+			for (int lane = 0; lane < 4; lane++)
+			{
+				sums[lane] = _mm512_fmadd_ps(
+					value, _mm512_loadu_ps(matrix_row + (lane * 16)),
+					sums[lane]);
+			}
+		}
+		for (int lane = 0; lane < 4; lane++)
+		{
+			_mm512_storeu_ps(result + col + (lane * 16), sums[lane]);
+		}
+	}
+	for (; col < cols; col += 16)
+	{
+		const __mmask16 mask = (col + 16 <= cols) ? 0xFFFF :
+			static_cast<__mmask16>((1U << (cols - col)) - 1);
+		__m512 sum = _mm512_setzero_ps();
+		for (int index = 0; index < count; index++)
+		{
+			sum = _mm512_fmadd_ps(
+				_mm512_set1_ps(values[index]),
+				_mm512_maskz_loadu_ps(
+					mask, matrix + (indices[index] * stride) + col),
+				sum);
+		}
+		_mm512_mask_storeu_ps(result + col, mask, sum);
+	}
+}
+SIMD_AVX512_END
+
+/**
+* AVX2 kernel of gemv::compact, the non-zero lanes of every register
+* found by a comparison mask.
+*/
+SIMD_TARGET("avx2,fma")
+static int compact_avx2(const float* vector, int size, int32_t* indices,
+						float* values)
+{
+	int count = 0;
+	int index = 0;
+	for (; index + 8 <= size; index += 8)
+	{
+		const __m256 chunk = _mm256_loadu_ps(vector + index);
+		int nonzero = _mm256_movemask_ps(
+			_mm256_cmp_ps(chunk, _mm256_setzero_ps(), _CMP_NEQ_UQ));
+		while (0 != nonzero)
+		{
+			const int lane = __builtin_ctz(nonzero);
+			indices[count] = index + lane;
+			values[count] = vector[index + lane];
+			count++;
+			nonzero &= nonzero - 1;
+		}
+	}
+
+	for (; index < size; index++)
+	{
+		if (0.0F != vector[index])
+		{
+			indices[count] = index;
+			values[count] = vector[index];
+			count++;
+		}
+	}
+
+	return count;
+}
+
+/**
+* AVX-512 kernel of gemv::compact, compressing the non-zero lanes of
+* every register in registers, then storing the whole registers.
+*/
+SIMD_AVX512_BEGIN
+SIMD_TARGET("avx512f,avx2,fma")
+static int compact_avx512(const float* vector, int size, int32_t* indices,
+						  float* values)
+{
+	const __m512i lanes = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7,
+											8, 9, 10, 11, 12, 13, 14, 15);
+	int count = 0;
+	for (int index = 0; index < size; index += 16)
+	{
+		const __mmask16 valid = (index + 16 <= size) ? 0xFFFF :
+			static_cast<__mmask16>((1U << (size - index)) - 1);
+		const __m512 chunk = _mm512_maskz_loadu_ps(valid, vector + index);
+		const __mmask16 nonzero = _mm512_mask_cmp_ps_mask(
+			valid, chunk, _mm512_setzero_ps(), _CMP_NEQ_UQ);
+		_mm512_storeu_si512(
+			indices + count,
+			_mm512_maskz_compress_epi32(
+				nonzero, _mm512_add_epi32(lanes, _mm512_set1_epi32(index))));
+		_mm512_storeu_ps(values + count,
+						 _mm512_maskz_compress_ps(nonzero, chunk));
+		count += __builtin_popcount(nonzero);
+	}
+
+	return count;
+}
+SIMD_AVX512_END
+
+#endif
+
+// See documentation at header file
+void gemv::multiply(int rows, int cols,
+					const float* matrix, int stride,
+					const float* vector, float* result,
+					const epilogue& post)
+{
+	multiply(simd::active_isa(), rows, cols, matrix, stride, vector, result,
+			 post);
+}
+
+// See documentation at header file
+void gemv::multiply(simd::isa set, int rows, int cols,
+					const float* matrix, int stride,
+					const float* vector, float* result,
+					const epilogue& post)
+{
+	switch (set)
+	{
+#if SIMD_X86
+	case simd::isa::AVX512:
+		multiply_avx512(rows, cols, matrix, stride, vector, result, post);
+		break;
+	case simd::isa::AVX2:
+		multiply_avx2(rows, cols, matrix, stride, vector, result, post);
+		break;
+#endif
+	default:
+		multiply_scalar(rows, cols, matrix, stride, vector, result, post);
+		break;
+	}
+}
+
+// See documentation at header file
+void gemv::multiply(const MatrixView& matrix, const MatrixView& vector,
+					float* result, const epilogue& post)
+{
+	// Strided vectors are gathered once, the kernels read them per row
+	thread_local std::vector<float> gathered;
+	const float* vector_data = vector.data();
+	if (1 != vector.row_step())
+	{
+		gathered.resize(static_cast<size_t>(vector.get_rows()));
+		for (int row = 0; row < vector.get_rows(); row++)
+		{
+			gathered[row] = vector_data[row * vector.row_step()];
+		}
+		vector_data = gathered.data();
+	}
+
+	if (matrix.is_transposed())
+	{
+		multiply_transposed(matrix.get_rows(), matrix.get_cols(),
+							matrix.data(), matrix.get_stride(),
+							vector_data, result, post);
+		return;
+	}
+
+	multiply(matrix.get_rows(), matrix.get_cols(),
+			 matrix.data(), matrix.get_stride(), vector_data, result, post);
+}
+
+// See documentation at header file
+void gemv::multiply_sparse_input(int rows, int cols,
+								 const float* matrix, int stride,
+								 const float* columns, int columns_stride,
+								 const float* vector, float* result,
+								 const epilogue& post)
+{
+	multiply_sparse_input(simd::active_isa(), rows, cols, matrix, stride,
+						  columns, columns_stride, vector, result, post);
+}
+
+// See documentation at header file
+void gemv::multiply_sparse_input(simd::isa set, int rows, int cols,
+								 const float* matrix, int stride,
+								 const float* columns, int columns_stride,
+								 const float* vector, float* result,
+								 const epilogue& post)
+{
+	// The compacted vector is kept per thread
+	thread_local std::vector<int32_t> indices;
+	thread_local std::vector<float> values;
+	if (indices.size() < static_cast<size_t>(cols + COMPACT_SLACK))
+	{
+		indices.resize(static_cast<size_t>(cols + COMPACT_SLACK));
+		values.resize(indices.size());
+	}
+
+	const int count = compact(set, vector, cols, indices.data(),
+							  values.data());
+	if (count > SPARSE_INPUT_DENSITY * cols)
+	{
+		multiply(set, rows, cols, matrix, stride, vector, result, post);
+		return;
+	}
+
+	sum_rows(set, count, values.data(), indices.data(), columns,
+			 columns_stride, rows, result);
+	for (int row = 0; row < rows; row++)
+	{
+		result[row] = finish_row(result[row], row, post);
+	}
+}
+
+// See documentation at header file
+int gemv::compact(simd::isa set, const float* vector, int size,
+				  int32_t* indices, float* values)
+{
+	switch (set)
+	{
+#if SIMD_X86
+	case simd::isa::AVX512:
+		return compact_avx512(vector, size, indices, values);
+	case simd::isa::AVX2:
+		return compact_avx2(vector, size, indices, values);
+#endif
+	default:
+		return compact_scalar(vector, size, indices, values);
+	}
+}
+
+// See documentation at header file
+void gemv::sum_rows(simd::isa set, int count, const float* values,
+					const int32_t* indices, const float* matrix, int stride,
+					int cols, float* result)
+{
+	switch (set)
+	{
+#if SIMD_X86
+	case simd::isa::AVX512:
+		sum_rows_avx512(count, values, indices, matrix, stride, cols, result);
+		break;
+	case simd::isa::AVX2:
+		sum_rows_avx2(count, values, indices, matrix, stride, cols, result);
+		break;
+#endif
+	default:
+		sum_rows_scalar(count, values, indices, matrix, stride, cols, result);
+		break;
+	}
+}
+
+// See documentation at header file
+void gemv::multiply(const QuantizedMatrix& matrix, const float* vector,
+					float* result, const epilogue& post)
+{
+	simd::isa set = simd::active_isa();
+	if ((simd::isa::AVX512 == set) && !simd::vnni_supported())
+	{
+		set = simd::isa::AVX2;
+	}
+
+	multiply(set, matrix, vector, result, post);
+}
+
+// See documentation at header file
+void gemv::multiply(simd::isa set, const QuantizedMatrix& matrix,
+					const float* vector, float* result, const epilogue& post)
+{
+	// The vector is quantized per call, into a per-thread buffer
+	thread_local std::vector<int8_t> quantized;
+	quantized.resize(static_cast<size_t>(matrix.get_stride()));
+	const float vector_scale = QuantizedMatrix::quantize_vector(
+		vector, matrix.get_cols(), 1, quantized.data());
+
+	switch (set)
+	{
+#if SIMD_X86
+	case simd::isa::AVX512:
+		multiply_int8_vnni(matrix, quantized.data(), vector_scale, result,
+						   post);
+		break;
+	case simd::isa::AVX2:
+		multiply_int8_avx2(matrix, quantized.data(), vector_scale, result,
+						   post);
+		break;
+#endif
+	default:
+		multiply_int8_scalar(matrix, quantized.data(), vector_scale, result,
+							 post);
+		break;
+	}
+}
+
+// See documentation at header file
+void gemv::multiply(const HalfMatrix& matrix, const float* vector,
+					float* result, const epilogue& post)
+{
+	multiply(simd::active_isa(), matrix, vector, result, post);
+}
+
+// See documentation at header file
+void gemv::multiply(simd::isa set, const HalfMatrix& matrix,
+					const float* vector, float* result, const epilogue& post)
+{
+	const bool fp16 = (half_format::FP16 == matrix.get_format());
+	switch (set)
+	{
+#if SIMD_X86
+	case simd::isa::AVX512:
+		if (fp16)
+		{
+			multiply_half_avx512<half_format::FP16>(matrix, vector, result,
+													post);
+		}
+		else
+		{
+			multiply_half_avx512<half_format::BF16>(matrix, vector, result,
+													post);
+		}
+		break;
+	case simd::isa::AVX2:
+		if (fp16)
+		{
+			multiply_half_avx2<half_format::FP16>(matrix, vector, result,
+												  post);
+		}
+		else
+		{
+			multiply_half_avx2<half_format::BF16>(matrix, vector, result,
+												  post);
+		}
+		break;
+#endif
+	default:
+		multiply_half_scalar(matrix, vector, result, post);
+		break;
+	}
+}
+
+// See documentation at header file
+void gemv::multiply(const SparseMatrix& matrix, const float* vector,
+					float* result, const epilogue& post)
+{
+	multiply(simd::active_isa(), matrix, vector, result, post);
+}
+
+// See documentation at header file
+void gemv::multiply(simd::isa set, const SparseMatrix& matrix,
+					const float* vector, float* result, const epilogue& post)
+{
+	switch (set)
+	{
+#if SIMD_X86
+	case simd::isa::AVX512:
+		multiply_sparse_avx512(matrix, vector, result, post);
+		break;
+	case simd::isa::AVX2:
+		multiply_sparse_avx2(matrix, vector, result, post);
+		break;
+#endif
+	default:
+		multiply_sparse_scalar(matrix, vector, result, post);
+		break;
+	}
+}
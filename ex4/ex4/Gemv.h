@@ -0,0 +1,208 @@
+#ifndef GEMV_H
+#define GEMV_H
+
+#include <cstdint>
+
+#include "Epilogue.h"
+#include "HalfMatrix.h"
+#include "MatrixView.h"
+#include "QuantizedMatrix.h"
+#include "Simd.h"
+#include "SparseMatrix.h"
+
+/**
+* General matrix-vector multiplication (GEMV) kernels.
+* The matrix is row-major, addressed by a base pointer and a leading
+* dimension, the vectors are contiguous.
+*
+* Kernels compute ROW_BLOCK rows at a time, so every chunk of the
+* vector loaded into registers is reused across those rows.
+*/
+namespace gemv
+{
+	// Matrix rows computed together by the kernels
+	constexpr int ROW_BLOCK = 4;
+	// Vector density (the fraction of non-zero values) up to which
+	// multiply_sparse_input skips the zero values, the dense kernel
+	// is faster above it
+	constexpr float SPARSE_INPUT_DENSITY = 0.5F;
+	// Values compact may write past the compacted ones
+	constexpr int COMPACT_SLACK = 16;
+
+	/**
+	* Calculates result = matrix * vector, using the most capable
+	* kernel for the CPU (see simd::active_isa).
+	* @param rows - Row count of the matrix and size of the result.
+	* @param cols - Column count of the matrix and size of the vector.
+	* @param matrix - The matrix (rows x cols).
+	* @param stride - Leading dimension of the matrix.
+	* @param vector - The vector to multiply by.
+	* @param result - The result vector, may not overlap the operands.
+	* @param post - Bias and activation fused into the result store.
+	*/
+	void multiply(int rows, int cols,
+				  const float* matrix, int stride,
+				  const float* vector, float* result,
+				  const epilogue& post = no_epilogue);
+
+	/**
+	* Same as above, with an explicitly selected kernel.
+	* The instruction set must be supported by the CPU.
+	* @param set - The instruction set of the kernel to use.
+	*/
+	void multiply(simd::isa set, int rows, int cols,
+				  const float* matrix, int stride,
+				  const float* vector, float* result,
+				  const epilogue& post = no_epilogue);
+
+	/**
+	* Calculates result = matrix * vector over views. A transposed
+	* matrix is read in place, by its contiguous columns, and a
+	* strided vector is gathered first. Dimensions are not checked.
+	* @param matrix - The matrix view (rows x cols).
+	* @param vector - The vector view (cols x 1).
+	* @param result - The result vector, may not overlap the operands.
+	* @param post - Bias and activation fused into the result store.
+	*/
+	void multiply(const MatrixView& matrix, const MatrixView& vector,
+				  float* result, const epilogue& post = no_epilogue);
+
+	/**
+	* Calculates result = matrix * vector with int8 dot products.
+	* The vector is quantized symmetrically (one scale), the int32
+	* sums are requantized to floating-point by the row and vector
+	* scales before the epilogue. Uses AVX-512 VNNI when available
+	* (see simd::vnni_supported), otherwise AVX2 or the portable kernel.
+	* @param matrix - The quantized matrix.
+	* @param vector - The vector to multiply by, of the matrix column
+	*				  count.
+	* @param result - The result vector, of the matrix row count.
+	* @param post - Bias and activation fused into the result store.
+	*/
+	void multiply(const QuantizedMatrix& matrix, const float* vector,
+				  float* result, const epilogue& post = no_epilogue);
+
+	/**
+	* Same as above, with an explicitly selected kernel. AVX512
+	* selects the VNNI kernel, which needs simd::vnni_supported.
+	* @param set - The instruction set of the kernel to use.
+	*/
+	void multiply(simd::isa set, const QuantizedMatrix& matrix,
+				  const float* vector, float* result,
+				  const epilogue& post = no_epilogue);
+
+	/**
+	* Calculates result = matrix * vector over a 16-bit matrix, widened
+	* to floats in registers (F16C for half precision, a shift for
+	* bfloat16), so only half of the float matrix is read.
+	* @param matrix - The 16-bit matrix.
+	* @param vector - The vector to multiply by, of the matrix column
+	*				  count.
+	* @param result - The result vector, of the matrix row count.
+	* @param post - Bias and activation fused into the result store.
+	*/
+	void multiply(const HalfMatrix& matrix, const float* vector,
+				  float* result, const epilogue& post = no_epilogue);
+
+	/**
+	* Same as above, with an explicitly selected kernel.
+	* The instruction set must be supported by the CPU.
+	* @param set - The instruction set of the kernel to use.
+	*/
+	void multiply(simd::isa set, const HalfMatrix& matrix,
+				  const float* vector, float* result,
+				  const epilogue& post = no_epilogue);
+
+	/**
+	* Calculates result = matrix * vector for vectors with many exact
+	* zeros, such as images and ReLU outputs, in time proportional to
+	* their non-zero values: the non-zero values are compacted first
+	* (see compact), then only the matching matrix columns are summed,
+	* read as contiguous rows of a column-major copy (see sum_rows).
+	* Vectors denser than SPARSE_INPUT_DENSITY are multiplied by the
+	* row-major matrix instead.
+	* @param rows - Row count of the matrix and size of the result.
+	* @param cols - Column count of the matrix and size of the vector.
+	* @param matrix - The matrix (rows x cols), row-major.
+	* @param stride - Leading dimension of the matrix.
+	* @param columns - The same matrix, column-major (cols x rows).
+	* @param columns_stride - Leading dimension of the columns.
+	* @param vector - The vector to multiply by.
+	* @param result - The result vector, may not overlap the operands.
+	* @param post - Bias and activation fused into the result store.
+	*/
+	void multiply_sparse_input(int rows, int cols,
+							   const float* matrix, int stride,
+							   const float* columns, int columns_stride,
+							   const float* vector, float* result,
+							   const epilogue& post = no_epilogue);
+
+	/**
+	* Same as above, with an explicitly selected kernel.
+	* The instruction set must be supported by the CPU.
+	* @param set - The instruction set of the kernel to use.
+	*/
+	void multiply_sparse_input(simd::isa set, int rows, int cols,
+							   const float* matrix, int stride,
+							   const float* columns, int columns_stride,
+							   const float* vector, float* result,
+							   const epilogue& post = no_epilogue);
+
+	/**
+	* Compacts the non-zero values of a vector (NaNs included), in
+	* order, with their indices.
+	* @param set - The instruction set of the kernel to use.
+	* @param vector - The vector.
+	* @param size - The number of values in the vector.
+	* @param indices - Output, the index of every non-zero value. Room
+	*				   for size + COMPACT_SLACK values.
+	* @param values - Output, every non-zero value. Room for size +
+	*				  COMPACT_SLACK values.
+	* @return The number of non-zero values.
+	*/
+	int compact(simd::isa set, const float* vector, int size,
+				int32_t* indices, float* values);
+
+	/**
+	* Calculates result = the sum of the selected matrix rows, each
+	* scaled by its value: the product of the transpose of the matrix
+	* by a compacted sparse vector. Blocks of result values are held in
+	* registers over every selected row.
+	* @param set - The instruction set of the kernel to use.
+	* @param count - The number of selected rows.
+	* @param values - The scale of every selected row.
+	* @param indices - The index of every selected row.
+	* @param matrix - The matrix, row-major.
+	* @param stride - Leading dimension of the matrix.
+	* @param cols - Column count of the matrix and size of the result.
+	* @param result - The result vector, overwritten.
+	*/
+	void sum_rows(simd::isa set, int count, const float* values,
+				  const int32_t* indices, const float* matrix, int stride,
+				  int cols, float* result);
+
+	/**
+	* Calculates result = matrix * vector over a sparse matrix, in time
+	* proportional to its stored cells: every row is a dot product of
+	* its stored values with the vector values gathered at their
+	* column indices.
+	* @param matrix - The sparse matrix.
+	* @param vector - The vector to multiply by, of the matrix column
+	*				  count.
+	* @param result - The result vector, of the matrix row count.
+	* @param post - Bias and activation fused into the result store.
+	*/
+	void multiply(const SparseMatrix& matrix, const float* vector,
+				  float* result, const epilogue& post = no_epilogue);
+
+	/**
+	* Same as above, with an explicitly selected kernel.
+	* The instruction set must be supported by the CPU.
+	* @param set - The instruction set of the kernel to use.
+	*/
+	void multiply(simd::isa set, const SparseMatrix& matrix,
+				  const float* vector, float* result,
+				  const epilogue& post = no_epilogue);
+}
+
+#endif //GEMV_H
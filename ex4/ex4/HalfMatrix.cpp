@@ -0,0 +1,276 @@
+#include <cmath>
+#include <cstring>
+
+#include "HalfMatrix.h"
+#include "Simd.h"
+
+#if SIMD_X86
+#include <immintrin.h>
+#endif
+
+// Float bit fields
+constexpr uint32_t float_sign = 0x80000000U;
+constexpr uint32_t float_infinity = 0x7F800000U;
+// Half precision bit fields
+constexpr uint32_t fp16_infinity = 0x7C00U;
+constexpr uint32_t fp16_quiet_nan = 0x0200U;
+// Difference between the float and half precision exponent biases
+constexpr uint32_t fp16_rebias = 127 - 15;
+// Smallest float magnitude rounding to the half precision infinity
+// (65520, halfway between the largest half and the next power of 2)
+constexpr uint32_t fp16_overflow = 0x477FF000U;
+// Smallest normal half precision magnitude, 2^-14, as float bits
+constexpr uint32_t fp16_min_normal = 0x38800000U;
+// Largest float magnitude rounding to a half precision 0, 2^-25
+constexpr uint32_t fp16_underflow = 0x33000000U;
+// Float mantissa bits dropped by the half precision mantissa
+constexpr int fp16_dropped_bits = 13;
+// Float bits dropped by bfloat16
+constexpr int bf16_dropped_bits = 16;
+
+/**
+* Gets the bits of a float.
+*/
+static uint32_t float_bits(float value)
+{
+	uint32_t bits = 0;
+	std::memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+/**
+* Gets the float of the given bits.
+*/
+static float bits_float(uint32_t bits)
+{
+	float value = 0;
+	std::memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+/**
+* Drops the given number of low bits, rounding to nearest even.
+*/
+static uint32_t round_bits(uint32_t bits, int dropped)
+{
+	const uint32_t halfway = 1U << (dropped - 1);
+	const uint32_t remainder = bits & ((1U << dropped) - 1U);
+	uint32_t result = bits >> dropped;
+	if ((remainder > halfway) || ((remainder == halfway) && (result & 1U)))
+	{
+		result++;
+	}
+
+	return result;
+}
+
+/**
+* Converts a float to half precision, rounding to nearest even.
+*/
+static uint16_t narrow_fp16(float value)
+{
+	const uint32_t bits = float_bits(value);
+	const uint32_t sign = (bits & float_sign) >> 16;
+	const uint32_t magnitude = bits & ~float_sign;
+	if (magnitude > float_infinity)
+	{
+		return static_cast<uint16_t>(sign | fp16_infinity | fp16_quiet_nan);
+	}
+	if (magnitude >= fp16_overflow)
+	{
+		return static_cast<uint16_t>(sign | fp16_infinity);
+	}
+	if (magnitude <= fp16_underflow)
+	{
+		return static_cast<uint16_t>(sign);
+	}
+	if (magnitude < fp16_min_normal)
+	{
+		// Subnormal, a count of 2^-24 units
+		const uint32_t exponent = magnitude >> 23;
+		const uint32_t mantissa = (magnitude & 0x7FFFFFU) | 0x800000U;
+		return static_cast<uint16_t>(
+			sign | round_bits(mantissa, static_cast<int>(126 - exponent)));
+	}
+
+	// A carry out of the mantissa correctly bumps the exponent
+	return static_cast<uint16_t>(
+		sign | (round_bits(magnitude, fp16_dropped_bits) - (fp16_rebias << 10)));
+}
+
+/**
+* Converts a half precision value to float.
+*/
+static float widen_fp16(uint16_t value)
+{
+	const uint32_t sign = (value & 0x8000U) << 16;
+	const uint32_t exponent = (value >> 10) & 0x1FU;
+	const uint32_t mantissa = value & 0x3FFU;
+	if (0x1FU == exponent)
+	{
+		return bits_float(sign | float_infinity |
+						  (mantissa << fp16_dropped_bits));
+	}
+	if (0 != exponent)
+	{
+		return bits_float(sign | ((exponent + fp16_rebias) << 23) |
+						  (mantissa << fp16_dropped_bits));
+	}
+
+	// Zero or subnormal, a count of 2^-24 units
+	const float magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+	return (0 != sign) ? -magnitude : magnitude;
+}
+
+#if SIMD_X86
+
+/**
+* Widens values with AVX2, F16C for half precision and a 16-bit shift
+* for bfloat16.
+*/
+SIMD_TARGET("avx2,fma,f16c")
+static int widen_avx2(const uint16_t* values, int count, half_format format,
+					  float* result)
+{
+	constexpr int lanes = 8;
+	int index = 0;
+	for (; index + lanes <= count; index += lanes)
+	{
+		const __m128i raw = _mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(values + index));
+		const __m256 widened = (half_format::FP16 == format) ?
+			_mm256_cvtph_ps(raw) :
+			_mm256_castsi256_ps(_mm256_slli_epi32(
+				_mm256_cvtepu16_epi32(raw), bf16_dropped_bits));
+		_mm256_storeu_ps(result + index, widened);
+	}
+
+	return index;
+}
+
+/**
+* Widens values with AVX-512.
+*/
+SIMD_AVX512_BEGIN
+SIMD_TARGET("avx512f,avx2,fma,f16c")
+static int widen_avx512(const uint16_t* values, int count, half_format format,
+						float* result)
+{
+	constexpr int lanes = 16;
+	int index = 0;
+	for (; index + lanes <= count; index += lanes)
+	{
+		const __m256i raw = _mm256_loadu_si256(
+			reinterpret_cast<const __m256i*>(values + index));
+		const __m512 widened = (half_format::FP16 == format) ?
+			_mm512_cvtph_ps(raw) :
+			_mm512_castsi512_ps(_mm512_slli_epi32(
+				_mm512_cvtepu16_epi32(raw), bf16_dropped_bits));
+		_mm512_storeu_ps(result + index, widened);
+	}
+
+	return index;
+}
+SIMD_AVX512_END
+
+#endif
+
+// See documentation at header file
+HalfMatrix::HalfMatrix(const Matrix& matrix, half_format format) :
+	_rows(matrix.get_rows()),
+	_columns(matrix.get_cols()),
+	_format(format),
+	_values(static_cast<size_t>(_rows) * _columns)
+{
+	for (int row = 0; row < _rows; row++)
+	{
+		const float* values = matrix.data() + (row * matrix.get_stride());
+		for (int col = 0; col < _columns; col++)
+		{
+			_values[(row * _columns) + col] = narrow(values[col], _format);
+		}
+	}
+}
+
+// See documentation at header file
+int HalfMatrix::get_rows() const
+{
+	return _rows;
+}
+
+// See documentation at header file
+int HalfMatrix::get_cols() const
+{
+	return _columns;
+}
+
+// See documentation at header file
+half_format HalfMatrix::get_format() const
+{
+	return _format;
+}
+
+// See documentation at header file
+const uint16_t* HalfMatrix::data() const
+{
+	return _values.data();
+}
+
+// See documentation at header file
+Matrix HalfMatrix::to_matrix() const
+{
+	Matrix matrix(_rows, _columns);
+	widen(_values.data(), _rows * _columns, _format, matrix.data());
+	return matrix;
+}
+
+// See documentation at header file
+uint16_t HalfMatrix::narrow(float value, half_format format)
+{
+	if (half_format::FP16 == format)
+	{
+		return narrow_fp16(value);
+	}
+
+	const uint32_t bits = float_bits(value);
+	if ((bits & ~float_sign) > float_infinity)
+	{
+		// Keeping NaNs quiet, rounding could carry them to infinity
+		return static_cast<uint16_t>((bits >> bf16_dropped_bits) | 0x40U);
+	}
+
+	return static_cast<uint16_t>(round_bits(bits, bf16_dropped_bits));
+}
+
+// See documentation at header file
+float HalfMatrix::widen(uint16_t value, half_format format)
+{
+	return (half_format::FP16 == format) ?
+		widen_fp16(value) :
+		bits_float(static_cast<uint32_t>(value) << bf16_dropped_bits);
+}
+
+// See documentation at header file
+void HalfMatrix::widen(const uint16_t* values, int count, half_format format,
+					   float* result)
+{
+	int index = 0;
+#if SIMD_X86
+	switch (simd::active_isa())
+	{
+	case simd::isa::AVX512:
+		index = widen_avx512(values, count, format, result);
+		break;
+	case simd::isa::AVX2:
+		index = widen_avx2(values, count, format, result);
+		break;
+	default:
+		break;
+	}
+#endif
+
+	for (; index < count; index++)
+	{
+		result[index] = widen(values[index], format);
+	}
+}
@@ -0,0 +1,92 @@
+#ifndef HALFMATRIX_H
+#define HALFMATRIX_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Matrix.h"
+
+/**
+* 16-bit floating-point formats a HalfMatrix may store.
+*/
+enum class half_format
+{
+	// IEEE 754 half precision (5 exponent bits, 10 mantissa bits)
+	FP16 = 0,
+	// bfloat16, the upper half of a float (8 exponent bits,
+	// 7 mantissa bits)
+	BF16
+};
+
+/**
+* @class HalfMatrix
+ * @brief Read-only copy of a matrix in a 16-bit floating-point format,
+ *		  half the size of the float matrix. Values are rounded to the
+ *		  nearest representable value (ties to even) when converted,
+ *		  and widened back to float by the kernels reading them.
+ */
+class HalfMatrix
+{
+public:
+	/**
+	* Converts the given matrix.
+	* @param matrix - The matrix to convert.
+	* @param format - The format to store the values in.
+	*/
+	HalfMatrix(const Matrix& matrix, half_format format);
+
+	/**
+	* Getting the number of rows in the matrix.
+	*/
+	int get_rows() const;
+
+	/**
+	* Getting the number of columns in the matrix.
+	*/
+	int get_cols() const;
+
+	/**
+	* Getting the format of the stored values.
+	*/
+	half_format get_format() const;
+
+	/**
+	* Getting the stored values, row-major.
+	*/
+	const uint16_t* data() const;
+
+	/**
+	* Widening the matrix back to floating-point.
+	* @return The matrix of the stored values.
+	*/
+	Matrix to_matrix() const;
+
+	/**
+	* Converts a float to the given format, rounding to nearest even.
+	*/
+	static uint16_t narrow(float value, half_format format);
+
+	/**
+	* Converts a value of the given format to float (exactly).
+	*/
+	static float widen(uint16_t value, half_format format);
+
+	/**
+	* Widens consecutive values of the given format into floats, using
+	* the most capable instructions for the CPU (see simd::active_isa).
+	* @param values - The values to widen.
+	* @param count - The number of values.
+	* @param format - The format of the values.
+	* @param result - Output, the floats.
+	*/
+	static void widen(const uint16_t* values, int count, half_format format,
+					  float* result);
+
+private:
+	int _rows;
+	int _columns;
+	half_format _format;
+	std::vector<uint16_t> _values;
+};
+
+#endif //HALFMATRIX_H
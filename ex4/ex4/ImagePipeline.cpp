@@ -0,0 +1,196 @@
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include "ImagePipeline.h"
+
+// Exception descriptions
+#define INVALID_PIPELINE_EX ("Invalid pipeline slot or reader count")
+
+/**
+* Checks a slot or reader count.
+* @throws std::length_error in case the count is not positive.
+* @return The count.
+*/
+static int checked_count(int count)
+{
+	if (0 >= count)
+	{
+		throw std::length_error(INVALID_PIPELINE_EX);
+	}
+
+	return count;
+}
+
+// See documentation at header file
+ImagePipeline::ImagePipeline(const MlpNetwork& network, int slots,
+							 int readers) :
+	_network(network),
+	_image_size(network.get_input_size()),
+	_slots(checked_count(slots)),
+	_readers(checked_count(readers)),
+	_ring(_slots, _image_size),
+	_paths(static_cast<size_t>(_slots)),
+	_states(_paths.size(), slot_state::EMPTY),
+	_workspace(network, _slots),
+	_results(_paths.size()),
+	_taken(0),
+	_delivered(0),
+	_paths_ended(false),
+	_stopping(false)
+{}
+
+// See documentation at header file
+long ImagePipeline::run(std::istream& paths, const Callback& on_result)
+{
+	_taken = 0;
+	_delivered = 0;
+	_paths_ended = false;
+	_stopping = false;
+	std::fill(_states.begin(), _states.end(), slot_state::EMPTY);
+
+	std::vector<std::thread> readers;
+	for (int index = 0; index < _readers; index++)
+	{
+		readers.emplace_back(&ImagePipeline::read_images, this,
+							 std::ref(paths));
+	}
+
+	// Stops the readers on every exit, so none outlives the call
+	const auto stop = [&]()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stopping = true;
+		}
+		_freed.notify_all();
+		for (auto& reader : readers)
+		{
+			reader.join();
+		}
+	};
+
+	try
+	{
+		while (true)
+		{
+			int first = 0;
+			int count = 1;
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				first = static_cast<int>(_delivered % _slots);
+				_read.wait(lock, [&]()
+				{
+					return (slot_state::READY == _states[first]) ||
+						   (slot_state::FAILED == _states[first]) ||
+						   (_paths_ended && (_delivered == _taken));
+				});
+				if (_delivered == _taken)
+				{
+					break;
+				}
+				if (slot_state::FAILED == _states[first])
+				{
+					throw std::invalid_argument(INVALID_IMAGE_PATH_EX +
+												_paths[first]);
+				}
+
+				// Every consecutive read image, up to the ring end
+				while ((first + count < _slots) &&
+					   (_delivered + count < _taken) &&
+					   (slot_state::READY == _states[first + count]))
+				{
+					count++;
+				}
+			}
+
+			// Read slots are left alone by the readers until freed
+			const float* images = _ring.data() +
+								  (static_cast<size_t>(first) * _image_size);
+			// The images are rows of the ring, the network takes columns
+			_network.forward(MatrixView(images, _image_size, count,
+										_image_size, true),
+							 _workspace, _results.data());
+			for (int index = 0; index < count; index++)
+			{
+				on_result(_paths[first + index],
+						  images + (static_cast<size_t>(index) * _image_size),
+						  _results[index]);
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				std::fill(_states.begin() + first,
+						  _states.begin() + first + count, slot_state::EMPTY);
+				_delivered += count;
+			}
+			_freed.notify_all();
+		}
+	}
+	catch (...)
+	{
+		stop();
+		throw;
+	}
+
+	stop();
+	return _delivered;
+}
+
+// See documentation at header file
+void ImagePipeline::read_images(std::istream& paths)
+{
+	while (true)
+	{
+		int slot = 0;
+		{
+			std::lock_guard<std::mutex> input(_input_mutex);
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				_freed.wait(lock, [this]()
+				{
+					return _stopping || _paths_ended ||
+						   (_taken - _delivered < _slots);
+				});
+				if (_stopping || _paths_ended)
+				{
+					return;
+				}
+			}
+
+			// Only this reader takes slots until it claims one, so the
+			// free slot stays free while the path is read
+			std::string path;
+			const bool ended = !(paths >> path) || (PIPELINE_QUIT == path);
+
+			std::lock_guard<std::mutex> lock(_mutex);
+			if (ended)
+			{
+				_paths_ended = true;
+				_read.notify_all();
+				_freed.notify_all();
+				return;
+			}
+
+			slot = static_cast<int>(_taken % _slots);
+			_taken++;
+			_paths[slot] = std::move(path);
+			_states[slot] = slot_state::READING;
+		}
+
+		// The slot belongs to this reader until marked read
+		std::ifstream file(_paths[slot], std::ios::binary);
+		file.read(reinterpret_cast<char*>(
+					  _ring.data() + (static_cast<size_t>(slot) * _image_size)),
+				  static_cast<std::streamsize>(sizeof(float) * _image_size));
+		const bool valid = file.good();
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_states[slot] = valid ? slot_state::READY : slot_state::FAILED;
+		}
+		_read.notify_all();
+	}
+}
@@ -0,0 +1,137 @@
+#ifndef IMAGEPIPELINE_H
+#define IMAGEPIPELINE_H
+
+#include <condition_variable>
+#include <functional>
+#include <istream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "MlpNetwork.h"
+
+// Image buffers of the default ring, the most images read ahead
+constexpr int PIPELINE_SLOTS = 64;
+// Default reader threads, reading images concurrently
+constexpr int PIPELINE_READERS = 4;
+// Path ending a stream of paths before the end of the input
+#define PIPELINE_QUIT ("q")
+#define INVALID_IMAGE_PATH_EX ("Error: invalid image path or size: ")
+
+/**
+ * @class ImagePipeline
+ * @brief Classifies a stream of image paths in two overlapping stages.
+ *		  Reader threads take the next path, and read and decode its
+ *		  image into a ring of preallocated image buffers, while the
+ *		  calling thread classifies every run of consecutive read
+ *		  images as a single batch. The ring bounds how far the
+ *		  readers get ahead, so file reads are hidden behind inference
+ *		  (and behind each other) with a fixed amount of memory.
+ *		  Results are delivered in input order.
+ */
+class ImagePipeline
+{
+public:
+	/**
+	* Called with every classified image, in input order.
+	* @param path - The image path.
+	* @param image - The image pixels (the network input size), only
+	*				 valid during the call.
+	* @param result - The network result.
+	*/
+	using Callback = std::function<void(const std::string& path,
+										const float* image,
+										const digit& result)>;
+
+	/**
+	* Allocates the ring and the inference workspace.
+	* @param network - The network to classify with, must outlive
+	*				   the pipeline.
+	* @param slots - The number of image buffers of the ring.
+	* @param readers - The number of reader threads.
+	* @throws std::length_error in case slots or readers is not positive.
+	*/
+	ImagePipeline(const MlpNetwork& network, int slots = PIPELINE_SLOTS,
+				  int readers = PIPELINE_READERS);
+
+	// Explicitly defining behavior to prevent implicit behavior
+	ImagePipeline() = delete;
+	ImagePipeline(const ImagePipeline&) = delete;
+	ImagePipeline& operator=(const ImagePipeline&) = delete;
+	~ImagePipeline() = default;
+
+	/**
+	* Classifies the images of a stream of whitespace separated paths,
+	* such as the standard input or a manifest file, up to its end or
+	* a PIPELINE_QUIT path. The readers run only during the call.
+	* Not safe to call concurrently on the same pipeline.
+	* @param paths - The stream of paths.
+	* @param on_result - Called with every result, in input order.
+	* @throws std::invalid_argument in case an image cannot be read,
+	*		  after every previous image was delivered. Any exception
+	*		  of on_result stops the pipeline and is rethrown.
+	* @return The number of classified images.
+	*/
+	long run(std::istream& paths, const Callback& on_result);
+
+private:
+	/**
+	* State of a ring slot.
+	*/
+	enum class slot_state
+	{
+		// Free, waiting for the next path
+		EMPTY = 0,
+		// Taken by a reader
+		READING,
+		// Holding a read image
+		READY,
+		// Its image could not be read
+		FAILED
+	};
+
+	/**
+	* Reader thread body, reads images into free slots until the
+	* paths end or the pipeline stops.
+	*/
+	void read_images(std::istream& paths);
+
+	// The shared, read-only network
+	const MlpNetwork& _network;
+	// The number of image pixels
+	const int _image_size;
+	// The number of ring slots
+	const int _slots;
+	// The number of reader threads
+	const int _readers;
+	// The ring, an image per row
+	Matrix _ring;
+	// The path of the image in every slot
+	std::vector<std::string> _paths;
+	std::vector<slot_state> _states;
+	// Layer outputs of a batch of up to a whole ring
+	Workspace _workspace;
+	std::vector<digit> _results;
+
+	// Held by a reader from taking a path to claiming its slot, so the
+	// paths take slots in input order. Reading a path may block (such
+	// as on an interactive standard input), so this is not _mutex,
+	// which inference takes to deliver the images already read.
+	std::mutex _input_mutex;
+	// Guards the ring states and the counts below
+	std::mutex _mutex;
+	// Signalled whenever a slot is read, and when the paths end
+	std::condition_variable _read;
+	// Signalled whenever slots are freed, and on stop
+	std::condition_variable _freed;
+	// Sequence number of the next path taken
+	long _taken;
+	// Sequence number of the next image delivered
+	long _delivered;
+	// Whether the paths ended
+	bool _paths_ended;
+	// Whether the readers must stop before the paths end
+	bool _stopping;
+};
+
+#endif //IMAGEPIPELINE_H
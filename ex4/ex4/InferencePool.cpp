@@ -0,0 +1,147 @@
+#include <exception>
+#include <stdexcept>
+#include <utility>
+
+#include "InferencePool.h"
+
+// Exception descriptions
+#define INVALID_WORKERS_EX ("Invalid worker count")
+
+// See documentation at header file
+InferencePool::InferencePool(const MlpNetwork& network, int workers) :
+	_network(network),
+	_stopping(false)
+{
+	if (0 >= workers)
+	{
+		throw std::length_error(INVALID_WORKERS_EX);
+	}
+
+	_workers.reserve(static_cast<size_t>(workers));
+	try
+	{
+		for (int index = 0; index < workers; index++)
+		{
+			_workers.emplace_back(&InferencePool::work, this);
+		}
+	}
+	catch (...)
+	{
+		// The destructor does not run, the started workers are joined
+		// here (destroying a joinable thread terminates)
+		stop();
+		throw;
+	}
+}
+
+// See documentation at header file
+InferencePool::~InferencePool()
+{
+	stop();
+}
+
+// See documentation at header file
+void InferencePool::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_queued.notify_all();
+
+	for (auto& worker : _workers)
+	{
+		worker.join();
+	}
+}
+
+// See documentation at header file
+int InferencePool::get_workers() const
+{
+	return static_cast<int>(_workers.size());
+}
+
+// See documentation at header file
+std::future<digit> InferencePool::submit(Matrix image)
+{
+	if (_network.get_input_size() != image.get_rows() * image.get_cols())
+	{
+		throw std::length_error(INVALID_IMAGE_EX);
+	}
+
+	// The workers read the image as a single buffer
+	if (!image.is_packed())
+	{
+		image.vectorize();
+	}
+
+	std::promise<digit> result;
+	std::future<digit> future = result.get_future();
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_queue.push_back({std::move(image), std::move(result)});
+	}
+	_queued.notify_one();
+
+	return future;
+}
+
+// See documentation at header file
+std::vector<digit> InferencePool::classify(const std::vector<Matrix>& images)
+{
+	std::vector<std::future<digit>> futures;
+	futures.reserve(images.size());
+	for (const auto& image : images)
+	{
+		futures.push_back(submit(image));
+	}
+
+	std::vector<digit> results;
+	results.reserve(images.size());
+	for (auto& future : futures)
+	{
+		results.push_back(future.get());
+	}
+
+	return results;
+}
+
+// See documentation at header file
+void InferencePool::work()
+{
+	// Every worker owns its scratch buffers, so the workers share
+	// nothing but the read-only network
+	Workspace workspace(_network);
+	// Reused by every job, so taking a job allocates nothing
+	job current;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_queued.wait(lock, [this]()
+			{
+				return _stopping || !_queue.empty();
+			});
+			// Stopping only once the queue is drained
+			if (_queue.empty())
+			{
+				return;
+			}
+
+			current = std::move(_queue.front());
+			_queue.pop_front();
+		}
+
+		// A failed image fails its own future, not the worker
+		try
+		{
+			const Matrix& image = current.image;
+			current.result.set_value(
+				_network.forward(image.data(), workspace));
+		}
+		catch (...)
+		{
+			current.result.set_exception(std::current_exception());
+		}
+	}
+}
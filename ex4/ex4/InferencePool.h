@@ -0,0 +1,107 @@
+#ifndef INFERENCEPOOL_H
+#define INFERENCEPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "MlpNetwork.h"
+
+/**
+ * @class InferencePool
+ * @brief Worker threads classifying images with one shared network.
+ *		  Images are queued by submit, and every worker pulls the next
+ *		  queued image and runs it through the network with its own
+ *		  Workspace. The network is only read, so it is never copied
+ *		  or locked (see MlpNetwork).
+ *		  Every submitted image gets a future of its result, so
+ *		  results are collected in input order whatever the order the
+ *		  workers finish in.
+ */
+class InferencePool
+{
+public:
+	/**
+	* Starts the workers.
+	* @param network - The network to classify with, must outlive
+	*				   the pool.
+	* @param workers - The number of worker threads.
+	* @throws std::length_error in case workers is not positive.
+	*		  std::system_error in case a thread cannot be started,
+	*		  after the started ones are stopped.
+	*/
+	InferencePool(const MlpNetwork& network, int workers);
+
+	// Explicitly defining behavior to prevent implicit behavior
+	InferencePool() = delete;
+	InferencePool(const InferencePool&) = delete;
+	InferencePool& operator=(const InferencePool&) = delete;
+
+	/**
+	* Finishes every queued image, then stops the workers.
+	*/
+	~InferencePool();
+
+	/**
+	* Gets the number of worker threads.
+	*/
+	int get_workers() const;
+
+	/**
+	* Queues an image for classification.
+	* @param image - The image to classify, of the network input size.
+	*				 The pool keeps it until it is classified.
+	* @throws std::length_error in case the image size is not the
+	*		  network input size.
+	* @return The future result of the image, holding the exception
+	*		   in case classifying it failed.
+	*/
+	std::future<digit> submit(Matrix image);
+
+	/**
+	* Classifies images on the workers and waits for all of them.
+	* @param images - The images to classify.
+	* @throws std::length_error in case an image size is not the
+	*		  network input size.
+	* @return The results, one per image, in input order.
+	*/
+	std::vector<digit> classify(const std::vector<Matrix>& images);
+
+private:
+	/**
+	 * @struct job
+	 * @brief A queued image and the promise of its result.
+	 * @var image - The image to classify.
+	 * @var result - Fulfilled by the worker classifying the image.
+	 */
+	typedef struct job
+	{
+		Matrix image;
+		std::promise<digit> result;
+	} job;
+
+	/**
+	* Worker thread body, classifies queued images until stopped.
+	*/
+	void work();
+
+	/**
+	* Stops the started workers, once the queue is drained.
+	*/
+	void stop();
+
+	// The shared, read-only network
+	const MlpNetwork& _network;
+	// Guards the queue and the stop flag
+	std::mutex _mutex;
+	// Signalled on every queued job, and on stop
+	std::condition_variable _queued;
+	std::deque<job> _queue;
+	bool _stopping;
+	std::vector<std::thread> _workers;
+};
+
+#endif //INFERENCEPOOL_H
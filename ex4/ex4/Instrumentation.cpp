@@ -0,0 +1,103 @@
+#include "Instrumentation.h"
+
+// Next thread slot to assign
+static std::atomic<int> next_thread_slot(0);
+
+// See documentation at header file
+instrumentation::Counters::Counters()
+{
+	reset();
+}
+
+// See documentation at header file
+int instrumentation::Counters::thread_slot()
+{
+	thread_local const int slot =
+		next_thread_slot.fetch_add(1, std::memory_order_relaxed) %
+		THREAD_SLOTS;
+	return slot;
+}
+
+// See documentation at header file
+void instrumentation::Counters::add_call(int samples, uint64_t flops,
+										 uint64_t bytes)
+{
+	slot& counters = _slots[thread_slot()];
+	counters.calls.fetch_add(1, std::memory_order_relaxed);
+	counters.samples.fetch_add(static_cast<uint64_t>(samples),
+							   std::memory_order_relaxed);
+	counters.flops.fetch_add(flops, std::memory_order_relaxed);
+	counters.bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+// See documentation at header file
+void instrumentation::Counters::add_time(step phase, uint64_t nanoseconds)
+{
+	_slots[thread_slot()].nanoseconds[static_cast<int>(phase)].fetch_add(
+		nanoseconds, std::memory_order_relaxed);
+}
+
+// See documentation at header file
+instrumentation::layer_counters instrumentation::Counters::read() const
+{
+	layer_counters sum = {};
+	for (const slot& counters : _slots)
+	{
+		sum.calls += counters.calls.load(std::memory_order_relaxed);
+		sum.samples += counters.samples.load(std::memory_order_relaxed);
+		sum.flops += counters.flops.load(std::memory_order_relaxed);
+		sum.bytes += counters.bytes.load(std::memory_order_relaxed);
+		for (int phase = 0; phase < STEP_COUNT; phase++)
+		{
+			sum.nanoseconds[phase] +=
+				counters.nanoseconds[phase].load(std::memory_order_relaxed);
+		}
+	}
+
+	return sum;
+}
+
+// See documentation at header file
+void instrumentation::Counters::reset()
+{
+	for (slot& counters : _slots)
+	{
+		counters.calls.store(0, std::memory_order_relaxed);
+		counters.samples.store(0, std::memory_order_relaxed);
+		counters.flops.store(0, std::memory_order_relaxed);
+		counters.bytes.store(0, std::memory_order_relaxed);
+		for (auto& nanoseconds : counters.nanoseconds)
+		{
+			nanoseconds.store(0, std::memory_order_relaxed);
+		}
+	}
+}
+
+// See documentation at header file
+instrumentation::ScopedTimer::ScopedTimer(Counters& counters, step phase) :
+	_counters(counters),
+	_phase(phase),
+	_start(std::chrono::steady_clock::now())
+{}
+
+// See documentation at header file
+instrumentation::ScopedTimer::~ScopedTimer()
+{
+	_counters.add_time(_phase, static_cast<uint64_t>(
+		std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - _start).count()));
+}
+
+// See documentation at header file
+void instrumentation::accumulate(layer_counters& lhs,
+								 const layer_counters& rhs)
+{
+	lhs.calls += rhs.calls;
+	lhs.samples += rhs.samples;
+	lhs.flops += rhs.flops;
+	lhs.bytes += rhs.bytes;
+	for (int phase = 0; phase < STEP_COUNT; phase++)
+	{
+		lhs.nanoseconds[phase] += rhs.nanoseconds[phase];
+	}
+}
@@ -0,0 +1,191 @@
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Whether Dense and MlpNetwork count their work. When 0 (the default)
+// every hook compiles out, with no counters, clock reads or branches
+#ifndef MLP_INSTRUMENTATION
+#define MLP_INSTRUMENTATION 0
+#endif
+
+// Hook statement, only compiled in when MLP_INSTRUMENTATION is set
+#if MLP_INSTRUMENTATION
+#define MLP_INSTRUMENT(statement) statement
+#else
+#define MLP_INSTRUMENT(statement)
+#endif
+
+/**
+* Per-layer counters of calls, samples, FLOPs, bytes and wall time.
+* Every thread adds to its own slot of a layer's counters, with relaxed
+* atomics and no locks, and a snapshot sums the slots.
+*/
+namespace instrumentation
+{
+	// Whether the hooks are compiled in
+	constexpr bool ENABLED = (0 != MLP_INSTRUMENTATION);
+	// Counter slots of a layer, threads beyond share slots (atomically)
+	constexpr int THREAD_SLOTS = 16;
+
+	/**
+	* Timed steps of a layer.
+	*/
+	enum class step
+	{
+		// The weights product, with the bias and ReLU fused into it
+		PRODUCT = 0,
+		// Any activation applied after the product, such as Softmax
+		ACTIVATION,
+		COUNT
+	};
+
+	// Number of timed steps
+	constexpr int STEP_COUNT = static_cast<int>(step::COUNT);
+
+	/**
+	 * @struct layer_counters
+	 * @brief The work counted for a layer.
+	 * @var calls - The number of forward calls.
+	 * @var samples - The number of samples (batch columns) computed.
+	 * @var flops - The floating-point operations of the products,
+	 *				bias and ReLU.
+	 * @var bytes - The bytes of weights, bias, input and output read
+	 *				or written, once per call.
+	 * @var nanoseconds - The wall time of every step, by step index.
+	 */
+	typedef struct layer_counters
+	{
+		uint64_t calls;
+		uint64_t samples;
+		uint64_t flops;
+		uint64_t bytes;
+		uint64_t nanoseconds[STEP_COUNT];
+	} layer_counters;
+
+	/**
+	 * @struct snapshot
+	 * @brief The counters of every layer of a network.
+	 * @var enabled - Whether the hooks are compiled in, the counters
+	 *				  are all 0 otherwise.
+	 * @var layers - The counters of every layer, in order.
+	 * @var total - The sum of the counters of every layer.
+	 */
+	typedef struct snapshot
+	{
+		bool enabled;
+		std::vector<layer_counters> layers;
+		layer_counters total;
+	} snapshot;
+
+	/**
+	 * @class Counters
+	 * @brief The counters of a layer, one slot per thread. Adding is
+	 *		  safe from any number of threads, reading sums the slots
+	 *		  and may miss additions made concurrently.
+	 */
+	class Counters
+	{
+	public:
+		/**
+		* Constructs counters at 0.
+		*/
+		Counters();
+
+		// Explicitly defining behavior to prevent implicit behavior
+		Counters(const Counters&) = delete;
+		Counters& operator=(const Counters&) = delete;
+		~Counters() = default;
+
+		/**
+		* Counts a forward call.
+		* @param samples - The samples computed by the call.
+		* @param flops - The floating-point operations of the call.
+		* @param bytes - The bytes read or written by the call.
+		*/
+		void add_call(int samples, uint64_t flops, uint64_t bytes);
+
+		/**
+		* Adds wall time to a step.
+		* @param phase - The timed step.
+		* @param nanoseconds - The time to add.
+		*/
+		void add_time(step phase, uint64_t nanoseconds);
+
+		/**
+		* Sums the counters of every thread.
+		* @return The counters.
+		*/
+		layer_counters read() const;
+
+		/**
+		* Sets every counter back to 0.
+		*/
+		void reset();
+
+	private:
+		/**
+		 * @struct slot
+		 * @brief The counters of a thread, padded so the counters of two
+		 *		  slots never share a cache line, whatever the alignment.
+		 */
+		typedef struct slot
+		{
+			std::atomic<uint64_t> calls;
+			std::atomic<uint64_t> samples;
+			std::atomic<uint64_t> flops;
+			std::atomic<uint64_t> bytes;
+			std::atomic<uint64_t> nanoseconds[STEP_COUNT];
+			char padding[128 - ((4 + STEP_COUNT) * sizeof(uint64_t))];
+		} slot;
+
+		// The slots, indexed by the thread slot
+		slot _slots[THREAD_SLOTS];
+
+		/**
+		* Gets the slot of the calling thread, assigned on its first call.
+		*/
+		static int thread_slot();
+	};
+
+	/**
+	 * @class ScopedTimer
+	 * @brief Adds the wall time of its scope to a step of a layer.
+	 */
+	class ScopedTimer
+	{
+	public:
+		/**
+		* Starts timing.
+		* @param counters - The counters to add the time to.
+		* @param phase - The timed step.
+		*/
+		ScopedTimer(Counters& counters, step phase);
+
+		// Explicitly defining behavior to prevent implicit behavior
+		ScopedTimer(const ScopedTimer&) = delete;
+		ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+		/**
+		* Stops timing, adding the elapsed time.
+		*/
+		~ScopedTimer();
+
+	private:
+		Counters& _counters;
+		const step _phase;
+		const std::chrono::steady_clock::time_point _start;
+	};
+
+	/**
+	* Sums layer counters.
+	* @param lhs - The counters to add to.
+	* @param rhs - The counters to add.
+	*/
+	void accumulate(layer_counters& lhs, const layer_counters& rhs);
+}
+
+#endif //INSTRUMENTATION_H
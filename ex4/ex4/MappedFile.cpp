@@ -0,0 +1,122 @@
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+#include "MappedFile.h"
+
+#if MAPPED_FILE_POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Exception descriptions
+#define OPEN_FAILED_EX ("Failed to open file: ")
+#define MAP_FAILED_EX ("Failed to map file: ")
+#define READ_INSUFFICIENT_DATA_EX ("Failed to read sufficient data")
+
+#if MAPPED_FILE_POSIX
+
+// See documentation at header file
+MappedFile::MappedFile(const std::string& path) :
+	_data(nullptr),
+	_size(0)
+{
+	const int descriptor = open(path.c_str(), O_RDONLY);
+	if (0 > descriptor)
+	{
+		throw std::runtime_error(OPEN_FAILED_EX + path);
+	}
+
+	struct stat status = {};
+	if (0 != fstat(descriptor, &status))
+	{
+		close(descriptor);
+		throw std::runtime_error(OPEN_FAILED_EX + path);
+	}
+
+	_size = static_cast<size_t>(status.st_size);
+	if (0 != _size)
+	{
+		void* mapped = mmap(nullptr, _size, PROT_READ, MAP_SHARED,
+							descriptor, 0);
+		if (MAP_FAILED == mapped)
+		{
+			close(descriptor);
+			throw std::runtime_error(MAP_FAILED_EX + path);
+		}
+		_data = mapped;
+	}
+
+	// The mapping holds its own reference to the file
+	close(descriptor);
+}
+
+// See documentation at header file
+MappedFile::~MappedFile()
+{
+	if (nullptr != _data)
+	{
+		munmap(const_cast<void*>(_data), _size);
+	}
+}
+
+#else
+
+// See documentation at header file
+MappedFile::MappedFile(const std::string& path) :
+	_data(nullptr),
+	_size(0)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file.good())
+	{
+		throw std::runtime_error(OPEN_FAILED_EX + path);
+	}
+
+	_contents.resize(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+	file.read(_contents.data(),
+			  static_cast<std::streamsize>(_contents.size()));
+	if (!file.good())
+	{
+		throw std::runtime_error(MAP_FAILED_EX + path);
+	}
+
+	_size = _contents.size();
+	_data = _contents.empty() ? nullptr : _contents.data();
+}
+
+// See documentation at header file
+MappedFile::~MappedFile() = default;
+
+#endif
+
+// See documentation at header file
+const void* MappedFile::data() const
+{
+	return _data;
+}
+
+// See documentation at header file
+size_t MappedFile::size() const
+{
+	return _size;
+}
+
+// See documentation at header file
+Matrix map_matrix(const std::string& path, const matrix_dims& dims)
+{
+	auto file = std::make_shared<const MappedFile>(path);
+	const size_t required =
+		sizeof(float) * static_cast<size_t>(dims.rows) * dims.cols;
+	if (file->size() < required)
+	{
+		throw std::runtime_error(READ_INSUFFICIENT_DATA_EX);
+	}
+
+	const float* data = static_cast<const float*>(file->data());
+	return Matrix(dims.rows, dims.cols, data, std::move(file));
+}
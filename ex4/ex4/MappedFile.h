@@ -0,0 +1,81 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "Matrix.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MAPPED_FILE_POSIX 1
+#else
+#define MAPPED_FILE_POSIX 0
+#endif
+
+/**
+ * @class MappedFile
+ * @brief A whole file mapped read-only into memory, unmapped on
+ *		  destruction. Pages are loaded on first access and shared
+ *		  with every other process mapping the same file.
+ *		  Where memory mapping is unavailable, the file is read into
+ *		  memory in a single read instead.
+ */
+class MappedFile
+{
+public:
+	/**
+	* Maps the given file.
+	* @param path - The file to map.
+	* @throws std::runtime_error in case the file cannot be opened
+	*		  or mapped.
+	*/
+	explicit MappedFile(const std::string& path);
+
+	// Explicitly defining behavior to prevent implicit behavior
+	MappedFile() = delete;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	/**
+	* Destructor, unmapping the file.
+	*/
+	~MappedFile();
+
+	/**
+	* Getting the mapped contents of the file.
+	* @return The first byte of the file, nullptr for an empty file.
+	*/
+	const void* data() const;
+
+	/**
+	* Getting the size of the file.
+	* @return The size in bytes.
+	*/
+	size_t size() const;
+
+private:
+	// The mapped contents
+	const void* _data;
+	// The size of the contents in bytes
+	size_t _size;
+#if !MAPPED_FILE_POSIX
+	// The contents, when read instead of mapped
+	std::vector<char> _contents;
+#endif
+};
+
+/**
+* Loads a matrix of binary floats (rows stored one after the other)
+* from a file, by mapping the file and building the matrix directly
+* on the mapped pages, without copying or reading them. The mapping
+* lives as long as the matrix or any of its copies uses it.
+* @param path - The file to load.
+* @param dims - The dimensions of the matrix.
+* @throws std::runtime_error in case the file cannot be mapped or
+*		  is too small for the matrix.
+* @return The matrix, borrowing the mapped memory.
+*/
+Matrix map_matrix(const std::string& path, const matrix_dims& dims);
+
+#endif //MAPPEDFILE_H
@@ -1,20 +1,38 @@
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <utility>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
 
 #include "Matrix.h"
+#include "Gemm.h"
+#include "Gemv.h"
+#include "MatrixView.h"
+#include "Transposition.h"
 
 // Exception descriptions
-#define INCOMPATIBLE_DIMENSIONS_EX ("Dimensions incompatible")
 #define INVALID_DIMENSIONS_EX ("Invalid Matrix Dimensions")
-#define INVALID_INDEX_EX ("Invalid matrix index")
 #define READ_INSUFFICIENT_DATA_EX ("Failed to read sufficient data")
 #define MATRIX_VALUE_PRINT_THRESHOLD ("**")
 #define MATRIX_VALUE_PRINT_EMPTY ("  ")
 
-// Quadratic floating-point power
-constexpr float quadratic_power = 2.0F;
 // Minimal value threshold for output of a matrix
 constexpr float matrix_value_threshold = 0.1F;
 
+/**
+* Rounds a column count up to Matrix::PADDING.
+*/
+static int padded_stride(int cols)
+{
+	return ((cols + Matrix::PADDING - 1) / Matrix::PADDING) * Matrix::PADDING;
+}
+
 // See documentation at header file
 Matrix::Matrix() :
 	Matrix(1, 1)
@@ -22,29 +40,94 @@ Matrix::Matrix() :
 
 // See documentation at header file
 Matrix::Matrix(int rows, int cols) :
+	Matrix(rows, cols, matrix_layout::PACKED)
+{}
+
+// See documentation at header file
+Matrix::Matrix(int rows, int cols, matrix_layout layout) :
 	_rmatrix(nullptr),
 	_rows(rows), 
-	_columns(cols)
+	_columns(cols),
+	_stride((matrix_layout::PADDED == layout) ? padded_stride(cols) : cols)
 {
 	if ((0 >= _rows) || (0 >= _columns))
 	{
 		throw std::length_error(INVALID_DIMENSIONS_EX);
 	}
 
-	_rmatrix = new float[rows * cols]();
+	_rmatrix = allocate(rows * _stride, true, layout);
+}
+
+// See documentation at header file
+Matrix::Matrix(const Matrix& matrix, matrix_layout layout) :
+	Matrix(matrix._rows, matrix._columns, layout)
+{
+	copy_matrix(matrix);
+}
+
+// See documentation at header file
+Matrix::Matrix(int rows, int cols, const float* data,
+			   std::shared_ptr<const void> owner) :
+	// Borrowed memory is never written, see detach
+	_rmatrix(const_cast<float*>(data)),
+	_rows(rows),
+	_columns(cols),
+	_stride(cols),
+	_owner(std::move(owner))
+{
+	if ((0 >= _rows) || (0 >= _columns))
+	{
+		throw std::length_error(INVALID_DIMENSIONS_EX);
+	}
+
+	if (nullptr == _owner)
+	{
+		_rmatrix = allocate(_rows * _columns, false);
+		std::copy(data, data + (_rows * _columns), _rmatrix);
+	}
 }
 
 // See documentation at header file
 Matrix::Matrix(const Matrix& matrix) :
-	Matrix(matrix.get_rows(), matrix.get_cols())
+	_rmatrix(matrix._rmatrix),
+	_rows(matrix._rows),
+	_columns(matrix._columns),
+	_stride(matrix._columns),
+	_owner(matrix._owner)
 {
+	// Borrowed memory is read-only, so copies may share it
+	if (nullptr != _owner)
+	{
+		return;
+	}
+
+	if ((0 >= _rows) || (0 >= _columns))
+	{
+		throw std::length_error(INVALID_DIMENSIONS_EX);
+	}
+
+	_rmatrix = allocate(_rows * _columns, false);
 	copy_matrix(matrix);
 }
 
+// See documentation at header file
+Matrix::Matrix(Matrix&& matrix) noexcept :
+	_rmatrix(matrix._rmatrix),
+	_rows(matrix._rows),
+	_columns(matrix._columns),
+	_stride(matrix._stride),
+	_owner(std::move(matrix._owner))
+{
+	matrix._rmatrix = nullptr;
+	matrix._rows = 0;
+	matrix._columns = 0;
+	matrix._stride = 0;
+}
+
 // See documentation at header file
 Matrix::~Matrix()
 {
-	delete[] _rmatrix;
+	release();
 }
 
 // See documentation at header file
@@ -59,28 +142,53 @@ int Matrix::get_cols() const
 	return _columns;
 }
 
+// See documentation at header file
+int Matrix::get_stride() const
+{
+	return _stride;
+}
+
+// See documentation at header file
+bool Matrix::is_packed() const
+{
+	return (_stride == _columns) || (1 == _rows);
+}
+
+// See documentation at header file
+float* Matrix::data()
+{
+	detach();
+	return _rmatrix;
+}
+
+// See documentation at header file
+const float* Matrix::data() const
+{
+	return _rmatrix;
+}
+
+// See documentation at header file
+bool Matrix::is_borrowed() const
+{
+	return nullptr != _owner;
+}
+
 // See documentation at header file
 Matrix& Matrix::transpose()
 {
-	float* new_matrix = new float[_columns * _rows]();
-	for (int row_index = 0; row_index < _rows; row_index++)
+	if (_stride != _columns)
 	{
-		for (int column_index = 0;
-			column_index < _columns;
-			column_index++)
-		{
-			new_matrix[
-				coord_to_index(column_index, row_index, _rows)
-			] = operator()(row_index, column_index);
-		}
+		Matrix transposed(_columns, _rows, matrix_layout::PADDED);
+		transposition::out_of_place(_rows, _columns, _rmatrix, _stride,
+									transposed._rmatrix, transposed._stride);
+		return *this = std::move(transposed);
 	}
 
-	// Transferring ownership over to the new transposed matrix
-	delete[] _rmatrix;
-	auto temp_new_cols = _rows;
-	_rows = _columns;
-	_columns = temp_new_cols;
-	_rmatrix = new_matrix;
+	// In place, so no second buffer is held while transposing
+	detach();
+	transposition::in_place(_rows, _columns, _rmatrix);
+	std::swap(_rows, _columns);
+	_stride = _columns;
 
 	return *this;
 }
@@ -88,8 +196,18 @@ Matrix& Matrix::transpose()
 // See documentation at header file
 Matrix& Matrix::vectorize()
 {
+	// Rows only move towards the start, so they are never overwritten
+	// before they are moved
+	for (int row = 1; (_stride != _columns) && (row < _rows); row++)
+	{
+		std::copy(_rmatrix + (row * _stride),
+				  _rmatrix + (row * _stride) + _columns,
+				  _rmatrix + (row * _columns));
+	}
+
 	_rows = _columns * _rows;
 	_columns = 1;
+	_stride = 1;
 	return *this;
 }
 
@@ -137,10 +255,16 @@ Matrix Matrix::dot(Matrix& in) const
 // See documentation at header file
 float Matrix::norm() const
 {
+	if (is_packed())
+	{
+		return std::sqrt(reduction::sum_of_squares(data(), _rows * _columns));
+	}
+
 	float quadratic_sum = 0;
-	for (int index = 0; index < _rows * _columns; index++)
+	for (int row = 0; row < _rows; row++)
 	{
-		quadratic_sum += std::pow(_rmatrix[index], quadratic_power);
+		quadratic_sum += reduction::sum_of_squares(_rmatrix + (row * _stride),
+												   _columns);
 	}
 
 	return std::sqrt(quadratic_sum);
@@ -149,25 +273,45 @@ float Matrix::norm() const
 // See documentation at header file
 int Matrix::argmax() const
 {
-	int current_max = 0;
-	for (int index = 0; index < _rows * _columns; index++)
+	return max_with_index().index;
+}
+
+// See documentation at header file
+reduction::indexed_max Matrix::max_with_index() const
+{
+	if (is_packed())
 	{
-		if (_rmatrix[current_max] < _rmatrix[index])
+		return reduction::argmax(data(), _rows * _columns);
+	}
+
+	// The first row holding the maximum holds its first occurrence
+	reduction::indexed_max maximum = reduction::argmax(_rmatrix, _columns);
+	for (int row = 1; row < _rows; row++)
+	{
+		const reduction::indexed_max row_maximum =
+			reduction::argmax(_rmatrix + (row * _stride), _columns);
+		if (maximum.value < row_maximum.value)
 		{
-			current_max = index;
+			maximum = {(row * _columns) + row_maximum.index,
+					   row_maximum.value};
 		}
 	}
 
-	return current_max;
+	return maximum;
 }
 
 // See documentation at header file
 float Matrix::sum() const
 {
+	if (is_packed())
+	{
+		return reduction::sum(data(), _rows * _columns);
+	}
+
 	float matrix_sum = 0;
-	for (int index = 0; index < _rows * _columns; index++)
+	for (int row = 0; row < _rows; row++)
 	{
-		matrix_sum += _rmatrix[index];
+		matrix_sum += reduction::sum(_rmatrix + (row * _stride), _columns);
 	}
 
 	return matrix_sum;
@@ -181,9 +325,15 @@ Matrix& Matrix::operator+=(const Matrix& rhs)
 		throw std::length_error(INCOMPATIBLE_DIMENSIONS_EX);
 	}
 
-	for (int index = 0; index < _rows * _columns; index++)
+	detach();
+	for (int row = 0; row < _rows; row++)
 	{
-		_rmatrix[index] += rhs[index];
+		float* row_values = _rmatrix + (row * _stride);
+		const float* rhs_values = rhs._rmatrix + (row * rhs._stride);
+		for (int col = 0; col < _columns; col++)
+		{
+			row_values[col] += rhs_values[col];
+		}
 	}
 
 	return *this;
@@ -197,15 +347,54 @@ Matrix& Matrix::operator=(const Matrix& rhs)
 		return *this;
 	}
 
-	_rows = rhs.get_rows();
-	_columns = rhs.get_cols();
-	delete[] _rmatrix;
-	_rmatrix = new float[_rows * _columns]();
+	if (nullptr != rhs._owner)
+	{
+		release();
+		_rmatrix = rhs._rmatrix;
+		_rows = rhs._rows;
+		_columns = rhs._columns;
+		_stride = rhs._stride;
+		_owner = rhs._owner;
+		return *this;
+	}
+
+	// Owned storage (and its layout) is reused when the dimensions do
+	// not change
+	if (!validate_dimensions(rhs) || (nullptr != _owner))
+	{
+		release();
+		_rows = rhs.get_rows();
+		_columns = rhs.get_cols();
+		_stride = _columns;
+		_rmatrix = allocate(_rows * _columns, false);
+	}
 	copy_matrix(rhs);
 
 	return *this;
 }
 
+// See documentation at header file
+Matrix& Matrix::operator=(Matrix&& rhs) noexcept
+{
+	if (this == &rhs)
+	{
+		return *this;
+	}
+
+	release();
+	_rmatrix = rhs._rmatrix;
+	_rows = rhs._rows;
+	_columns = rhs._columns;
+	_stride = rhs._stride;
+	_owner = std::move(rhs._owner);
+	rhs._rmatrix = nullptr;
+	rhs._rows = 0;
+	rhs._columns = 0;
+	rhs._stride = 0;
+
+	return *this;
+}
+
 // See documentation at header file
 float Matrix::operator()(int row, int col) const
 {
@@ -215,19 +404,20 @@ float Matrix::operator()(int row, int col) const
 		throw std::out_of_range(INVALID_INDEX_EX);
 	}
 
-	return _rmatrix[raw_index];
+	return _rmatrix[storage_index(raw_index)];
 }
 
 // See documentation at header file
 float& Matrix::operator()(int row, int col)
 {
+	detach();
 	int raw_index = coord_to_index(row, col, _columns);
 	if (is_out_of_range(raw_index, _rows * _columns))
 	{
 		throw std::out_of_range(INVALID_INDEX_EX);
 	}
 
-	return _rmatrix[raw_index];
+	return _rmatrix[storage_index(raw_index)];
 }
 
 // See documentation at header file
@@ -238,18 +428,19 @@ float Matrix::operator[](int index) const
 		throw std::out_of_range(INVALID_INDEX_EX);
 	}
 
-	return _rmatrix[index];
+	return _rmatrix[storage_index(index)];
 }
 
 // See documentation at header file
 float& Matrix::operator[](int index)
 {
+	detach();
 	if (is_out_of_range(index, _rows * _columns))
 	{
 		throw std::out_of_range(INVALID_INDEX_EX);
 	}
 
-	return _rmatrix[index];
+	return _rmatrix[storage_index(index)];
 }
 
 // See documentation at header file
@@ -274,16 +465,118 @@ bool Matrix::validate_dimensions(const Matrix& other) const
 // See documentation at header file
 void Matrix::copy_matrix(const Matrix& source)
 {
-	for (int row_index = 0; row_index < _rows; row_index++)
+	if ((_stride == source._stride) || (1 == _rows))
 	{
-		for (int column_index = 0;
-			 column_index < _columns;
-			 column_index++)
+		std::copy(source._rmatrix,
+				  source._rmatrix + ((_rows - 1) * _stride) + _columns,
+				  _rmatrix);
+		return;
+	}
+
+	for (int row = 0; row < _rows; row++)
+	{
+		std::copy(source._rmatrix + (row * source._stride),
+				  source._rmatrix + (row * source._stride) + _columns,
+				  _rmatrix + (row * _stride));
+	}
+}
+
+/**
+* Allocates storage aligned to a power of two, freed by free_storage.
+* MSVC has no posix_memalign, and its aligned storage has its own free.
+* @param bytes - The size of the storage.
+* @param alignment - The alignment, a multiple of sizeof(void*).
+* @return The storage, nullptr on failure.
+*/
+static void* aligned_storage(size_t bytes, size_t alignment)
+{
+#if defined(_WIN32)
+	return _aligned_malloc(bytes, alignment);
+#else
+	void* storage = nullptr;
+	return (0 == posix_memalign(&storage, alignment, bytes)) ? storage
+															  : nullptr;
+#endif
+}
+
+/**
+* Frees storage of Matrix::allocate.
+*/
+static void free_storage(void* storage)
+{
+#if defined(_WIN32)
+	_aligned_free(storage);
+#else
+	std::free(storage);
+#endif
+}
+
+// See documentation at header file
+float* Matrix::allocate(int size, bool zero, matrix_layout layout)
+{
+	void* storage = nullptr;
+	const size_t bytes = sizeof(float) * size;
+	// Aligned allocation costs more than the products of small matrices
+	if ((matrix_layout::PACKED == layout) && (size < ALIGNED_SIZE))
+	{
+#if defined(_WIN32)
+		// Every storage must be freed the same way, by _aligned_free
+		storage = aligned_storage(bytes, alignof(std::max_align_t));
+		if ((nullptr != storage) && zero)
 		{
-			operator()(row_index, column_index) =
-				source(row_index, column_index);
+			std::memset(storage, 0, bytes);
 		}
+#else
+		storage = zero ? std::calloc(size, sizeof(float)) :
+				  std::malloc(bytes);
+#endif
+		if (nullptr == storage)
+		{
+			throw std::bad_alloc();
+		}
+
+		return static_cast<float*>(storage);
 	}
+
+	storage = aligned_storage(bytes, ALIGNMENT);
+	if (nullptr == storage)
+	{
+		throw std::bad_alloc();
+	}
+
+	if (zero)
+	{
+		std::memset(storage, 0, bytes);
+	}
+
+	return static_cast<float*>(storage);
+}
+
+// See documentation at header file
+void Matrix::detach()
+{
+	if (nullptr == _owner)
+	{
+		return;
+	}
+
+	// Borrowed memory is always packed
+	float* owned = allocate(_rows * _columns, false);
+	std::copy(_rmatrix, _rmatrix + (_rows * _columns), owned);
+	_rmatrix = owned;
+	_owner.reset();
+}
+
+// See documentation at header file
+void Matrix::release()
+{
+	if (nullptr == _owner)
+	{
+		free_storage(_rmatrix);
+	}
+
+	_rmatrix = nullptr;
+	_owner.reset();
 }
 
 // See documentation at header file
@@ -315,35 +608,23 @@ std::ostream& operator<<(std::ostream& os, Matrix& obj)
 // See documentation at header file
 std::istream& operator>>(std::istream& is, Matrix& obj)
 {
-	for (int row_index = 0; row_index < obj._rows; row_index++)
+	// A single read for the whole matrix, or one per padded row
+	const bool packed = obj.is_packed();
+	float* values = obj.data();
+	for (int row = 0; row < (packed ? 1 : obj._rows); row++)
 	{
-		for (int column_index = 0;
-			column_index < obj._columns;
-			column_index++)
-		{
-			float input = 0;
-			is.read(reinterpret_cast<char*>(&input), sizeof(input));
-
-			if (!is.good())
-			{
-				throw std::runtime_error(READ_INSUFFICIENT_DATA_EX);
-			}
-
-			obj(row_index, column_index) = input;
-		}
+		is.read(reinterpret_cast<char*>(values + (row * obj._stride)),
+				static_cast<std::streamsize>(
+					sizeof(float) * (packed ? obj._rows : 1) * obj._columns));
+	}
+	if (!is.good())
+	{
+		throw std::runtime_error(READ_INSUFFICIENT_DATA_EX);
 	}
 
 	return is;
 }
 
-// See documentation at header file
-Matrix operator+(const Matrix& lhs, const Matrix& rhs)
-{
-	Matrix addition_matrix(lhs);
-	addition_matrix += rhs;
-	return addition_matrix;
-}
-
 // See documentation at header file
 Matrix operator*(const Matrix& lhs, const Matrix& rhs)
 {
@@ -352,49 +633,27 @@ Matrix operator*(const Matrix& lhs, const Matrix& rhs)
 		throw std::length_error(INCOMPATIBLE_DIMENSIONS_EX);
 	}
 
-	Matrix mult_matrix(lhs.get_rows(), rhs.get_cols());
-
-	for (int lhs_index = 0; lhs_index < lhs.get_rows(); lhs_index++)
+	// Padded storage goes through the strided view kernels
+	if (!lhs.is_packed() || !rhs.is_packed())
 	{
-		for (int rhs_index = 0; 
-			 rhs_index < rhs.get_cols(); 
-			 rhs_index++)
-		{
-			// At this point, we're modifying the i,j index
-			// of the multiplication matrix
-			float mult_sum = 0;
-
-			// Now for the actual multiplication
-			for (int mult_index = 0; 
-				 mult_index < lhs.get_cols(); 
-				 mult_index++)
-			{
-				mult_sum += 
-					lhs(lhs_index, mult_index) * 
-					rhs(mult_index, rhs_index);
-			}
-
-			mult_matrix(lhs_index, rhs_index) = mult_sum;
-		}
+		return MatrixView(lhs) * MatrixView(rhs);
 	}
-	
-	return mult_matrix;
-}
-
-// See documentation at header file
-Matrix operator*(float scalar, const Matrix& rhs)
-{
-	return operator*(rhs, scalar);
-}
 
-// See documentation at header file
-Matrix operator*(const Matrix& lhs, float scalar)
-{
-	Matrix mult_matrix(lhs);
-	for (int index = 0; index < lhs._rows * lhs._columns; index++)
+	Matrix mult_matrix(lhs.get_rows(), rhs.get_cols());
+	if (1 == rhs._columns)
 	{
-		mult_matrix._rmatrix[index] *= scalar;
+		gemv::multiply(
+			lhs._rows, lhs._columns,
+			lhs._rmatrix, lhs._columns,
+			rhs._rmatrix, mult_matrix._rmatrix);
+		return mult_matrix;
 	}
 
+	gemm::multiply(
+		lhs._rows, rhs._columns, lhs._columns,
+		lhs._rmatrix, lhs._columns,
+		rhs._rmatrix, rhs._columns,
+		mult_matrix._rmatrix, mult_matrix._columns);
+
 	return mult_matrix;
 }
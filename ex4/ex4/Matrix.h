@@ -3,6 +3,15 @@
 #define MATRIX_H
 
 #include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+#include "Reduction.h"
+
+// Exception descriptions
+#define INCOMPATIBLE_DIMENSIONS_EX ("Dimensions incompatible")
+#define INVALID_INDEX_EX ("Invalid matrix index")
 
 /**
  * @struct matrix_dims
@@ -13,14 +22,98 @@ typedef struct matrix_dims
 	int rows, cols;
 } matrix_dims;
 
+/**
+* Storage layout of a matrix.
+*/
+enum class matrix_layout
+{
+	// Rows stored one after the other, with no gaps
+	PACKED = 0,
+	// Every row starts on a Matrix::ALIGNMENT boundary, the rows zero
+	// padded to a multiple of Matrix::PADDING values
+	PADDED
+};
+
+/**
+ * @class MatrixExpression
+ * @brief Base of every matrix-valued expression (CRTP).
+ *		  Element-wise expressions (sums, scaling) are not computed
+ *		  when written, but when assigned to a Matrix, in a single
+ *		  loop over the elements with no intermediate matrices.
+ *		  Expressions also read like a const Matrix: cells are
+ *		  computed on demand, reductions and printing evaluate the
+ *		  expression first. An expression reads the matrices it was
+ *		  written over whenever it is read, so one kept in a variable
+ *		  (as with auto) sees their later changes, and must not
+ *		  outlive them.
+ * @tparam Derived - The concrete expression type, which provides
+ *					 get_rows(), get_cols() and element(index).
+ */
+template <typename Derived>
+class MatrixExpression
+{
+public:
+	/**
+	* Getting the concrete expression.
+	*/
+	const Derived& self() const
+	{
+		return static_cast<const Derived&>(*this);
+	}
+
+	/**
+	* Computing a cell by row,column coordinates.
+	* @throws std::out_of_range in case of an index out of range.
+	*/
+	float operator()(int row, int col) const;
+
+	/**
+	* Computing a cell by a raw (row-major) index.
+	* @throws std::out_of_range in case of an index out of range.
+	*/
+	float operator[](int index) const;
+
+	/**
+	* Printing the evaluated expression (see Matrix::plain_print).
+	*/
+	void plain_print() const;
+
+	/**
+	* Calculating the Frobenius Norm of the evaluated expression.
+	*/
+	float norm() const;
+
+	/**
+	* Getting the index of the maximal value of the evaluated expression.
+	*/
+	int argmax() const;
+
+	/**
+	* Calculating the sum of the evaluated expression.
+	*/
+	float sum() const;
+};
+
 /**
 * @class Matrix
  * @brief Matrix datatype of floating-point variables.
  *		  Supports elementary matrix operations.
+ *		  Owned storage starts on an ALIGNMENT boundary, so SIMD loads
+ *		  never split a cache line at the start of the matrix (packed
+ *		  storage of fewer than ALIGNED_SIZE values excepted). The
+ *		  storage may be padded (see matrix_layout), in which case
+ *		  rows are get_stride() values apart. Cells are addressed the
+ *		  same way in both layouts.
  */
-class Matrix
+class Matrix : public MatrixExpression<Matrix>
 {
 public:
+	// Alignment of owned storage, in bytes (a cache line)
+	static constexpr int ALIGNMENT = 64;
+	// Row length granularity of padded storage, in values
+	static constexpr int PADDING = ALIGNMENT / sizeof(float);
+	// Packed storage of fewer values is not aligned
+	static constexpr int ALIGNED_SIZE = 4 * PADDING;
 
 	// Instance Construction / Destruction
 
@@ -39,11 +132,60 @@ public:
 	Matrix(int rows, int cols);
 
 	/**
-	* Copy Constructor.
+	* Constructs matrix with the given dimensions and storage layout.
+	* All cells (and padding) initialized to 0.
+	* @param rows - The number of rows in the matrix.
+	* @param cols - The number of columns in the matrix.
+	* @param layout - The storage layout.
+	*/
+	Matrix(int rows, int cols, matrix_layout layout);
+
+	/**
+	* Constructs a copy of a matrix with the given storage layout.
+	* @param matrix - The matrix to copy.
+	* @param layout - The storage layout of the copy.
+	*/
+	Matrix(const Matrix& matrix, matrix_layout layout);
+
+	/**
+	* Constructs a matrix over existing read-only memory, such as a
+	* memory-mapped parameter file, without copying it.
+	* Copies of the matrix share the memory. The matrix detaches,
+	* copying the memory into storage of its own, before its first
+	* modification (any non-const access to its cells).
+	* @param rows - The number of rows in the matrix.
+	* @param cols - The number of columns in the matrix.
+	* @param data - The cells, rows stored one after the other.
+	* @param owner - Keeps the memory alive while any matrix uses it.
+	*				 When nullptr, the cells are copied instead.
+	* @throws std::length_error in case of non-positive dimensions.
+	*/
+	Matrix(int rows, int cols, const float* data,
+		   std::shared_ptr<const void> owner);
+
+	/**
+	* Copy Constructor. Matrices over borrowed memory share it, other
+	* copies are packed.
 	* @param matrix - The matrix to copy.
 	*/
 	Matrix(const Matrix& matrix);
 
+	/**
+	* Move Constructor, taking over the storage of the given matrix.
+	* The moved-from matrix is left empty (0x0), it may only be
+	* assigned to or destroyed.
+	* @param matrix - The matrix to move from.
+	*/
+	Matrix(Matrix&& matrix) noexcept;
+
+	/**
+	* Constructs a matrix by evaluating an element-wise expression,
+	* in a single pass over the elements.
+	* @param expression - The expression to evaluate.
+	*/
+	template <typename Expression>
+	Matrix(const MatrixExpression<Expression>& expression);
+
 	/**
 	* Destructor, freeing all dynamic matrix memory.
 	*/
@@ -61,10 +203,45 @@ public:
 	*/
 	int get_cols() const;
 
+	/**
+	* Getting the distance, in values, between two stored rows:
+	* the column count unless the storage is padded.
+	*/
+	int get_stride() const;
+
+	/**
+	* Checking whether the cells are stored with no gaps, so the
+	* storage can be read as a single buffer of rows x cols values.
+	*/
+	bool is_packed() const;
+
+	/**
+	* Getting the raw storage of the matrix, rows stored get_stride()
+	* values apart. Intended for kernels, access is not bounds checked.
+	* A matrix over borrowed memory detaches from it first.
+	*/
+	float* data();
+
+	/**
+	* Getting the raw storage of the matrix, rows stored get_stride()
+	* values apart. Intended for kernels, access is not bounds checked.
+	*/
+	const float* data() const;
+
+	/**
+	* Checking whether the matrix reads borrowed memory
+	* (see the borrowing constructor).
+	* @return True while the matrix has not detached from it.
+	*/
+	bool is_borrowed() const;
+
 	/**
 	* Transposing the matrix.
 	* (switching rows with columns and vice versa)
 	* Note: Transposing is done on the object, and NOT copied.
+	* Square matrices swap blocks across the diagonal, others follow
+	* the permutation cycles, so no second buffer is allocated.
+	* Padded matrices are transposed into new padded storage.
 	* @return The same instance of this matrix, supports chaining.
 	*/
 	Matrix& transpose();
@@ -73,6 +250,7 @@ public:
 	* Vectorizing the matrix.
 	* (converting matrix to single-column matrix)
 	* Note: Vectorizing is done on the object, and NOT copied.
+	* Padded rows are moved together first, leaving packed storage.
 	* @return The same instance of this matrix, supports chaining.
 	*/
 	Matrix& vectorize();
@@ -94,7 +272,8 @@ public:
 	Matrix dot(Matrix& in) const;
 
 	/**
-	* Calculating the Frobenius Norm of the instance matrix.
+	* Calculating the Frobenius Norm of the instance matrix, over a
+	* pairwise sum of squares (see reduction::sum_of_squares).
 	* @return The Frobenius Norm.
 	*/
 	float norm() const;
@@ -106,7 +285,15 @@ public:
 	int argmax() const;
 
 	/**
-	* Calculating the sum of all values in the matrix.
+	* Getting the maximal value in the matrix together with its index,
+	* in a single pass (see reduction::argmax).
+	* @return The first maximal value and its row-major index.
+	*/
+	reduction::indexed_max max_with_index() const;
+
+	/**
+	* Calculating the sum of all values in the matrix, summed pairwise
+	* (see reduction::sum) so large matrices keep their precision.
 	* @return The sum.
 	*/
 	float sum() const;
@@ -123,8 +310,22 @@ public:
 	*/
 	Matrix& operator+=(const Matrix& rhs);
 
+	/**
+	* Addition assignment operator to add an element-wise expression
+	* to the instance matrix, in a single pass over the elements.
+	* @param rhs - The right-hand side expression. The dimensions
+	*			   of both should be the same.
+	* @throws std::length_error in case of incompatible dimensions.
+	* @return The instance matrix.
+	*/
+	template <typename Expression>
+	Matrix& operator+=(const MatrixExpression<Expression>& rhs);
+
 	/**
 	* Multiplication operator for multiplying 2 matrices.
+	* The product is computed by the blocked GEMM engine (Gemm.h),
+	* or by the SIMD GEMV kernels (Gemv.h) when rhs is a single column,
+	* as is the case for every Dense layer application.
 	* Note: Function is friend since operator*= is not defined.
 	* @param lhs - The left-hand side of the multiplication.
 	* @param rhs - The right-hand side of the multiplication.
@@ -135,31 +336,30 @@ public:
 	friend Matrix operator*(const Matrix& lhs, const Matrix& rhs);
 
 	/**
-	* Multiplication operator for multiplying a matrix by a scalar,
-	* from the left.
-	* Note: Function is friend since operator*= is not defined.
-	* @param scalar - The scalar to multiply by.
-	* @param rhs - The right-hand side of the multiplication.
-	* @return The new matrix produced from multiplication.
+	* Assignment operator for copying a matrix by assignment.
+	* @param rhs - The right hand side of the operator (the source).
+	* @return Reference to the new, copied matrix.
 	*/
-	friend Matrix operator*(float scalar, const Matrix& rhs);
+	Matrix& operator=(const Matrix& rhs);
 
 	/**
-	* Multiplication operator for multiplying a matrix by a scalar,
-	* from the right.
-	* Note: Function is friend since operator*= is not defined.
-	* @param lhs - The left-hand side of the multiplication.
-	* @param scalar - The scalar to multiply by.
-	* @return The new matrix produced from multiplication.
+	* Assignment operator for moving a matrix by assignment.
+	* The moved-from matrix is left empty (0x0), it may only be
+	* assigned to or destroyed.
+	* @param rhs - The right hand side of the operator (the source).
+	* @return Reference to the assigned matrix.
 	*/
-	friend Matrix operator*(const Matrix& lhs, float scalar);
+	Matrix& operator=(Matrix&& rhs) noexcept;
 
 	/**
-	* Assignment operator for copying a matrix by assignment.
-	* @param rhs - The right hand side of the operator (the source).
-	* @return Reference to the new, copied matrix.
+	* Assignment operator evaluating an element-wise expression
+	* into the matrix, in a single pass over the elements. The
+	* storage is reused when the dimensions do not change.
+	* @param rhs - The expression to evaluate.
+	* @return Reference to the assigned matrix.
 	*/
-	Matrix& operator=(const Matrix& rhs);
+	template <typename Expression>
+	Matrix& operator=(const MatrixExpression<Expression>& rhs);
 
 	/**
 	* Access operator for accessing a cell by row,column coordinates.
@@ -197,6 +397,17 @@ public:
 	*/
 	float& operator[](int index);
 
+	/**
+	* Accessing a cell by a raw index, for expression evaluation.
+	* Not bounds checked.
+	* @param index - The index to access.
+	* @return The value in the cell.
+	*/
+	float element(int index) const
+	{
+		return _rmatrix[storage_index(index)];
+	}
+
 	/**
 	* Output stream for the matrix.
 	*/
@@ -204,7 +415,8 @@ public:
 
 	/**
 	* Input stream for the matrix, reading binary floating-point
-	* data from the given stream, until matrix is full.
+	* data from the given stream, until matrix is full (in a single
+	* read unless the storage is padded).
 	*/
 	friend std::istream& operator>>(std::istream& is, Matrix& obj);
 
@@ -226,6 +438,29 @@ private:
 	*/
 	static bool is_out_of_range(int index, int size);
 
+	/**
+	* Converting a row-major cell index to its index in the storage.
+	* @param index - The row-major cell index.
+	* @return The storage index.
+	*/
+	int storage_index(int index) const
+	{
+		return (_stride == _columns) ? index :
+			   ((index / _columns) * _stride) + (index % _columns);
+	}
+
+	/**
+	* Allocating storage aligned to ALIGNMENT, except small packed
+	* storage (see ALIGNED_SIZE).
+	* @param size - The number of values.
+	* @param zero - Whether the values are initialized to 0.
+	* @param layout - The storage layout.
+	* @throws std::bad_alloc in case of allocation failure.
+	* @return The storage, freed by release.
+	*/
+	static float* allocate(int size, bool zero,
+						   matrix_layout layout = matrix_layout::PACKED);
+
 	/**
 	* Validating the dimensions of another matrix
 	* with the instance matrix.
@@ -236,29 +471,322 @@ private:
 
 	/**
 	* Copying all cells from the given source matrix
-	* to the instance matrix. NOT checking any dimensions
-	* the function expects source matrix at-least as big
-	* as the instance matrix.
+	* to the instance matrix, whatever their layouts. NOT checking
+	* any dimensions the function expects source matrix of the same
+	* dimensions as the instance matrix.
 	* @param source - The source matrix to copy from.
 	*/
 	void copy_matrix(const Matrix& source);
 
+	/**
+	* Evaluating an element-wise expression of the same dimensions
+	* as the instance matrix into it.
+	* @param expression - The expression to evaluate.
+	*/
+	template <typename Expression>
+	void evaluate(const Expression& expression);
+
+	/**
+	* Copying borrowed memory into storage owned by the instance
+	* matrix, before it is modified. Does nothing for owned storage.
+	*/
+	void detach();
+
+	/**
+	* Freeing owned storage, or letting go of borrowed memory.
+	*/
+	void release();
+
 	// The raw matrix, represented as single-dimension array
 	float* _rmatrix;
 	// The row count of the matrix
 	int _rows = 0;
 	// The column count of the matrix
 	int _columns = 0;
+	// The distance between two stored rows, in values
+	int _stride = 0;
+	// Owner of borrowed memory, nullptr when _rmatrix is owned
+	std::shared_ptr<const void> _owner;
 };
 
+// Expression templates
+
 /**
-	* Adding two matrices together.
-	* @param lhs - The left-hand matrix.
-	* @param rhs - The right hand matrix.
-	* @throws std::length_error in case of incompatible
-	*		  dimensions (lhs & rhs should be of the same dimension).
-	* @return The new summation matrix.
-	*/
-Matrix operator+(const Matrix& lhs, const Matrix& rhs);
+ * @struct expression_operand
+ * @brief How expressions hold their operands: matrices by reference
+ *		  (they outlive the full expression), expressions by value
+ *		  (they are small temporaries).
+ */
+template <typename Expression>
+struct expression_operand
+{
+	using type = const Expression;
+};
+
+template <>
+struct expression_operand<Matrix>
+{
+	using type = const Matrix&;
+};
+
+/**
+ * @class MatrixSum
+ * @brief Lazy element-wise sum of two expressions.
+ */
+template <typename Lhs, typename Rhs>
+class MatrixSum : public MatrixExpression<MatrixSum<Lhs, Rhs>>
+{
+public:
+	/**
+	* Constructs the sum of two expressions.
+	* @throws std::length_error in case of incompatible dimensions.
+	*/
+	MatrixSum(const Lhs& lhs, const Rhs& rhs) :
+		_lhs(lhs), _rhs(rhs)
+	{
+		if ((lhs.get_rows() != rhs.get_rows()) ||
+			(lhs.get_cols() != rhs.get_cols()))
+		{
+			throw std::length_error(INCOMPATIBLE_DIMENSIONS_EX);
+		}
+	}
+
+	int get_rows() const { return _lhs.get_rows(); }
+	int get_cols() const { return _lhs.get_cols(); }
+	float element(int index) const
+	{
+		return _lhs.element(index) + _rhs.element(index);
+	}
+
+private:
+	typename expression_operand<Lhs>::type _lhs;
+	typename expression_operand<Rhs>::type _rhs;
+};
+
+/**
+ * @class MatrixScale
+ * @brief Lazy multiplication of an expression by a scalar.
+ */
+template <typename Operand>
+class MatrixScale : public MatrixExpression<MatrixScale<Operand>>
+{
+public:
+	MatrixScale(float scalar, const Operand& operand) :
+		_scalar(scalar), _operand(operand)
+	{}
+
+	int get_rows() const { return _operand.get_rows(); }
+	int get_cols() const { return _operand.get_cols(); }
+	float element(int index) const
+	{
+		return _scalar * _operand.element(index);
+	}
+
+private:
+	const float _scalar;
+	typename expression_operand<Operand>::type _operand;
+};
+
+/**
+* Adding two matrices or expressions together, lazily.
+* @param lhs - The left-hand expression.
+* @param rhs - The right hand expression.
+* @throws std::length_error in case of incompatible
+*		  dimensions (lhs & rhs should be of the same dimension).
+* @return The summation expression.
+*/
+template <typename Lhs, typename Rhs>
+MatrixSum<Lhs, Rhs> operator+(const MatrixExpression<Lhs>& lhs,
+							  const MatrixExpression<Rhs>& rhs)
+{
+	return MatrixSum<Lhs, Rhs>(lhs.self(), rhs.self());
+}
+
+/**
+* Adding an expression to a temporary matrix, reusing the storage
+* of the temporary (as in a * x + b).
+* @throws std::length_error in case of incompatible dimensions.
+* @return The summation matrix.
+*/
+template <typename Rhs>
+Matrix operator+(Matrix&& lhs, const MatrixExpression<Rhs>& rhs)
+{
+	lhs += rhs;
+	return std::move(lhs);
+}
+
+/**
+* Adding a temporary matrix to an expression, reusing the storage
+* of the temporary (as in b + a * x).
+* @throws std::length_error in case of incompatible dimensions.
+* @return The summation matrix.
+*/
+template <typename Lhs>
+Matrix operator+(const MatrixExpression<Lhs>& lhs, Matrix&& rhs)
+{
+	rhs += lhs;
+	return std::move(rhs);
+}
+
+/**
+* Adding two temporary matrices, reusing the storage of the first.
+* @throws std::length_error in case of incompatible dimensions.
+* @return The summation matrix.
+*/
+inline Matrix operator+(Matrix&& lhs, Matrix&& rhs)
+{
+	lhs += rhs;
+	return std::move(lhs);
+}
+
+/**
+* Multiplying a matrix or expression by a scalar from the left, lazily.
+* @param scalar - The scalar to multiply by.
+* @param rhs - The right-hand side of the multiplication.
+* @return The scaling expression.
+*/
+template <typename Operand>
+MatrixScale<Operand> operator*(float scalar,
+							   const MatrixExpression<Operand>& rhs)
+{
+	return MatrixScale<Operand>(scalar, rhs.self());
+}
+
+/**
+* Multiplying a matrix or expression by a scalar from the right, lazily.
+* @param lhs - The left-hand side of the multiplication.
+* @param scalar - The scalar to multiply by.
+* @return The scaling expression.
+*/
+template <typename Operand>
+MatrixScale<Operand> operator*(const MatrixExpression<Operand>& lhs,
+							   float scalar)
+{
+	return MatrixScale<Operand>(scalar, lhs.self());
+}
+
+/**
+* Multiplying a temporary matrix by a scalar, in place.
+* @return The multiplied matrix.
+*/
+inline Matrix operator*(float scalar, Matrix&& rhs)
+{
+	rhs = MatrixScale<Matrix>(scalar, rhs);
+	return std::move(rhs);
+}
+
+/**
+* Multiplying a temporary matrix by a scalar, in place.
+* @return The multiplied matrix.
+*/
+inline Matrix operator*(Matrix&& lhs, float scalar)
+{
+	return scalar * std::move(lhs);
+}
+
+// See documentation above
+template <typename Derived>
+float MatrixExpression<Derived>::operator()(int row, int col) const
+{
+	return operator[]((row * self().get_cols()) + col);
+}
+
+// See documentation above
+template <typename Derived>
+float MatrixExpression<Derived>::operator[](int index) const
+{
+	if ((0 > index) || (index >= self().get_rows() * self().get_cols()))
+	{
+		throw std::out_of_range(INVALID_INDEX_EX);
+	}
+
+	return self().element(index);
+}
+
+// See documentation above
+template <typename Derived>
+void MatrixExpression<Derived>::plain_print() const
+{
+	Matrix(*this).plain_print();
+}
+
+// See documentation above
+template <typename Derived>
+float MatrixExpression<Derived>::norm() const
+{
+	return Matrix(*this).norm();
+}
+
+// See documentation above
+template <typename Derived>
+int MatrixExpression<Derived>::argmax() const
+{
+	return Matrix(*this).argmax();
+}
+
+// See documentation above
+template <typename Derived>
+float MatrixExpression<Derived>::sum() const
+{
+	return Matrix(*this).sum();
+}
+
+// See documentation above
+template <typename Expression>
+Matrix::Matrix(const MatrixExpression<Expression>& expression) :
+	Matrix(expression.self().get_rows(), expression.self().get_cols())
+{
+	evaluate(expression.self());
+}
+
+// See documentation above
+template <typename Expression>
+Matrix& Matrix::operator=(const MatrixExpression<Expression>& rhs)
+{
+	const Expression& expression = rhs.self();
+	if ((_rows != expression.get_rows()) ||
+		(_columns != expression.get_cols()))
+	{
+		// An expression over this matrix has its dimensions, so the
+		// storage it reads is never the one released here
+		*this = Matrix(expression.get_rows(), expression.get_cols());
+	}
+
+	evaluate(expression);
+	return *this;
+}
+
+// See documentation above
+template <typename Expression>
+Matrix& Matrix::operator+=(const MatrixExpression<Expression>& rhs)
+{
+	return operator=(MatrixSum<Matrix, Expression>(*this, rhs.self()));
+}
+
+// See documentation above
+template <typename Expression>
+void Matrix::evaluate(const Expression& expression)
+{
+	detach();
+	// Element-wise expressions only read the index being written,
+	// so evaluating into an operand of the expression is safe
+	if (_stride == _columns)
+	{
+		for (int index = 0; index < _rows * _columns; index++)
+		{
+			_rmatrix[index] = expression.element(index);
+		}
+		return;
+	}
+
+	for (int row = 0; row < _rows; row++)
+	{
+		for (int col = 0; col < _columns; col++)
+		{
+			_rmatrix[(row * _stride) + col] =
+				expression.element((row * _columns) + col);
+		}
+	}
+}
 
 #endif //MATRIX_H
\ No newline at end of file
@@ -0,0 +1,216 @@
+#include <cmath>
+
+#include "MatrixView.h"
+#include "Gemm.h"
+#include "Gemv.h"
+#include "Transposition.h"
+
+// Exception descriptions
+#define INVALID_DIMENSIONS_EX ("Invalid Matrix Dimensions")
+#define INVALID_INDEX_EX ("Invalid matrix index")
+
+// See documentation at header file
+MatrixView::MatrixView(const float* data, int rows, int cols, int stride,
+					   bool transposed) :
+	_data(data),
+	_rows(rows),
+	_columns(cols),
+	_stride(stride),
+	_transposed(transposed)
+{
+	if ((0 >= _rows) || (0 >= _columns) ||
+		(_stride < (_transposed ? _rows : _columns)))
+	{
+		throw std::length_error(INVALID_DIMENSIONS_EX);
+	}
+}
+
+// See documentation at header file
+MatrixView::MatrixView(const Matrix& matrix) :
+	MatrixView(matrix.data(), matrix.get_rows(), matrix.get_cols(),
+			   matrix.get_stride())
+{}
+
+// See documentation at header file
+int MatrixView::get_rows() const
+{
+	return _rows;
+}
+
+// See documentation at header file
+int MatrixView::get_cols() const
+{
+	return _columns;
+}
+
+// See documentation at header file
+int MatrixView::get_stride() const
+{
+	return _stride;
+}
+
+// See documentation at header file
+bool MatrixView::is_transposed() const
+{
+	return _transposed;
+}
+
+// See documentation at header file
+const float* MatrixView::data() const
+{
+	return _data;
+}
+
+// See documentation at header file
+int MatrixView::row_step() const
+{
+	return _transposed ? 1 : _stride;
+}
+
+// See documentation at header file
+int MatrixView::col_step() const
+{
+	return _transposed ? _stride : 1;
+}
+
+// See documentation at header file
+bool MatrixView::is_contiguous() const
+{
+	return ((1 == _columns) || (1 == col_step())) &&
+		   ((1 == _rows) || (_columns == row_step()));
+}
+
+// See documentation at header file
+float MatrixView::operator()(int row, int col) const
+{
+	if ((0 > row) || (_rows <= row) || (0 > col) || (_columns <= col))
+	{
+		throw std::out_of_range(INVALID_INDEX_EX);
+	}
+
+	return element(row, col);
+}
+
+// See documentation at header file
+MatrixView MatrixView::submatrix(int row, int col, int rows, int cols) const
+{
+	if ((0 > row) || (0 > col) || (0 >= rows) || (0 >= cols) ||
+		(_rows < row + rows) || (_columns < col + cols))
+	{
+		throw std::out_of_range(INVALID_INDEX_EX);
+	}
+
+	return MatrixView(_data + (row * row_step()) + (col * col_step()),
+					  rows, cols, _stride, _transposed);
+}
+
+// See documentation at header file
+MatrixView MatrixView::row(int row) const
+{
+	return submatrix(row, 0, 1, _columns);
+}
+
+// See documentation at header file
+MatrixView MatrixView::column(int col) const
+{
+	return submatrix(0, col, _rows, 1);
+}
+
+// See documentation at header file
+MatrixView MatrixView::transpose() const
+{
+	return MatrixView(_data, _columns, _rows, _stride, !_transposed);
+}
+
+// See documentation at header file
+Matrix MatrixView::to_matrix() const
+{
+	Matrix matrix(_rows, _columns);
+	if (_transposed)
+	{
+		transposition::out_of_place(_columns, _rows, _data, _stride,
+									matrix.data(), _columns);
+		return matrix;
+	}
+
+	float* destination = matrix.data();
+	for (int row_index = 0; row_index < _rows; row_index++)
+	{
+		for (int column_index = 0; column_index < _columns; column_index++)
+		{
+			*destination++ = element(row_index, column_index);
+		}
+	}
+
+	return matrix;
+}
+
+// See documentation at header file
+float MatrixView::norm() const
+{
+	float quadratic_sum = 0;
+	for (int row_index = 0; row_index < stored_rows(); row_index++)
+	{
+		quadratic_sum += reduction::sum_of_squares(
+			_data + (row_index * _stride), stored_cols());
+	}
+
+	return std::sqrt(quadratic_sum);
+}
+
+// See documentation at header file
+int MatrixView::argmax() const
+{
+	if (is_contiguous())
+	{
+		return reduction::argmax(_data, _rows * _columns).index;
+	}
+
+	int current_max = 0;
+	float max_value = element(0, 0);
+	for (int row_index = 0; row_index < _rows; row_index++)
+	{
+		for (int column_index = 0; column_index < _columns; column_index++)
+		{
+			if (max_value < element(row_index, column_index))
+			{
+				max_value = element(row_index, column_index);
+				current_max = (row_index * _columns) + column_index;
+			}
+		}
+	}
+
+	return current_max;
+}
+
+// See documentation at header file
+float MatrixView::sum() const
+{
+	float view_sum = 0;
+	for (int row_index = 0; row_index < stored_rows(); row_index++)
+	{
+		view_sum += reduction::sum(_data + (row_index * _stride),
+								   stored_cols());
+	}
+
+	return view_sum;
+}
+
+// See documentation at header file
+Matrix operator*(const MatrixView& lhs, const MatrixView& rhs)
+{
+	if (lhs.get_cols() != rhs.get_rows())
+	{
+		throw std::length_error(INCOMPATIBLE_DIMENSIONS_EX);
+	}
+
+	Matrix mult_matrix(lhs.get_rows(), rhs.get_cols());
+	if (1 == rhs.get_cols())
+	{
+		gemv::multiply(lhs, rhs, mult_matrix.data());
+		return mult_matrix;
+	}
+
+	gemm::multiply(lhs, rhs, mult_matrix.data(), mult_matrix.get_cols());
+	return mult_matrix;
+}
@@ -0,0 +1,210 @@
+// MatrixView.h
+#ifndef MATRIXVIEW_H
+#define MATRIXVIEW_H
+
+#include "Matrix.h"
+
+/**
+* @class MatrixView
+ * @brief Non-owning, read-only view of a matrix stored in existing
+ *		  memory, such as a Matrix, a slice of one or a raw buffer.
+ *		  The stored matrix is row-major with a leading dimension
+ *		  (stride). A transposed view reads that storage as its
+ *		  transpose, so element (row, col) of the view is element
+ *		  (col, row) of the storage.
+ *		  The memory must outlive the view.
+ */
+class MatrixView
+{
+public:
+	/**
+	* Constructs a view over a raw buffer.
+	* @param data - The first element of the stored matrix.
+	* @param rows - The row count of the view.
+	* @param cols - The column count of the view.
+	* @param stride - Leading dimension of the storage, the distance
+	*				  in floats between two stored rows.
+	* @param transposed - Whether the view is the transpose of the
+	*					  storage (which is then cols x rows).
+	* @throws std::length_error in case of non-positive dimensions, or
+	*		  a stride smaller than a stored row.
+	*/
+	MatrixView(const float* data, int rows, int cols, int stride,
+			   bool transposed = false);
+
+	/**
+	* Constructs a view of a whole matrix.
+	* @param matrix - The matrix to view.
+	*/
+	MatrixView(const Matrix& matrix);
+
+	/**
+	* Getting the view's number of rows.
+	* @return The number of rows.
+	*/
+	int get_rows() const;
+
+	/**
+	* Getting the view's number of columns.
+	* @return The number of columns.
+	*/
+	int get_cols() const;
+
+	/**
+	* Getting the leading dimension of the storage.
+	* @return The distance in floats between two stored rows.
+	*/
+	int get_stride() const;
+
+	/**
+	* Getting whether the view reads its storage transposed.
+	* @return True for a transposed view.
+	*/
+	bool is_transposed() const;
+
+	/**
+	* Getting the first element of the storage.
+	* @return Pointer to element (0, 0) of the view.
+	*/
+	const float* data() const;
+
+	/**
+	* Getting the distance in floats between two consecutive rows
+	* of the view (1 for a transposed view).
+	* @return The row step.
+	*/
+	int row_step() const;
+
+	/**
+	* Getting the distance in floats between two consecutive columns
+	* of the view (1 for a view which is not transposed).
+	* @return The column step.
+	*/
+	int col_step() const;
+
+	/**
+	* Checking whether the elements of the view, in row-major order,
+	* are consecutive in memory (so the view can be read as a plain
+	* buffer).
+	* @return True for a contiguous view.
+	*/
+	bool is_contiguous() const;
+
+	/**
+	* Accessing a cell by (row, col) coordinates.
+	* @param row - The row of the cell.
+	* @param col - The column of the cell.
+	* @throws std::out_of_range in case of coordinates out of range.
+	* @return The value in the cell.
+	*/
+	float operator()(int row, int col) const;
+
+	/**
+	* Getting a view of a block of the view.
+	* @param row - The first row of the block.
+	* @param col - The first column of the block.
+	* @param rows - The row count of the block.
+	* @param cols - The column count of the block.
+	* @throws std::out_of_range in case the block is not within the view.
+	* @return The view of the block.
+	*/
+	MatrixView submatrix(int row, int col, int rows, int cols) const;
+
+	/**
+	* Getting a view of a single row (1 x cols).
+	* @param row - The row to view.
+	* @throws std::out_of_range in case of a row out of range.
+	* @return The view of the row.
+	*/
+	MatrixView row(int row) const;
+
+	/**
+	* Getting a view of a single column (rows x 1).
+	* @param col - The column to view.
+	* @throws std::out_of_range in case of a column out of range.
+	* @return The view of the column.
+	*/
+	MatrixView column(int col) const;
+
+	/**
+	* Getting the transpose of the view, without moving any data.
+	* @return The transposed view.
+	*/
+	MatrixView transpose() const;
+
+	/**
+	* Copying the viewed elements into a new matrix.
+	* @return The matrix, with the dimensions of the view.
+	*/
+	Matrix to_matrix() const;
+
+	/**
+	* Calculating the Frobenius Norm of the view, summing every stored
+	* row pairwise (see reduction::sum_of_squares).
+	* @return The Frobenius Norm.
+	*/
+	float norm() const;
+
+	/**
+	* Getting the index of the maximal value in the view, in
+	* row-major order of the view.
+	* @return The index of the maximal value.
+	*/
+	int argmax() const;
+
+	/**
+	* Calculating the sum of all values in the view, summing every
+	* stored row pairwise (see reduction::sum).
+	* @return The sum.
+	*/
+	float sum() const;
+
+private:
+	// First element of the storage
+	const float* _data;
+	int _rows;
+	int _columns;
+	// Leading dimension of the storage
+	int _stride;
+	// Whether the storage is read transposed
+	bool _transposed;
+
+	/**
+	* Getting the number of rows of the storage read by the view
+	* (its columns for a transposed view), each one contiguous.
+	*/
+	int stored_rows() const
+	{
+		return _transposed ? _columns : _rows;
+	}
+
+	/**
+	* Getting the length of the storage rows read by the view.
+	*/
+	int stored_cols() const
+	{
+		return _transposed ? _rows : _columns;
+	}
+
+	/**
+	* Getting an element without bounds checking.
+	*/
+	float element(int row, int col) const
+	{
+		return _data[(row * row_step()) + (col * col_step())];
+	}
+};
+
+/**
+* Multiplying two views, with either of them possibly transposed.
+* Uses the same GEMM / GEMV kernels as the Matrix product, reading
+* the operands through their strides without copying them.
+* @param lhs - The left-hand side of the multiplication.
+* @param rhs - The right-hand side of the multiplication.
+* @throws std::length_error in case the lhs column count is
+*		  not the rhs row count.
+* @return The product matrix.
+*/
+Matrix operator*(const MatrixView& lhs, const MatrixView& rhs);
+
+#endif //MATRIXVIEW_H
@@ -1,45 +1,313 @@
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
 #include "MlpNetwork.h"
+#include "ModelFile.h"
+
+#define INVALID_BATCH_EX ("Batch rows must match the image size")
+#define INVALID_BATCH_SIZE_EX ("Batch size must be positive")
+#define WORKSPACE_TOO_SMALL_EX ("Batch is larger than the workspace")
+#define NO_LAYERS_EX ("A network needs at least one layer")
+#define INCOMPATIBLE_LAYERS_EX ("Layer input must match the previous output")
+
+/**
+* Describes the default network: the given matrices, ReLU activated
+* but the last layer, Softmax activated.
+* @return The layers, in order.
+*/
+static std::vector<model::layer> default_layers(Matrix weights[MLP_SIZE],
+												Matrix biases[MLP_SIZE])
+{
+	std::vector<model::layer> layers;
+	for (int index = 0; index < MLP_SIZE; index++)
+	{
+		layers.push_back({
+			weights[index],
+			biases[index],
+			(MLP_SIZE - 1 == index) ? activation::softmax : activation::relu
+		});
+	}
+
+	return layers;
+}
 
-typedef enum layer_index
+/**
+* Finds the most probable digit of one sample in a layer output.
+* @param output - The output, row-major (rows x cols).
+* @param rows - The output size of every sample.
+* @param cols - The number of samples.
+* @param column - The sample to look at.
+* @return The most probable digit with its probability.
+*/
+static digit column_argmax(const float* output, int rows, int cols,
+						   int column)
 {
-	LAYER_INDEX_1 = 0,
-	LAYER_INDEX_2,
-	LAYER_INDEX_3,
-	LAYER_INDEX_4,
+	// A single sample is contiguous, its maximum is found in one pass
+	if (1 == cols)
+	{
+		const reduction::indexed_max maximum =
+			reduction::argmax(output, rows);
+		return {static_cast<unsigned int>(maximum.index), maximum.value};
+	}
 
-	MAX_LAYERS
-} layer_index;
+	int result_index = 0;
+	for (int row_index = 1; row_index < rows; row_index++)
+	{
+		if (output[(result_index * cols) + column] <
+			output[(row_index * cols) + column])
+		{
+			result_index = row_index;
+		}
+	}
+
+	return {
+		static_cast<unsigned int>(result_index),
+		output[(result_index * cols) + column]
+	};
+}
+
+// See documentation at header file
+Workspace::Workspace(int batch) :
+	_batch(batch)
+{
+	if (0 >= batch)
+	{
+		throw std::length_error(INVALID_BATCH_SIZE_EX);
+	}
+}
+
+// See documentation at header file
+Workspace::Workspace(const MlpNetwork& network, int batch) :
+	Workspace(batch)
+{
+	plan(network.get_largest_output());
+}
+
+// See documentation at header file
+int Workspace::get_batch() const
+{
+	return _batch;
+}
+
+// See documentation at header file
+void Workspace::plan(int width)
+{
+	const auto size = static_cast<size_t>(width) * _batch;
+	if (_ping.size() < size)
+	{
+		_ping.resize(size);
+		_pong.resize(size);
+	}
+}
+
+// See documentation at header file
+MlpNetwork::MlpNetwork(const std::vector<model::layer>& layers,
+					   weight_format format) :
+	_input_size(0),
+	_output_size(0),
+	_largest_output(0)
+{
+	if (layers.empty())
+	{
+		throw std::length_error(NO_LAYERS_EX);
+	}
+
+	_input_size = layers.front().weights.get_cols();
+	for (const auto& layer : layers)
+	{
+		if (layer.weights.get_cols() !=
+			(_layers.empty() ? _input_size : _output_size))
+		{
+			throw std::length_error(INCOMPATIBLE_LAYERS_EX);
+		}
+
+		// Owned before the vector may grow, so a failed growth frees it
+		_layers.push_back(std::unique_ptr<const Dense>(
+			new Dense(layer.weights, layer.bias, layer.activation, format)));
+		_output_size = layer.weights.get_rows();
+		_largest_output = std::max(_largest_output, _output_size);
+	}
+}
 
 // See documentation at header file
 MlpNetwork::MlpNetwork(
-	Matrix weights[MLP_SIZE], Matrix biases[MLP_SIZE]) :
-	_layer1(
-		weights[LAYER_INDEX_1], 
-		biases[LAYER_INDEX_1], 
-		activation::relu),
-	_layer2(
-		weights[LAYER_INDEX_2],
-		biases[LAYER_INDEX_2],
-		activation::relu),
-	_layer3(
-		weights[LAYER_INDEX_3],
-		biases[LAYER_INDEX_3],
-		activation::relu),
-	_layer4(
-		weights[LAYER_INDEX_4],
-		biases[LAYER_INDEX_4],
-		activation::softmax)
+	Matrix weights[MLP_SIZE], Matrix biases[MLP_SIZE], weight_format format) :
+	MlpNetwork(default_layers(weights, biases), format)
 {}
 
+// See documentation at header file
+int MlpNetwork::get_layer_count() const
+{
+	return static_cast<int>(_layers.size());
+}
+
+// See documentation at header file
+int MlpNetwork::get_input_size() const
+{
+	return _input_size;
+}
+
+// See documentation at header file
+int MlpNetwork::get_output_size() const
+{
+	return _output_size;
+}
+
+// See documentation at header file
+int MlpNetwork::get_largest_output() const
+{
+	return _largest_output;
+}
+
 // See documentation at header file
 digit MlpNetwork::operator()(Matrix image) const
 {
-	auto output = _layer4(_layer3(_layer2(
-		_layer1(image.vectorize()))));
-	auto result_index = output.argmax();
+	// Kept per thread, like the product packing buffers, and grown
+	// once to the widest network used on the thread
+	thread_local Workspace workspace;
+	if (image.get_rows() * image.get_cols() != _input_size)
+	{
+		throw std::length_error(INVALID_IMAGE_EX);
+	}
 
-	return { 
-		static_cast<unsigned int>(result_index), 
-		output[result_index]
-	};
-}
\ No newline at end of file
+	// Padded rows are gathered, not read as a single buffer
+	if (!image.is_packed())
+	{
+		return (*this)(MatrixView(image));
+	}
+
+	return forward(image.data(), workspace);
+}
+
+// See documentation at header file
+digit MlpNetwork::operator()(const MatrixView& image) const
+{
+	if (image.get_rows() * image.get_cols() != _input_size)
+	{
+		throw std::length_error(INVALID_IMAGE_EX);
+	}
+
+	thread_local Workspace workspace;
+	if (image.is_contiguous())
+	{
+		return forward(image.data(), workspace);
+	}
+
+	// Strided images are gathered in row-major order first
+	thread_local std::vector<float> gathered;
+	gathered.resize(static_cast<size_t>(_input_size));
+	float* destination = gathered.data();
+	for (int row_index = 0; row_index < image.get_rows(); row_index++)
+	{
+		for (int column_index = 0;
+			 column_index < image.get_cols();
+			 column_index++)
+		{
+			*destination++ = image(row_index, column_index);
+		}
+	}
+
+	return forward(gathered.data(), workspace);
+}
+
+// See documentation at header file
+digit MlpNetwork::forward(const float* image, Workspace& workspace) const
+{
+	digit result;
+	forward(image, 1, workspace, &result);
+	return result;
+}
+
+// See documentation at header file
+void MlpNetwork::forward(const float* images, int count,
+						 Workspace& workspace, digit* results) const
+{
+	if (0 >= count)
+	{
+		throw std::length_error(INVALID_BATCH_SIZE_EX);
+	}
+
+	forward(MatrixView(images, _input_size, count, count),
+			workspace, results);
+}
+
+// See documentation at header file
+void MlpNetwork::forward(const MatrixView& images,
+						 Workspace& workspace, digit* results) const
+{
+	const int count = images.get_cols();
+	if (count > workspace._batch)
+	{
+		throw std::length_error(WORKSPACE_TOO_SMALL_EX);
+	}
+
+	workspace.plan(_largest_output);
+
+	// Every layer reads the previous output and writes the other buffer
+	float* output = workspace._ping.data();
+	float* spare = workspace._pong.data();
+	_layers.front()->forward(images, output);
+	for (size_t layer = 1; layer < _layers.size(); layer++)
+	{
+		_layers[layer]->forward(output, spare, count);
+		std::swap(output, spare);
+	}
+
+	for (int image_index = 0; image_index < count; image_index++)
+	{
+		results[image_index] =
+			column_argmax(output, _output_size, count, image_index);
+	}
+}
+
+// See documentation at header file
+std::vector<digit> MlpNetwork::classify_batch(const MatrixView& images) const
+{
+	if (images.get_rows() != _input_size)
+	{
+		throw std::length_error(INVALID_BATCH_EX);
+	}
+
+	Workspace workspace(*this, images.get_cols());
+	std::vector<digit> results(images.get_cols());
+	forward(images, workspace, results.data());
+
+	return results;
+}
+
+// See documentation at header file
+std::vector<digit> MlpNetwork::classify_batch(
+	const float* images, int count) const
+{
+	if (0 >= count)
+	{
+		throw std::length_error(INVALID_BATCH_SIZE_EX);
+	}
+
+	// The buffer holds one image per row, read transposed in place
+	return classify_batch(
+		MatrixView(images, _input_size, count, _input_size, true));
+}
+
+// See documentation at header file
+instrumentation::snapshot MlpNetwork::get_instrumentation() const
+{
+	instrumentation::snapshot result = {instrumentation::ENABLED, {}, {}};
+	for (const auto& layer : _layers)
+	{
+		result.layers.push_back(layer->get_counters());
+		instrumentation::accumulate(result.total, result.layers.back());
+	}
+
+	return result;
+}
+
+// See documentation at header file
+void MlpNetwork::reset_instrumentation() const
+{
+	for (const auto& layer : _layers)
+	{
+		layer->reset_counters();
+	}
+}
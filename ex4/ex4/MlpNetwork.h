@@ -3,10 +3,23 @@
 #ifndef MLPNETWORK_H
 #define MLPNETWORK_H
 
+#include <memory>
+#include <vector>
+
 #include "Dense.h"
+#include "MatrixView.h"
 
 #define MLP_SIZE 4
 
+// Exception descriptions
+#define INVALID_IMAGE_EX ("Image size must match the network input")
+
+namespace model
+{
+	// A layer of a model description (see ModelFile.h)
+	struct layer;
+}
+
 /**
  * @struct digit
  * @brief Identified (by Mlp network) digit with
@@ -19,29 +32,107 @@ typedef struct digit {
 	float probability;
 } digit;
 
-const matrix_dims img_dims = {28, 28};
-const matrix_dims weights_dims[] = {{128, 784},
+constexpr matrix_dims img_dims = {28, 28};
+constexpr matrix_dims weights_dims[] = {{128, 784},
 									{64,  128},
 									{20,  64},
 									{10,  20}};
-const matrix_dims bias_dims[] = {{128, 1},
+constexpr matrix_dims bias_dims[] = {{128, 1},
 								 {64,  1},
 								 {20,  1},
 								 {10,  1}};
 
+class MlpNetwork;
+
+/**
+ * @class Workspace
+ * @brief Preallocated activation buffers for MlpNetwork::forward.
+ *		  Holds two ping-pong buffers, each sized for the largest
+ *		  layer output of a network over a batch, so layers alternate
+ *		  between them and inference does not allocate.
+ *		  A workspace planned without a network grows its buffers on
+ *		  the first forward pass of every wider network, and is then
+ *		  reused without allocating.
+ *		  A workspace may only be used by one thread at a time.
+ */
+class Workspace
+{
+public:
+	/**
+	* Plans a batch size, leaving the buffers to the first forward pass.
+	* @param batch - The maximal number of images per forward pass.
+	* @throws std::length_error in case batch is not positive.
+	*/
+	explicit Workspace(int batch = 1);
+
+	/**
+	* Plans the buffers for a network, for batches of up to the given
+	* size, from the network's actual layer shapes.
+	* @param network - The network the workspace is used with.
+	* @param batch - The maximal number of images per forward pass.
+	* @throws std::length_error in case batch is not positive.
+	*/
+	explicit Workspace(const MlpNetwork& network, int batch = 1);
+
+	/**
+	* Gets the maximal number of images per forward pass.
+	* @return The batch size the workspace was planned for.
+	*/
+	int get_batch() const;
+
+private:
+	friend class MlpNetwork;
+
+	/**
+	* Grows both buffers to hold the given number of floats per image,
+	* allocating only when they are smaller.
+	*/
+	void plan(int width);
+
+	// Maximal images per forward pass
+	int _batch;
+	// Layer outputs alternate between these buffers
+	std::vector<float> _ping;
+	std::vector<float> _pong;
+};
+
 /**
  * @class MlpNetwork
- * @brief Represents a neural network with multiple layers
+ * @brief Represents a neural network of any number of Dense layers,
+ *		  of any widths, each with its own activation. The default
+ *		  network is the MLP_SIZE layers of weights_dims.
+ *		  The network is immutable once constructed, and every const
+ *		  member is safe to call concurrently from any number of
+ *		  threads: the layers are only read, and every scratch buffer
+ *		  is either a caller's Workspace or kept per thread (see
+ *		  InferencePool).
  */
 class MlpNetwork
 {
 public:
 	/**
-	* Constructs a neural network of 4 layers.
+	* Constructs a neural network from a model description, such as a
+	* loaded model file (see model::load).
+	* @param layers - The layers, in order. The first layer takes the
+	*				  image, every other one the previous layer output.
+	* @param format - The format of the weights in every layer's product.
+	* @throws std::length_error in case there are no layers, a layer
+	*		  column count is not the previous layer row count, or a
+	*		  bias does not match its weights.
+	*/
+	explicit MlpNetwork(const std::vector<model::layer>& layers,
+						weight_format format = weight_format::FP32);
+
+	/**
+	* Constructs the default neural network, of MLP_SIZE layers with
+	* the shapes of weights_dims, ReLU activated but the last, Softmax
+	* activated.
 	* @param weights - The weights matrices for each layer
 	* @param biases - The biases matrices for each layer.
+	* @param format - The format of the weights in every layer's product.
 	*/
-	MlpNetwork(Matrix weights[MLP_SIZE], Matrix biases[MLP_SIZE]);
+	MlpNetwork(Matrix weights[MLP_SIZE], Matrix biases[MLP_SIZE],
+			   weight_format format = weight_format::FP32);
 
 	// Explicitly defining behavior to prevent implicit behavior
 	MlpNetwork() = delete;
@@ -49,19 +140,128 @@ public:
 	MlpNetwork& operator=(MlpNetwork&) = delete;
 	~MlpNetwork() = default;
 
+	/**
+	* Gets the number of layers.
+	*/
+	int get_layer_count() const;
+
+	/**
+	* Gets the image size, in pixels, taken by the first layer.
+	*/
+	int get_input_size() const;
+
+	/**
+	* Gets the output size of the last layer.
+	*/
+	int get_output_size() const;
+
+	/**
+	* Gets the largest output size of any layer, the workspace floats
+	* needed per image.
+	*/
+	int get_largest_output() const;
+
 	/**
 	* Activates the neural network on a given image.
+	* Uses a workspace kept per calling thread, so only the image
+	* argument itself is allocated (and not when it is moved in).
 	* @param image - The image to analyze.
+	* @throws std::length_error in case the image size is not the
+	*		  network input size.
 	* @return The neural network results.
 	*/
 	digit operator()(Matrix image) const;
 
+	/**
+	* Activates the neural network on an image read through a view,
+	* such as a row of a buffer holding many images, without copying
+	* it when its elements are contiguous. The image is read in
+	* row-major order of the view (as Matrix::vectorize would).
+	* @param image - The image to analyze.
+	* @throws std::length_error in case the image size is not the
+	*		  network input size.
+	* @return The neural network results.
+	*/
+	digit operator()(const MatrixView& image) const;
+
+	/**
+	* Activates the neural network on a single image, with every
+	* layer output written into the given workspace. Makes no
+	* allocations. Safe to call concurrently with distinct workspaces.
+	* @param image - The image pixels, contiguous (image size floats).
+	* @param workspace - The workspace holding the layer outputs.
+	* @return The neural network results.
+	*/
+	digit forward(const float* image, Workspace& workspace) const;
+
+	/**
+	* Activates the neural network on a batch of images, with every
+	* layer output written into the given workspace. Makes no
+	* allocations once the product kernels have warmed up their
+	* per-thread packing buffers.
+	* @param images - The images, row-major (image size x count),
+	*				  one image per column.
+	* @param count - The number of images.
+	* @param workspace - The workspace holding the layer outputs.
+	* @param results - Output, the results for every image, in order.
+	* @throws std::length_error in case count is not positive or is
+	*		  larger than the workspace batch.
+	*/
+	void forward(const float* images, int count,
+				 Workspace& workspace, digit* results) const;
+
+	/**
+	* Same as above, reading the images through a view, which may be
+	* strided or transposed (a transposed view of a buffer holding one
+	* image per row is read in place, with no transposition copy).
+	* Dimensions are not checked.
+	* @param images - The images view (image size x count).
+	*/
+	void forward(const MatrixView& images,
+				 Workspace& workspace, digit* results) const;
+
+	/**
+	* Activates the neural network on a batch of images.
+	* Every layer runs as a single matrix-matrix product over the
+	* whole batch, so the weights are streamed once per batch.
+	* @param images - The vectorized images, one image per column
+	*				  (image size x batch size), as a matrix or a view.
+	* @throws std::length_error in case the row count is not the
+	*		  image size.
+	* @return The neural network results, one per image, in order.
+	*/
+	std::vector<digit> classify_batch(const MatrixView& images) const;
+
+	/**
+	* Activates the neural network on a contiguous buffer of images.
+	* @param images - The images, stored one after the other.
+	* @param count - The number of images in the buffer.
+	* @throws std::length_error in case count is not positive.
+	* @return The neural network results, one per image, in order.
+	*/
+	std::vector<digit> classify_batch(const float* images, int count) const;
+
+	/**
+	* Gets the work counted by every layer, over every thread, all 0
+	* unless built with MLP_INSTRUMENTATION (see instrumentation).
+	* @return The counters of every layer and their sum.
+	*/
+	instrumentation::snapshot get_instrumentation() const;
+
+	/**
+	* Sets the work counted by every layer back to 0.
+	*/
+	void reset_instrumentation() const;
+
 private:
-	// All layers of the network
-	const Dense _layer1;
-	const Dense _layer2;
-	const Dense _layer3;
-	const Dense _layer4;
+	// All layers of the network, in order
+	std::vector<std::unique_ptr<const Dense>> _layers;
+	// Image size, in pixels
+	int _input_size;
+	// Output size of the last layer
+	int _output_size;
+	// Largest output size of any layer
+	int _largest_output;
 };
 
 #endif // MLPNETWORK_H
\ No newline at end of file
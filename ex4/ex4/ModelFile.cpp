@@ -0,0 +1,248 @@
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+#include "ModelFile.h"
+#include "MappedFile.h"
+
+// Exception descriptions
+#define INVALID_MODEL_EX ("Invalid model file: ")
+#define CHECKSUM_MISMATCH_EX ("Model checksum mismatch: ")
+#define MODEL_MISMATCH_EX ("Model layers do not match the network: ")
+#define WRITE_FAILED_EX ("Failed to write model file: ")
+#define UNSUPPORTED_ACTIVATION_EX ("Unsupported layer activation")
+#define INVALID_BIAS_EX ("Bias must be a single column per weights row")
+
+// FNV-1a 64 bit hash parameters
+constexpr uint64_t fnv_offset_basis = 14695981039346656037ULL;
+constexpr uint64_t fnv_prime = 1099511628211ULL;
+
+/**
+* Hashes a byte range with FNV-1a, continuing from the given hash.
+*/
+static uint64_t fnv1a(const unsigned char* bytes, uint64_t size,
+					  uint64_t hash = fnv_offset_basis)
+{
+	for (uint64_t index = 0; index < size; index++)
+	{
+		hash = (hash ^ bytes[index]) * fnv_prime;
+	}
+
+	return hash;
+}
+
+/**
+* Copies the cells of a matrix, packed, into a file image.
+*/
+static void write_tensor(const Matrix& tensor, unsigned char* destination)
+{
+	const size_t row_size = sizeof(float) * tensor.get_cols();
+	for (int row = 0; row < tensor.get_rows(); row++)
+	{
+		std::memcpy(destination + (row * row_size),
+					tensor.data() + (row * tensor.get_stride()), row_size);
+	}
+}
+
+/**
+* Rounds an offset up to the tensor alignment.
+*/
+static uint64_t align_offset(uint64_t offset)
+{
+	return ((offset + model::TENSOR_ALIGNMENT - 1) /
+			model::TENSOR_ALIGNMENT) * model::TENSOR_ALIGNMENT;
+}
+
+/**
+* Getting the size in bytes of a float tensor.
+*/
+static uint64_t tensor_size(int rows, int cols)
+{
+	return sizeof(float) * static_cast<uint64_t>(rows) * cols;
+}
+
+/**
+* Checks a tensor lies within the file, after the layer table. Written
+* so no sum can wrap around, whatever the offset.
+* @param offset - The file offset of the tensor.
+* @param size - The size of the tensor in bytes.
+* @param table_end - The end of the layer table.
+* @param file_size - The size of the file.
+* @return True when the tensor is in bounds.
+*/
+static bool tensor_in_bounds(uint64_t offset, uint64_t size,
+							 uint64_t table_end, uint64_t file_size)
+{
+	return (offset >= table_end) && (offset <= file_size) &&
+		   (size <= file_size - offset);
+}
+
+// See documentation at header file
+void model::save(const std::string& path, const std::vector<layer>& layers)
+{
+	std::vector<model_layer> table(layers.size());
+	uint64_t offset = sizeof(model_header) +
+					  (sizeof(model_layer) * layers.size());
+	for (size_t index = 0; index < layers.size(); index++)
+	{
+		const layer& source = layers[index];
+		if ((source.bias.get_rows() != source.weights.get_rows()) ||
+			(1 != source.bias.get_cols()))
+		{
+			throw std::invalid_argument(INVALID_BIAS_EX);
+		}
+
+		model_layer& entry = table[index];
+		entry.rows = source.weights.get_rows();
+		entry.cols = source.weights.get_cols();
+		entry.type = static_cast<uint32_t>(dtype::FLOAT32);
+		if (activation::relu == source.activation)
+		{
+			entry.activation = static_cast<uint32_t>(activation_kind::RELU);
+		}
+		else if (activation::softmax == source.activation)
+		{
+			entry.activation =
+				static_cast<uint32_t>(activation_kind::SOFTMAX);
+		}
+		else
+		{
+			throw std::invalid_argument(UNSUPPORTED_ACTIVATION_EX);
+		}
+
+		entry.weights_offset = align_offset(offset);
+		offset = entry.weights_offset + tensor_size(entry.rows, entry.cols);
+		entry.bias_offset = align_offset(offset);
+		offset = entry.bias_offset + tensor_size(entry.rows, 1);
+	}
+
+	// The whole file is built in memory, so the checksum can be
+	// computed before writing it in a single write
+	std::vector<unsigned char> contents(offset, 0);
+	std::memcpy(contents.data() + sizeof(model_header), table.data(),
+				sizeof(model_layer) * table.size());
+	for (size_t index = 0; index < layers.size(); index++)
+	{
+		write_tensor(layers[index].weights,
+					 contents.data() + table[index].weights_offset);
+		write_tensor(layers[index].bias,
+					 contents.data() + table[index].bias_offset);
+	}
+
+	model_header header = {};
+	std::memcpy(header.magic, MAGIC, sizeof(header.magic));
+	header.version = VERSION;
+	header.layer_count = static_cast<uint32_t>(layers.size());
+	header.size = offset;
+	header.checksum = fnv1a(contents.data() + sizeof(model_header),
+							offset - sizeof(model_header));
+	std::memcpy(contents.data(), &header, sizeof(header));
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(contents.data()),
+			   static_cast<std::streamsize>(contents.size()));
+	if (!file.good())
+	{
+		throw std::runtime_error(WRITE_FAILED_EX + path);
+	}
+}
+
+// See documentation at header file
+std::vector<model::layer> model::load(const std::string& path, bool verify)
+{
+	auto file = std::make_shared<const MappedFile>(path);
+	const auto* bytes = static_cast<const unsigned char*>(file->data());
+
+	model_header header = {};
+	if ((file->size() < sizeof(header)) ||
+		(0 != std::memcmp(bytes, MAGIC, sizeof(MAGIC))))
+	{
+		throw std::runtime_error(INVALID_MODEL_EX + path);
+	}
+
+	std::memcpy(&header, bytes, sizeof(header));
+	const uint64_t table_end = sizeof(header) +
+		(sizeof(model_layer) * static_cast<uint64_t>(header.layer_count));
+	if ((VERSION != header.version) || (header.size != file->size()) ||
+		(table_end > header.size))
+	{
+		throw std::runtime_error(INVALID_MODEL_EX + path);
+	}
+
+	if (verify && (header.checksum !=
+				   fnv1a(bytes + sizeof(header), header.size - sizeof(header))))
+	{
+		throw std::runtime_error(CHECKSUM_MISMATCH_EX + path);
+	}
+
+	std::vector<layer> layers;
+	layers.reserve(header.layer_count);
+	for (uint32_t index = 0; index < header.layer_count; index++)
+	{
+		model_layer entry = {};
+		std::memcpy(&entry,
+					bytes + sizeof(header) + (index * sizeof(model_layer)),
+					sizeof(entry));
+
+		const bool valid_shape = (0 < entry.rows) && (0 < entry.cols) &&
+			(entry.weights_offset % TENSOR_ALIGNMENT == 0) &&
+			(entry.bias_offset % TENSOR_ALIGNMENT == 0) &&
+			tensor_in_bounds(entry.weights_offset,
+							 tensor_size(entry.rows, entry.cols), table_end,
+							 header.size) &&
+			tensor_in_bounds(entry.bias_offset, tensor_size(entry.rows, 1),
+							 table_end, header.size);
+		const bool valid_activation =
+			(static_cast<uint32_t>(activation_kind::RELU) ==
+			 entry.activation) ||
+			(static_cast<uint32_t>(activation_kind::SOFTMAX) ==
+			 entry.activation);
+		if (!valid_shape || !valid_activation ||
+			(static_cast<uint32_t>(dtype::FLOAT32) != entry.type))
+		{
+			throw std::runtime_error(INVALID_MODEL_EX + path);
+		}
+
+		// Every matrix holds the mapping, which lives as long as any does
+		const auto* weights =
+			reinterpret_cast<const float*>(bytes + entry.weights_offset);
+		const auto* bias =
+			reinterpret_cast<const float*>(bytes + entry.bias_offset);
+		layers.push_back({
+			Matrix(entry.rows, entry.cols, weights, file),
+			Matrix(entry.rows, 1, bias, file),
+			(static_cast<uint32_t>(activation_kind::RELU) ==
+			 entry.activation) ? activation::relu : activation::softmax
+		});
+	}
+
+	return layers;
+}
+
+// See documentation at header file
+void model::load_mlp(const std::string& path,
+					 Matrix weights[MLP_SIZE], Matrix biases[MLP_SIZE])
+{
+	std::vector<layer> layers = load(path);
+	if (MLP_SIZE != static_cast<int>(layers.size()))
+	{
+		throw std::runtime_error(MODEL_MISMATCH_EX + path);
+	}
+
+	for (int index = 0; index < MLP_SIZE; index++)
+	{
+		const activation::ActivationPfn expected_activation =
+			(MLP_SIZE - 1 == index) ? activation::softmax : activation::relu;
+		if ((weights_dims[index].rows != layers[index].weights.get_rows()) ||
+			(weights_dims[index].cols != layers[index].weights.get_cols()) ||
+			(expected_activation != layers[index].activation))
+		{
+			throw std::runtime_error(MODEL_MISMATCH_EX + path);
+		}
+
+		weights[index] = std::move(layers[index].weights);
+		biases[index] = std::move(layers[index].bias);
+	}
+}
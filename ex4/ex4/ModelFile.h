@@ -0,0 +1,141 @@
+#ifndef MODELFILE_H
+#define MODELFILE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Activation.h"
+#include "MlpNetwork.h"
+
+/**
+* Single-file packed model format.
+*
+* A model file holds every layer of a network: a header, a table
+* describing every layer, then the tensors. Every tensor starts on a
+* TENSOR_ALIGNMENT boundary and is stored exactly as a Matrix stores
+* its cells (row-major, host byte order, little-endian on the
+* supported platforms), so a loaded model uses the mapped file as is.
+*
+*	model_header
+*	model_layer[layer_count]
+*	tensors, each TENSOR_ALIGNMENT aligned (weights, then bias,
+*	for every layer)
+*/
+namespace model
+{
+	// Identifies model files, the first bytes of the header
+	constexpr char MAGIC[8] = {'M', 'L', 'P', 'M', 'O', 'D', 'E', 'L'};
+	// Format version written by save
+	constexpr uint32_t VERSION = 1;
+	// Alignment, in bytes, of every tensor within the file
+	constexpr uint64_t TENSOR_ALIGNMENT = 64;
+
+	/**
+	 * @enum dtype
+	 * @brief Element type of a stored tensor.
+	 */
+	enum class dtype : uint32_t
+	{
+		FLOAT32 = 0
+	};
+
+	/**
+	 * @enum activation_kind
+	 * @brief Activation of a stored layer.
+	 */
+	enum class activation_kind : uint32_t
+	{
+		RELU = 0,
+		SOFTMAX = 1
+	};
+
+	/**
+	 * @struct model_header
+	 * @brief The first bytes of a model file.
+	 * @var magic - MAGIC.
+	 * @var version - The format version.
+	 * @var layer_count - The number of layers in the table.
+	 * @var checksum - FNV-1a hash of every byte after the header.
+	 * @var size - The total size of the file in bytes.
+	 */
+	typedef struct model_header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t layer_count;
+		uint64_t checksum;
+		uint64_t size;
+	} model_header;
+
+	/**
+	 * @struct model_layer
+	 * @brief Table entry describing one layer.
+	 * @var rows - Row count of the weights (and of the bias).
+	 * @var cols - Column count of the weights.
+	 * @var type - Element type of both tensors (see dtype).
+	 * @var activation - The layer activation (see activation_kind).
+	 * @var weights_offset - File offset of the weights tensor.
+	 * @var bias_offset - File offset of the bias tensor (rows x 1).
+	 */
+	typedef struct model_layer
+	{
+		int32_t rows;
+		int32_t cols;
+		uint32_t type;
+		uint32_t activation;
+		uint64_t weights_offset;
+		uint64_t bias_offset;
+	} model_layer;
+
+	/**
+	 * @struct layer
+	 * @brief A loaded (or to be saved) layer.
+	 * @var weights - The weights matrix.
+	 * @var bias - The bias matrix.
+	 * @var activation - The activation function, relu or softmax.
+	 */
+	typedef struct layer
+	{
+		Matrix weights;
+		Matrix bias;
+		activation::ActivationPfn activation;
+	} layer;
+
+	/**
+	* Writes layers to a model file.
+	* @param path - The file to write.
+	* @param layers - The layers, in order.
+	* @throws std::invalid_argument in case a layer activation is not
+	*		  relu or softmax, or a bias shape does not match.
+	* @throws std::runtime_error in case the file cannot be written.
+	*/
+	void save(const std::string& path, const std::vector<layer>& layers);
+
+	/**
+	* Loads every layer of a model file, with a single open and a single
+	* mapping. The matrices borrow the mapped tensors (see map_matrix),
+	* nothing is copied.
+	* @param path - The model file.
+	* @param verify - Whether to check the checksum, which reads the
+	*				  whole file.
+	* @throws std::runtime_error in case the file cannot be mapped, is
+	*		  not a valid model file, or fails the checksum.
+	* @return The layers, in order.
+	*/
+	std::vector<layer> load(const std::string& path, bool verify = true);
+
+	/**
+	* Loads a model file for MlpNetwork, which must hold MLP_SIZE layers
+	* of weights_dims, ReLU activated but the last, Softmax activated.
+	* @param path - The model file.
+	* @param weights - Output, the weights of every layer.
+	* @param biases - Output, the biases of every layer.
+	* @throws std::runtime_error as load, or in case the layers do not
+	*		  match MlpNetwork.
+	*/
+	void load_mlp(const std::string& path,
+				  Matrix weights[MLP_SIZE], Matrix biases[MLP_SIZE]);
+}
+
+#endif //MODELFILE_H
@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <cmath>
+
+#include "QuantizedMatrix.h"
+
+// Largest magnitude of a quantized value
+constexpr float quantized_max = 127.0F;
+
+/**
+* Rounds a size up to QuantizedMatrix::ALIGNMENT.
+*/
+static int align_size(int size)
+{
+	return ((size + QuantizedMatrix::ALIGNMENT - 1) /
+			QuantizedMatrix::ALIGNMENT) * QuantizedMatrix::ALIGNMENT;
+}
+
+// See documentation at header file
+QuantizedMatrix::QuantizedMatrix(const Matrix& matrix) :
+	_rows(matrix.get_rows()),
+	_columns(matrix.get_cols()),
+	_stride(align_size(matrix.get_cols())),
+	_values(static_cast<size_t>(_rows) * _stride),
+	_scales(static_cast<size_t>(_rows))
+{
+	for (int row = 0; row < _rows; row++)
+	{
+		_scales[row] = quantize_vector(matrix.data() +
+									   (row * matrix.get_stride()),
+									   _columns, 1,
+									   _values.data() + (row * _stride));
+	}
+}
+
+// See documentation at header file
+int QuantizedMatrix::get_rows() const
+{
+	return _rows;
+}
+
+// See documentation at header file
+int QuantizedMatrix::get_cols() const
+{
+	return _columns;
+}
+
+// See documentation at header file
+int QuantizedMatrix::get_stride() const
+{
+	return _stride;
+}
+
+// See documentation at header file
+const int8_t* QuantizedMatrix::data() const
+{
+	return _values.data();
+}
+
+// See documentation at header file
+const float* QuantizedMatrix::scales() const
+{
+	return _scales.data();
+}
+
+// See documentation at header file
+Matrix QuantizedMatrix::to_matrix() const
+{
+	Matrix matrix(_rows, _columns);
+	float* destination = matrix.data();
+	for (int row = 0; row < _rows; row++)
+	{
+		for (int col = 0; col < _columns; col++)
+		{
+			*destination++ = _values[(row * _stride) + col] * _scales[row];
+		}
+	}
+
+	return matrix;
+}
+
+// See documentation at header file
+float QuantizedMatrix::quantize_vector(const float* vector, int size,
+									   int stride, int8_t* quantized)
+{
+	float max_magnitude = 0;
+	for (int index = 0; index < size; index++)
+	{
+		max_magnitude = std::max(max_magnitude,
+								 std::fabs(vector[index * stride]));
+	}
+
+	// An all-zero vector quantizes to zeros with any scale
+	const float scale = (0 < max_magnitude) ?
+		max_magnitude / quantized_max : 1.0F;
+	const float inverse_scale = 1.0F / scale;
+	for (int index = 0; index < size; index++)
+	{
+		// Rounding half away from zero, without a library call per value
+		const float value = vector[index * stride] * inverse_scale;
+		quantized[index] = static_cast<int8_t>(
+			value + ((value < 0) ? -0.5F : 0.5F));
+	}
+	std::fill(quantized + size, quantized + align_size(size), 0);
+
+	return scale;
+}
@@ -0,0 +1,85 @@
+#ifndef QUANTIZEDMATRIX_H
+#define QUANTIZEDMATRIX_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Matrix.h"
+
+/**
+* @class QuantizedMatrix
+ * @brief Read-only INT8 copy of a matrix, with symmetric per-row
+ *		  scales: every row is stored as round(value / scale), with
+ *		  scale = max |value| / 127, so it spans [-127, 127].
+ *		  Rows are zero padded to a multiple of ALIGNMENT values, so
+ *		  kernels only read whole registers.
+ */
+class QuantizedMatrix
+{
+public:
+	// Row length granularity, in values (one AVX-512 register)
+	static constexpr int ALIGNMENT = 64;
+
+	/**
+	* Quantizes the given matrix.
+	* @param matrix - The matrix to quantize.
+	*/
+	explicit QuantizedMatrix(const Matrix& matrix);
+
+	/**
+	* Getting the number of rows in the matrix.
+	*/
+	int get_rows() const;
+
+	/**
+	* Getting the number of columns in the matrix.
+	*/
+	int get_cols() const;
+
+	/**
+	* Getting the distance, in values, between two stored rows
+	* (the column count rounded up to ALIGNMENT).
+	*/
+	int get_stride() const;
+
+	/**
+	* Getting the quantized values, rows stored one after the other.
+	*/
+	const int8_t* data() const;
+
+	/**
+	* Getting the scale of every row.
+	*/
+	const float* scales() const;
+
+	/**
+	* Dequantizing the matrix back to floating-point.
+	* @return The matrix, value * scale for every cell.
+	*/
+	Matrix to_matrix() const;
+
+	/**
+	* Quantizes a vector symmetrically with a single scale, as the
+	* rows of a quantized matrix are.
+	* @param vector - The vector to quantize.
+	* @param size - The number of values in the vector.
+	* @param stride - Distance, in floats, between two values.
+	* @param quantized - Output, the quantized values. Zero padded up
+	*					 to size rounded up to ALIGNMENT.
+	* @return The scale of the quantized vector.
+	*/
+	static float quantize_vector(const float* vector, int size, int stride,
+								 int8_t* quantized);
+
+private:
+	int _rows;
+	int _columns;
+	// Row stride of _values
+	int _stride;
+	// The quantized values, _rows x _stride
+	std::vector<int8_t> _values;
+	// The scale of every row
+	std::vector<float> _scales;
+};
+
+#endif //QUANTIZEDMATRIX_H
@@ -0,0 +1,310 @@
+#include <limits>
+
+#include "Reduction.h"
+#include "SimdHelpers.h"
+
+// Independent accumulators kept by every block kernel
+constexpr int ACCUMULATORS = 4;
+
+// Sums a block of at most PAIRWISE_BLOCK values
+using BlockPfn = float (*)(const float* data, int count);
+
+/**
+* Portable block kernel, ACCUMULATORS independent scalar sums.
+* @tparam Square - Whether the squares of the values are summed.
+*/
+template <bool Square>
+static float block_scalar(const float* data, int count)
+{
+	float sums[ACCUMULATORS] = {};
+	int index = 0;
+	for (; index + ACCUMULATORS <= count; index += ACCUMULATORS)
+	{
+		for (int lane = 0; lane < ACCUMULATORS; lane++)
+		{
+			const float value = data[index + lane];
+			sums[lane] += Square ? (value * value) : value;
+		}
+	}
+	for (; index < count; index++)
+	{
+		sums[0] += Square ? (data[index] * data[index]) : data[index];
+	}
+
+	return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+}
+
+/**
+* Portable argmax, skipping NaN values.
+*/
+static reduction::indexed_max argmax_scalar(const float* data, int count)
+{
+	int best_index = 0;
+	float best = -std::numeric_limits<float>::infinity();
+	for (int index = 0; index < count; index++)
+	{
+		if (best < data[index])
+		{
+			best = data[index];
+			best_index = index;
+		}
+	}
+
+	return {best_index, data[best_index]};
+}
+
+#if SIMD_X86
+
+/**
+* Adds a vector, or its square, to an accumulator.
+*/
+template <bool Square>
+SIMD_TARGET("avx2,fma")
+static inline __m256 accumulate_avx2(__m256 sum, __m256 value)
+{
+	return Square ? _mm256_fmadd_ps(value, value, sum) :
+					_mm256_add_ps(sum, value);
+}
+
+/**
+* AVX2/FMA block kernel, ACCUMULATORS vector sums of 8 lanes, the
+* tail through masked lanes.
+*/
+template <bool Square>
+SIMD_TARGET("avx2,fma")
+static float block_avx2(const float* data, int count)
+{
+	__m256 sums[ACCUMULATORS];
+	for (auto& sum : sums)
+	{
+		sum = _mm256_setzero_ps();
+	}
+
+	int index = 0;
+	for (; index + (ACCUMULATORS * 8) <= count; index += ACCUMULATORS * 8)
+	{
+		for (int lane = 0; lane < ACCUMULATORS; lane++)
+		{
+			sums[lane] = accumulate_avx2<Square>(
+				sums[lane], _mm256_loadu_ps(data + index + (lane * 8)));
+		}
+	}
+	for (; index < count; index += 8)
+	{
+		sums[0] = accumulate_avx2<Square>(sums[0], _mm256_maskload_ps(
+			data + index, tail_mask_avx2(count - index)));
+	}
+
+	return horizontal_sum_avx2(_mm256_add_ps(
+		_mm256_add_ps(sums[0], sums[1]), _mm256_add_ps(sums[2], sums[3])));
+}
+
+/**
+* Adds a vector, or its square, to an accumulator.
+*/
+SIMD_AVX512_BEGIN
+template <bool Square>
+SIMD_TARGET("avx512f,avx2,fma")
+static inline __m512 accumulate_avx512(__m512 sum, __m512 value)
+{
+	return Square ? _mm512_fmadd_ps(value, value, sum) :
+					_mm512_add_ps(sum, value);
+}
+SIMD_AVX512_END
+
+/**
+* AVX-512 block kernel, ACCUMULATORS vector sums of 16 lanes, the
+* tail through masked lanes.
+*/
+SIMD_AVX512_BEGIN
+template <bool Square>
+SIMD_TARGET("avx512f,avx2,fma")
+static float block_avx512(const float* data, int count)
+{
+	__m512 sums[ACCUMULATORS];
+	for (auto& sum : sums)
+	{
+		sum = _mm512_setzero_ps();
+	}
+
+	int index = 0;
+	for (; index + (ACCUMULATORS * 16) <= count; index += ACCUMULATORS * 16)
+	{
+		for (int lane = 0; lane < ACCUMULATORS; lane++)
+		{
+			sums[lane] = accumulate_avx512<Square>(
+				sums[lane], _mm512_loadu_ps(data + index + (lane * 16)));
+		}
+	}
+	for (; index < count; index += 16)
+	{
+		sums[0] = accumulate_avx512<Square>(sums[0], _mm512_maskz_loadu_ps(
+			tail_mask_avx512(count - index), data + index));
+	}
+
+	return _mm512_reduce_add_ps(_mm512_add_ps(
+		_mm512_add_ps(sums[0], sums[1]), _mm512_add_ps(sums[2], sums[3])));
+}
+SIMD_AVX512_END
+
+/**
+* AVX2 argmax: every lane keeps its first maximum and its index, then
+* the lanes are merged keeping the lowest index of the maximum.
+*/
+SIMD_TARGET("avx2,fma")
+static reduction::indexed_max argmax_avx2(const float* data, int count)
+{
+	const __m256 lowest =
+		_mm256_set1_ps(-std::numeric_limits<float>::infinity());
+	__m256 best = lowest;
+	__m256i best_indices = _mm256_setzero_si256();
+	__m256i indices = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	for (int index = 0; index < count; index += 8)
+	{
+		const __m256i mask = tail_mask_avx2(count - index);
+		const __m256 value = _mm256_blendv_ps(
+			lowest, _mm256_maskload_ps(data + index, mask),
+			_mm256_castsi256_ps(mask));
+		const __m256 greater = _mm256_cmp_ps(value, best, _CMP_GT_OQ);
+		best = _mm256_blendv_ps(best, value, greater);
+		best_indices = _mm256_blendv_epi8(best_indices, indices,
+										  _mm256_castps_si256(greater));
+		indices = _mm256_add_epi32(indices, _mm256_set1_epi32(8));
+	}
+
+	float lane_best[8];
+	int lane_indices[8];
+	_mm256_storeu_ps(lane_best, best);
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(lane_indices),
+						best_indices);
+	int best_index = lane_indices[0];
+	for (int lane = 1; lane < 8; lane++)
+	{
+		if ((lane_best[0] < lane_best[lane]) ||
+			((lane_best[0] == lane_best[lane]) &&
+			 (lane_indices[lane] < best_index)))
+		{
+			lane_best[0] = lane_best[lane];
+			best_index = lane_indices[lane];
+		}
+	}
+
+	return {best_index, data[best_index]};
+}
+
+/**
+* AVX-512 argmax (see argmax_avx2).
+*/
+SIMD_AVX512_BEGIN
+SIMD_TARGET("avx512f,avx2,fma")
+static reduction::indexed_max argmax_avx512(const float* data, int count)
+{
+	const __m512 lowest =
+		_mm512_set1_ps(-std::numeric_limits<float>::infinity());
+	__m512 best = lowest;
+	__m512i best_indices = _mm512_setzero_si512();
+	__m512i indices = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7,
+										8, 9, 10, 11, 12, 13, 14, 15);
+	for (int index = 0; index < count; index += 16)
+	{
+		const __m512 value = _mm512_mask_loadu_ps(
+			lowest, tail_mask_avx512(count - index), data + index);
+		const __mmask16 greater = _mm512_cmp_ps_mask(value, best, _CMP_GT_OQ);
+		best = _mm512_mask_mov_ps(best, greater, value);
+		best_indices = _mm512_mask_mov_epi32(best_indices, greater, indices);
+		indices = _mm512_add_epi32(indices, _mm512_set1_epi32(16));
+	}
+
+	const float maximum = _mm512_reduce_max_ps(best);
+	const __mmask16 maximal =
+		_mm512_cmp_ps_mask(best, _mm512_set1_ps(maximum), _CMP_EQ_OQ);
+	const int best_index = _mm512_mask_reduce_min_epi32(maximal, best_indices);
+
+	return {best_index, data[best_index]};
+}
+SIMD_AVX512_END
+
+#endif
+
+/**
+* Sums a buffer by halving it down to blocks for the block kernel,
+* the halves split on a block boundary.
+*/
+static float pairwise(BlockPfn block, const float* data, int count)
+{
+	if (reduction::PAIRWISE_BLOCK >= count)
+	{
+		return block(data, count);
+	}
+
+	const int half = (((count / 2) + reduction::PAIRWISE_BLOCK - 1) /
+					  reduction::PAIRWISE_BLOCK) * reduction::PAIRWISE_BLOCK;
+	return pairwise(block, data, half) +
+		   pairwise(block, data + half, count - half);
+}
+
+/**
+* Gets the block kernel of an instruction set.
+*/
+template <bool Square>
+static BlockPfn block_kernel(simd::isa set)
+{
+	switch (set)
+	{
+#if SIMD_X86
+	case simd::isa::AVX512:
+		return block_avx512<Square>;
+	case simd::isa::AVX2:
+		return block_avx2<Square>;
+#endif
+	default:
+		return block_scalar<Square>;
+	}
+}
+
+// See documentation at header file
+float reduction::sum(const float* data, int count)
+{
+	return sum(simd::active_isa(), data, count);
+}
+
+// See documentation at header file
+float reduction::sum(simd::isa set, const float* data, int count)
+{
+	return pairwise(block_kernel<false>(set), data, count);
+}
+
+// See documentation at header file
+float reduction::sum_of_squares(const float* data, int count)
+{
+	return sum_of_squares(simd::active_isa(), data, count);
+}
+
+// See documentation at header file
+float reduction::sum_of_squares(simd::isa set, const float* data, int count)
+{
+	return pairwise(block_kernel<true>(set), data, count);
+}
+
+// See documentation at header file
+reduction::indexed_max reduction::argmax(const float* data, int count)
+{
+	return argmax(simd::active_isa(), data, count);
+}
+
+// See documentation at header file
+reduction::indexed_max reduction::argmax(simd::isa set, const float* data,
+										 int count)
+{
+	switch (set)
+	{
+#if SIMD_X86
+	case simd::isa::AVX512:
+		return argmax_avx512(data, count);
+	case simd::isa::AVX2:
+		return argmax_avx2(data, count);
+#endif
+	default:
+		return argmax_scalar(data, count);
+	}
+}
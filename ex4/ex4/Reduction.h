@@ -0,0 +1,78 @@
+#ifndef REDUCTION_H
+#define REDUCTION_H
+
+#include "Simd.h"
+
+/**
+* Vectorized reductions over contiguous buffers.
+* Sums are pairwise: the buffer is halved recursively down to blocks
+* of PAIRWISE_BLOCK values, each summed over several vector
+* accumulators, so the rounding error grows with log(count) rather
+* than with count. The kernel is selected at runtime for the CPU
+* (see simd::active_isa).
+*/
+namespace reduction
+{
+	// Values summed directly by the kernels, below the pairwise halving
+	constexpr int PAIRWISE_BLOCK = 256;
+
+	/**
+	 * @struct indexed_max
+	 * @brief The maximal value of a buffer, and where it is.
+	 * @var index - The index of the first occurrence of the maximum.
+	 * @var value - The maximal value.
+	 */
+	typedef struct indexed_max
+	{
+		int index;
+		float value;
+	} indexed_max;
+
+	/**
+	* Calculates the sum of a buffer.
+	* @param data - The values.
+	* @param count - The number of values.
+	* @return The sum, 0 for an empty buffer.
+	*/
+	float sum(const float* data, int count);
+
+	/**
+	* Same as above, with an explicitly selected kernel.
+	* The instruction set must be supported by the CPU.
+	* @param set - The instruction set of the kernel to use.
+	*/
+	float sum(simd::isa set, const float* data, int count);
+
+	/**
+	* Calculates the sum of the squares of a buffer, summed as sum.
+	* @param data - The values.
+	* @param count - The number of values.
+	* @return The sum of squares, 0 for an empty buffer.
+	*/
+	float sum_of_squares(const float* data, int count);
+
+	/**
+	* Same as above, with an explicitly selected kernel.
+	* The instruction set must be supported by the CPU.
+	* @param set - The instruction set of the kernel to use.
+	*/
+	float sum_of_squares(simd::isa set, const float* data, int count);
+
+	/**
+	* Finds the maximal value of a buffer and its index, in a single
+	* pass. NaN values are skipped (a buffer of NaN only gives index 0).
+	* @param data - The values.
+	* @param count - The number of values, positive.
+	* @return The first maximal value and its index.
+	*/
+	indexed_max argmax(const float* data, int count);
+
+	/**
+	* Same as above, with an explicitly selected kernel.
+	* The instruction set must be supported by the CPU.
+	* @param set - The instruction set of the kernel to use.
+	*/
+	indexed_max argmax(simd::isa set, const float* data, int count);
+}
+
+#endif //REDUCTION_H
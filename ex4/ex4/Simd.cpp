@@ -0,0 +1,97 @@
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+
+#include "Simd.h"
+
+/**
+* Detects the most capable instruction set supported by the CPU.
+* AVX2 kernels also rely on FMA and F16C. AVX-512 kernels are compiled
+* with every AVX2 feature as well, so they need all of those and
+* AVX-512F; a CPU missing any of them falls back to the next level.
+*/
+static simd::isa detect_isa()
+{
+#if SIMD_X86
+	__builtin_cpu_init();
+	const bool avx2 = __builtin_cpu_supports("avx2") &&
+					  __builtin_cpu_supports("fma") &&
+					  __builtin_cpu_supports("f16c");
+	if (avx2 && __builtin_cpu_supports("avx512f"))
+	{
+		return simd::isa::AVX512;
+	}
+	if (avx2)
+	{
+		return simd::isa::AVX2;
+	}
+#endif
+	return simd::isa::SCALAR;
+}
+
+/**
+* Reads the instruction set limit from the environment.
+* @return The requested limit, AVX512 (no limit) when unset.
+*/
+static simd::isa requested_isa()
+{
+	const char* requested = std::getenv(SIMD_ISA_ENV);
+	if (nullptr == requested)
+	{
+		return simd::isa::AVX512;
+	}
+
+	for (auto set : {simd::isa::SCALAR, simd::isa::AVX2})
+	{
+		if (0 == std::strcmp(requested, simd::isa_name(set)))
+		{
+			return set;
+		}
+	}
+
+	return simd::isa::AVX512;
+}
+
+// See documentation at header file
+simd::isa simd::active_isa()
+{
+	static const isa active = []()
+	{
+		const isa detected = detect_isa();
+		const isa requested = requested_isa();
+		return (requested < detected) ? requested : detected;
+	}();
+
+	return active;
+}
+
+// See documentation at header file
+bool simd::vnni_supported()
+{
+	static const bool supported = []()
+	{
+#if SIMD_X86
+		return (isa::AVX512 == active_isa()) &&
+			   __builtin_cpu_supports("avx512bw") &&
+			   __builtin_cpu_supports("avx512vnni");
+#else
+		return false;
+#endif
+	}();
+
+	return supported;
+}
+
+// See documentation at header file
+const char* simd::isa_name(isa set)
+{
+	switch (set)
+	{
+	case isa::AVX2:
+		return "avx2";
+	case isa::AVX512:
+		return "avx512";
+	default:
+		return "scalar";
+	}
+}
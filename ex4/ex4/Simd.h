@@ -0,0 +1,68 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+// SIMD kernels are compiled per instruction set through function
+// target attributes, and selected at runtime by the detected CPU.
+// Compilers without target attributes use the portable kernels only.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86 1
+#define SIMD_TARGET(features) __attribute__((target(features)))
+#else
+#define SIMD_X86 0
+#define SIMD_TARGET(features)
+#endif
+
+// Brackets the AVX-512 kernels. GCC 12 AVX-512 intrinsics seed their
+// results with self-initialized "undefined" registers, which trip the
+// uninitialized warnings once inlined into optimized kernels.
+#if SIMD_X86 && !defined(__clang__)
+#define SIMD_AVX512_BEGIN \
+	_Pragma("GCC diagnostic push") \
+	_Pragma("GCC diagnostic ignored \"-Wuninitialized\"") \
+	_Pragma("GCC diagnostic ignored \"-Wmaybe-uninitialized\"")
+#define SIMD_AVX512_END _Pragma("GCC diagnostic pop")
+#else
+#define SIMD_AVX512_BEGIN
+#define SIMD_AVX512_END
+#endif
+
+// Environment variable limiting the instruction set used by kernels,
+// one of "scalar", "avx2" or "avx512"
+#define SIMD_ISA_ENV ("MLP_SIMD")
+
+namespace simd
+{
+	/**
+	* Instruction sets kernels are specialized for,
+	* ordered from the least to the most capable.
+	*/
+	enum class isa
+	{
+		SCALAR = 0,
+		AVX2,
+		AVX512
+	};
+
+	/**
+	* Gets the most capable instruction set supported by the CPU,
+	* limited by the SIMD_ISA_ENV environment variable if set.
+	* Detection is done once, on the first call.
+	* @return The instruction set kernels should use.
+	*/
+	isa active_isa();
+
+	/**
+	* Gets whether the int8 kernels may use AVX-512 VNNI dot products
+	* (which also need AVX-512BW). Only when the active instruction
+	* set is AVX512.
+	* @return True when VNNI kernels should be used.
+	*/
+	bool vnni_supported();
+
+	/**
+	* Gets the printable name of an instruction set.
+	*/
+	const char* isa_name(isa set);
+}
+
+#endif //SIMD_H
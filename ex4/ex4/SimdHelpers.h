@@ -0,0 +1,44 @@
+#ifndef SIMD_HELPERS_H
+#define SIMD_HELPERS_H
+
+// Lane helpers shared by the kernel translation units, internal to them
+
+#include "Simd.h"
+
+#if SIMD_X86
+#include <immintrin.h>
+
+/**
+* Gets the AVX2 mask of the first remaining lanes of 8.
+*/
+SIMD_TARGET("avx2,fma")
+static inline __m256i tail_mask_avx2(int remaining)
+{
+	return _mm256_cmpgt_epi32(_mm256_set1_epi32(remaining),
+							  _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+}
+
+/**
+* Gets the AVX-512 mask of the first remaining lanes of 16.
+*/
+static inline __mmask16 tail_mask_avx512(int remaining)
+{
+	return static_cast<__mmask16>(
+		(16 <= remaining) ? 0xFFFF : ((1U << remaining) - 1));
+}
+
+/**
+* Sums the 8 lanes of an AVX register.
+*/
+SIMD_TARGET("avx2,fma")
+static inline float horizontal_sum_avx2(__m256 value)
+{
+	__m128 sum = _mm_add_ps(_mm256_castps256_ps128(value),
+							_mm256_extractf128_ps(value, 1));
+	sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+	sum = _mm_add_ss(sum, _mm_movehdup_ps(sum));
+	return _mm_cvtss_f32(sum);
+}
+#endif
+
+#endif //SIMD_HELPERS_H
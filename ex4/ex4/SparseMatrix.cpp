@@ -0,0 +1,84 @@
+#include <cmath>
+
+#include "SparseMatrix.h"
+
+// See documentation at header file
+SparseMatrix::SparseMatrix(const Matrix& matrix, float threshold) :
+	_rows(matrix.get_rows()),
+	_columns(matrix.get_cols()),
+	_row_starts(static_cast<size_t>(_rows) + 1)
+{
+	for (int row = 0; row < _rows; row++)
+	{
+		_row_starts[row] = static_cast<int32_t>(_values.size());
+		const float* values = matrix.data() + (row * matrix.get_stride());
+		for (int col = 0; col < _columns; col++)
+		{
+			if (std::fabs(values[col]) > threshold)
+			{
+				_col_indices.push_back(col);
+				_values.push_back(values[col]);
+			}
+		}
+	}
+	_row_starts[_rows] = static_cast<int32_t>(_values.size());
+}
+
+// See documentation at header file
+int SparseMatrix::get_rows() const
+{
+	return _rows;
+}
+
+// See documentation at header file
+int SparseMatrix::get_cols() const
+{
+	return _columns;
+}
+
+// See documentation at header file
+int SparseMatrix::get_nonzeros() const
+{
+	return static_cast<int>(_values.size());
+}
+
+// See documentation at header file
+float SparseMatrix::get_density() const
+{
+	return static_cast<float>(_values.size()) /
+		   (static_cast<float>(_rows) * static_cast<float>(_columns));
+}
+
+// See documentation at header file
+const int32_t* SparseMatrix::row_starts() const
+{
+	return _row_starts.data();
+}
+
+// See documentation at header file
+const int32_t* SparseMatrix::col_indices() const
+{
+	return _col_indices.data();
+}
+
+// See documentation at header file
+const float* SparseMatrix::values() const
+{
+	return _values.data();
+}
+
+// See documentation at header file
+Matrix SparseMatrix::to_matrix() const
+{
+	Matrix matrix(_rows, _columns);
+	for (int row = 0; row < _rows; row++)
+	{
+		for (int index = _row_starts[row]; index < _row_starts[row + 1];
+			 index++)
+		{
+			matrix(row, _col_indices[index]) = _values[index];
+		}
+	}
+
+	return matrix;
+}
@@ -0,0 +1,82 @@
+#ifndef SPARSEMATRIX_H
+#define SPARSEMATRIX_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Matrix.h"
+
+/**
+* @class SparseMatrix
+ * @brief Read-only copy of the non-zero cells of a matrix, in
+ *		  compressed sparse row (CSR) form: the cells of every row are
+ *		  stored one after the other, with their column indices, and
+ *		  row r spans [row_starts()[r], row_starts()[r + 1]).
+ *		  Products over it cost in proportion to the stored cells, so
+ *		  a pruned matrix is multiplied in a fraction of the time.
+ */
+class SparseMatrix
+{
+public:
+	/**
+	* Compresses the given matrix, keeping the cells whose magnitude
+	* is above the threshold (every non-zero cell by default).
+	* @param matrix - The matrix to compress.
+	* @param threshold - Cells of magnitude up to it are dropped.
+	*/
+	explicit SparseMatrix(const Matrix& matrix, float threshold = 0.0F);
+
+	/**
+	* Getting the number of rows in the matrix.
+	*/
+	int get_rows() const;
+
+	/**
+	* Getting the number of columns in the matrix.
+	*/
+	int get_cols() const;
+
+	/**
+	* Getting the number of stored cells.
+	*/
+	int get_nonzeros() const;
+
+	/**
+	* Getting the fraction of the cells which are stored, in [0, 1].
+	*/
+	float get_density() const;
+
+	/**
+	* Getting the index of the first stored cell of every row, and the
+	* stored cell count after the last row (rows + 1 values).
+	*/
+	const int32_t* row_starts() const;
+
+	/**
+	* Getting the column index of every stored cell.
+	*/
+	const int32_t* col_indices() const;
+
+	/**
+	* Getting the value of every stored cell.
+	*/
+	const float* values() const;
+
+	/**
+	* Expanding the matrix back to a dense matrix.
+	* @return The matrix, 0 in every dropped cell.
+	*/
+	Matrix to_matrix() const;
+
+private:
+	int _rows;
+	int _columns;
+	// Index of the first stored cell of every row, then the cell count
+	std::vector<int32_t> _row_starts;
+	// Column index of every stored cell
+	std::vector<int32_t> _col_indices;
+	// Value of every stored cell
+	std::vector<float> _values;
+};
+
+#endif //SPARSEMATRIX_H
@@ -0,0 +1,280 @@
+// StaticMatrix.h
+#ifndef STATICMATRIX_H
+#define STATICMATRIX_H
+
+#include <algorithm>
+
+#include "Matrix.h"
+
+/**
+ * @class StaticMatrix
+ * @brief Matrix whose dimensions are template arguments, stored inline
+ *		  (rows stored one after the other). Every shape is known at
+ *		  compile time, so products and sums of mismatched shapes fail
+ *		  to compile, the loops have constant trip counts the compiler
+ *		  can unroll and vectorize, and no access is checked at runtime.
+ *		  Large matrices belong on the heap (see StaticMlpNetwork).
+ * @tparam Rows - The number of rows.
+ * @tparam Cols - The number of columns.
+ */
+template <int Rows, int Cols>
+class StaticMatrix
+{
+	static_assert((0 < Rows) && (0 < Cols),
+				  "Matrix dimensions must be positive");
+
+public:
+	// The number of rows
+	static constexpr int ROWS = Rows;
+	// The number of columns
+	static constexpr int COLS = Cols;
+	// The number of cells
+	static constexpr int SIZE = Rows * Cols;
+
+	/**
+	* Constructs a matrix with all cells initialized to 0.
+	*/
+	StaticMatrix() :
+		_data{}
+	{}
+
+	/**
+	* Constructs a matrix by copying cells from raw memory.
+	* @param data - SIZE cells, rows stored one after the other.
+	*/
+	explicit StaticMatrix(const float* data)
+	{
+		std::copy(data, data + SIZE, _data);
+	}
+
+	/**
+	* Constructs a matrix by copying a dynamic matrix, the only place
+	* where the shape is checked at runtime.
+	* @param matrix - The matrix to copy, of Rows x Cols.
+	* @throws std::length_error in case of different dimensions.
+	*/
+	explicit StaticMatrix(const Matrix& matrix)
+	{
+		if ((Rows != matrix.get_rows()) || (Cols != matrix.get_cols()))
+		{
+			throw std::length_error(INCOMPATIBLE_DIMENSIONS_EX);
+		}
+
+		for (int row = 0; row < Rows; row++)
+		{
+			const float* values = matrix.data() + (row * matrix.get_stride());
+			std::copy(values, values + Cols, _data + (row * Cols));
+		}
+	}
+
+	/**
+	* Getting the number of rows in the matrix.
+	*/
+	static constexpr int get_rows()
+	{
+		return Rows;
+	}
+
+	/**
+	* Getting the number of columns in the matrix.
+	*/
+	static constexpr int get_cols()
+	{
+		return Cols;
+	}
+
+	/**
+	* Getting the raw storage of the matrix.
+	*/
+	float* data()
+	{
+		return _data;
+	}
+
+	/**
+	* Getting the raw storage of the matrix.
+	*/
+	const float* data() const
+	{
+		return _data;
+	}
+
+	/**
+	* Accessing a cell by (row, col) coordinates, not bounds checked.
+	*/
+	float& operator()(int row, int col)
+	{
+		return _data[(row * Cols) + col];
+	}
+
+	/**
+	* Accessing a cell by (row, col) coordinates, not bounds checked.
+	*/
+	float operator()(int row, int col) const
+	{
+		return _data[(row * Cols) + col];
+	}
+
+	/**
+	* Accessing a cell by its row-major index, not bounds checked.
+	*/
+	float& operator[](int index)
+	{
+		return _data[index];
+	}
+
+	/**
+	* Accessing a cell by its row-major index, not bounds checked.
+	*/
+	float operator[](int index) const
+	{
+		return _data[index];
+	}
+
+	/**
+	* Accessing a cell by coordinates checked at compile time.
+	* @tparam Row - The row of the cell.
+	* @tparam Col - The column of the cell.
+	*/
+	template <int Row, int Col>
+	float at() const
+	{
+		static_assert((0 <= Row) && (Row < Rows) &&
+					  (0 <= Col) && (Col < Cols),
+					  "Matrix index out of range");
+		return _data[(Row * Cols) + Col];
+	}
+
+	/**
+	* Adding a matrix of the same shape, cell by cell.
+	* @param rhs - The matrix to add.
+	* @return This matrix.
+	*/
+	StaticMatrix& operator+=(const StaticMatrix& rhs)
+	{
+		for (int index = 0; index < SIZE; index++)
+		{
+			_data[index] += rhs._data[index];
+		}
+
+		return *this;
+	}
+
+	/**
+	* Multiplying every cell by a scalar.
+	* @param scalar - The scalar to multiply by.
+	* @return This matrix.
+	*/
+	StaticMatrix& operator*=(float scalar)
+	{
+		for (int index = 0; index < SIZE; index++)
+		{
+			_data[index] *= scalar;
+		}
+
+		return *this;
+	}
+
+	/**
+	* Copying the matrix into a dynamic matrix.
+	* @return The matrix, of Rows x Cols.
+	*/
+	Matrix to_matrix() const
+	{
+		Matrix matrix(Rows, Cols);
+		std::copy(_data, _data + SIZE, matrix.data());
+		return matrix;
+	}
+
+private:
+	float _data[Rows * Cols];
+};
+
+// Independent partial sums kept by the matrix-vector product, so the
+// reduction vectorizes without reassociating floating-point additions
+constexpr int STATIC_LANES = 16;
+
+/**
+* Multiplying two matrices. The shared dimension must match, a product
+* of mismatched shapes fails to compile.
+* Matrix-vector products keep STATIC_LANES partial sums per row, other
+* products accumulate rows of rhs, so the inner loop is always over
+* consecutive cells.
+* @param lhs - The left-hand side of the multiplication (Rows x Depth).
+* @param rhs - The right-hand side of the multiplication (Depth x Cols).
+* @return The product matrix (Rows x Cols).
+*/
+template <int Rows, int LhsCols, int RhsRows, int Cols>
+StaticMatrix<Rows, Cols> operator*(const StaticMatrix<Rows, LhsCols>& lhs,
+								   const StaticMatrix<RhsRows, Cols>& rhs)
+{
+	static_assert(LhsCols == RhsRows,
+				  "The lhs column count must be the rhs row count");
+
+	StaticMatrix<Rows, Cols> result;
+	if (1 == Cols)
+	{
+		constexpr int full = (LhsCols / STATIC_LANES) * STATIC_LANES;
+		for (int row = 0; row < Rows; row++)
+		{
+			const float* lhs_row = lhs.data() + (row * LhsCols);
+			float partial[STATIC_LANES] = {};
+			for (int depth = 0; depth < full; depth += STATIC_LANES)
+			{
+				for (int lane = 0; lane < STATIC_LANES; lane++)
+				{
+					partial[lane] += lhs_row[depth + lane] *
+									 rhs[depth + lane];
+				}
+			}
+
+			float sum = 0;
+			for (int lane = 0; lane < STATIC_LANES; lane++)
+			{
+				sum += partial[lane];
+			}
+			for (int depth = full; depth < LhsCols; depth++)
+			{
+				sum += lhs_row[depth] * rhs[depth];
+			}
+			result[row] = sum;
+		}
+
+		return result;
+	}
+
+	for (int row = 0; row < Rows; row++)
+	{
+		for (int depth = 0; depth < LhsCols; depth++)
+		{
+			const float value = lhs(row, depth);
+			for (int col = 0; col < Cols; col++)
+			{
+				result(row, col) += value * rhs(depth, col);
+			}
+		}
+	}
+
+	return result;
+}
+
+/**
+* Adding two matrices of the same shape, a sum of mismatched shapes
+* fails to compile.
+* @param lhs - The left-hand side of the addition.
+* @param rhs - The right-hand side of the addition.
+* @return The sum matrix.
+*/
+template <int Rows, int Cols, int RhsRows, int RhsCols>
+StaticMatrix<Rows, Cols> operator+(const StaticMatrix<Rows, Cols>& lhs,
+								   const StaticMatrix<RhsRows, RhsCols>& rhs)
+{
+	static_assert((Rows == RhsRows) && (Cols == RhsCols),
+				  "Added matrices must have the same dimensions");
+
+	StaticMatrix<Rows, Cols> result(lhs);
+	result += rhs;
+	return result;
+}
+
+#endif //STATICMATRIX_H
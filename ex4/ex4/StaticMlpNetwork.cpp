@@ -0,0 +1,36 @@
+#include "StaticMlpNetwork.h"
+
+// See documentation at header file
+StaticMlpNetwork::StaticMlpNetwork(
+	Matrix weights[MLP_SIZE], Matrix biases[MLP_SIZE]) :
+	_layer1(new Layer1(weights[0], biases[0])),
+	_layer2(new Layer2(weights[1], biases[1])),
+	_layer3(new Layer3(weights[2], biases[2])),
+	_layer4(new Layer4(weights[3], biases[3]))
+{}
+
+// See documentation at header file
+digit StaticMlpNetwork::operator()(const Image& image) const
+{
+	return (*this)(image.data());
+}
+
+// See documentation at header file
+digit StaticMlpNetwork::operator()(const float* image) const
+{
+	StaticMatrix<weights_dims[0].rows, 1> hidden1;
+	StaticMatrix<weights_dims[1].rows, 1> hidden2;
+	StaticMatrix<weights_dims[2].rows, 1> hidden3;
+	StaticMatrix<weights_dims[3].rows, 1> output;
+
+	// The image is read in place rather than copied into an Image
+	_layer1->forward(image, hidden1, true);
+	_layer2->forward(hidden1, hidden2, true);
+	_layer3->forward(hidden2, hidden3, true);
+	_layer4->forward(hidden3, output, false);
+	activation::softmax_columns(output.data(), output.get_rows(), 1);
+
+	const reduction::indexed_max maximum =
+		reduction::argmax(output.data(), output.get_rows());
+	return {static_cast<unsigned int>(maximum.index), maximum.value};
+}
@@ -0,0 +1,139 @@
+//StaticMlpNetwork.h
+
+#ifndef STATICMLPNETWORK_H
+#define STATICMLPNETWORK_H
+
+#include <memory>
+
+#include "Gemv.h"
+#include "MlpNetwork.h"
+#include "StaticMatrix.h"
+
+// Network input size, in pixels
+constexpr int IMAGE_SIZE = img_dims.rows * img_dims.cols;
+
+static_assert(IMAGE_SIZE == weights_dims[0].cols,
+			  "The first layer must take the whole image");
+static_assert((weights_dims[0].rows == weights_dims[1].cols) &&
+			  (weights_dims[1].rows == weights_dims[2].cols) &&
+			  (weights_dims[2].rows == weights_dims[3].cols),
+			  "Every layer must take the previous layer output");
+static_assert((weights_dims[0].rows == bias_dims[0].rows) &&
+			  (weights_dims[1].rows == bias_dims[1].rows) &&
+			  (weights_dims[2].rows == bias_dims[2].rows) &&
+			  (weights_dims[3].rows == bias_dims[3].rows) &&
+			  (1 == bias_dims[0].cols) && (1 == bias_dims[1].cols) &&
+			  (1 == bias_dims[2].cols) && (1 == bias_dims[3].cols),
+			  "Every bias must be a column of the layer output size");
+
+/**
+ * @class StaticDense
+ * @brief Layer of a statically shaped network, with the weights and
+ *		  bias stored inline, so a layer belongs on the heap.
+ *		  Applying a layer to a vector of a different size fails to
+ *		  compile, and the product runs with constant dimensions.
+ * @tparam Inputs - The input vector size (weights column count).
+ * @tparam Outputs - The output vector size (weights row count).
+ */
+template <int Inputs, int Outputs>
+class StaticDense
+{
+public:
+	/**
+	* Constructs a layer by copying dynamic weights and bias.
+	* @param weights - The weights matrix (Outputs x Inputs).
+	* @param bias - The bias matrix (Outputs x 1).
+	* @throws std::length_error in case of different dimensions.
+	*/
+	StaticDense(const Matrix& weights, const Matrix& bias) :
+		_weights(weights),
+		_bias(bias)
+	{}
+
+	/**
+	* Calculates output = weights * input + bias, with ReLU fused into
+	* the store when requested.
+	* @param input - The input vector.
+	* @param output - The output vector, may not overlap the input.
+	* @param relu - Whether negative outputs are clamped to 0.
+	*/
+	void forward(const StaticMatrix<Inputs, 1>& input,
+				 StaticMatrix<Outputs, 1>& output, bool relu) const
+	{
+		forward(input.data(), output, relu);
+	}
+
+	/**
+	* Same as above, reading the input from raw memory.
+	* @param input - The input vector, contiguous (Inputs floats).
+	*/
+	void forward(const float* input,
+				 StaticMatrix<Outputs, 1>& output, bool relu) const
+	{
+		gemv::multiply(Outputs, Inputs, _weights.data(), Inputs,
+					   input, output.data(), {_bias.data(), relu});
+	}
+
+private:
+	const StaticMatrix<Outputs, Inputs> _weights;
+	const StaticMatrix<Outputs, 1> _bias;
+};
+
+/**
+ * @class StaticMlpNetwork
+ * @brief The network of MlpNetwork, with every shape taken from the
+ *		  img_dims and weights_dims constants at compile time.
+ *		  The weights are checked once, when constructing, so a single
+ *		  image is classified with no runtime checks, no allocations
+ *		  and no workspace (the layer outputs live on the stack).
+ *		  Like MlpNetwork, const members are safe to call concurrently.
+ */
+class StaticMlpNetwork
+{
+public:
+	// A vectorized network input
+	using Image = StaticMatrix<IMAGE_SIZE, 1>;
+
+	/**
+	* Constructs the network by copying the weights of the 4 layers.
+	* @param weights - The weights matrices for each layer.
+	* @param biases - The biases matrices for each layer.
+	* @throws std::length_error in case any matrix does not have the
+	*		  dimensions in weights_dims and bias_dims.
+	*/
+	StaticMlpNetwork(Matrix weights[MLP_SIZE], Matrix biases[MLP_SIZE]);
+
+	// Explicitly defining behavior to prevent implicit behavior
+	StaticMlpNetwork() = delete;
+	StaticMlpNetwork(const StaticMlpNetwork&) = delete;
+	StaticMlpNetwork& operator=(StaticMlpNetwork&) = delete;
+	~StaticMlpNetwork() = default;
+
+	/**
+	* Activates the neural network on a given image.
+	* @param image - The vectorized image.
+	* @return The neural network results.
+	*/
+	digit operator()(const Image& image) const;
+
+	/**
+	* Activates the neural network on an image in raw memory.
+	* @param image - The image pixels, contiguous (IMAGE_SIZE floats).
+	* @return The neural network results.
+	*/
+	digit operator()(const float* image) const;
+
+private:
+	using Layer1 = StaticDense<IMAGE_SIZE, weights_dims[0].rows>;
+	using Layer2 = StaticDense<weights_dims[1].cols, weights_dims[1].rows>;
+	using Layer3 = StaticDense<weights_dims[2].cols, weights_dims[2].rows>;
+	using Layer4 = StaticDense<weights_dims[3].cols, weights_dims[3].rows>;
+
+	// All layers of the network
+	const std::unique_ptr<const Layer1> _layer1;
+	const std::unique_ptr<const Layer2> _layer2;
+	const std::unique_ptr<const Layer3> _layer3;
+	const std::unique_ptr<const Layer4> _layer4;
+};
+
+#endif // STATICMLPNETWORK_H
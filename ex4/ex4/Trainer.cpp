@@ -0,0 +1,405 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+
+#include "Gemm.h"
+#include "Trainer.h"
+
+// Exception descriptions
+#define INVALID_TRAINING_LAYERS_EX ("Training needs ReLU layers, then a " \
+									"Softmax layer, of matching widths")
+#define INVALID_TRAINING_OPTIONS_EX ("Invalid training options")
+#define INVALID_TRAINING_DATA_EX ("Training images and labels do not match " \
+								  "the network")
+
+// Adam decay rates of the first and second gradient moments
+constexpr float ADAM_BETA1 = 0.9F;
+constexpr float ADAM_BETA2 = 0.999F;
+// Adam guard against dividing by a vanishing second moment
+constexpr float ADAM_EPSILON = 1e-8F;
+
+/**
+* Checks training options.
+* @throws std::invalid_argument in case of a non-positive batch size,
+*		  thread count or learning rate, or a momentum out of [0, 1).
+* @return The options.
+*/
+static const training_options& checked_options(
+	const training_options& options)
+{
+	if ((0 >= options.batch_size) || (0 >= options.threads) ||
+		!(0.0F < options.learning_rate) || !(0.0F <= options.momentum) ||
+		!(1.0F > options.momentum))
+	{
+		throw std::invalid_argument(INVALID_TRAINING_OPTIONS_EX);
+	}
+
+	return options;
+}
+
+/**
+* SGD step of packed parameters: v = momentum * v + g, p -= rate * v.
+* @param parameters - The parameters to update.
+* @param gradients - The gradient sums of the parameters.
+* @param velocity - The velocity of every parameter.
+* @param size - The number of parameters.
+* @param scale - Turns the gradient sums into means.
+* @param options - The learning rate and momentum.
+*/
+static void sgd_step(float* parameters, const float* gradients,
+					 float* velocity, int size, float scale,
+					 const training_options& options)
+{
+	for (int index = 0; index < size; index++)
+	{
+		velocity[index] = (options.momentum * velocity[index]) +
+						  (scale * gradients[index]);
+		parameters[index] -= options.learning_rate * velocity[index];
+	}
+}
+
+/**
+* Adam step of packed parameters.
+* @param parameters - The parameters to update.
+* @param gradients - The gradient sums of the parameters.
+* @param first - The first moment of every parameter.
+* @param second - The second moment of every parameter.
+* @param size - The number of parameters.
+* @param scale - Turns the gradient sums into means.
+* @param step - The learning rate, over the first moment's bias.
+* @param second_bias - The bias of the second moment.
+*/
+static void adam_step(float* parameters, const float* gradients,
+					  float* first, float* second, int size, float scale,
+					  float step, float second_bias)
+{
+	for (int index = 0; index < size; index++)
+	{
+		const float gradient = scale * gradients[index];
+		first[index] = (ADAM_BETA1 * first[index]) +
+					   ((1.0F - ADAM_BETA1) * gradient);
+		second[index] = (ADAM_BETA2 * second[index]) +
+						((1.0F - ADAM_BETA2) * gradient * gradient);
+		parameters[index] -= step * first[index] /
+							 (std::sqrt(second[index] / second_bias) +
+							  ADAM_EPSILON);
+	}
+}
+
+// See documentation at header file
+Trainer::Trainer(const std::vector<model::layer>& layers,
+				 const training_options& options) :
+	_options(checked_options(options)),
+	_steps(0),
+	_epoch_seed(options.seed),
+	_pool((1 < options.threads) ? new WorkStealingPool(options.threads)
+								: nullptr)
+{
+	if (layers.empty())
+	{
+		throw std::invalid_argument(INVALID_TRAINING_LAYERS_EX);
+	}
+
+	for (size_t index = 0; index < layers.size(); index++)
+	{
+		const model::layer& layer = layers[index];
+		const bool last = (layers.size() - 1 == index);
+		if ((layer.activation != (last ? activation::softmax
+									   : activation::relu)) ||
+			((0 < index) && (layer.weights.get_cols() != _widths.back())) ||
+			(layer.bias.get_rows() != layer.weights.get_rows()) ||
+			(1 != layer.bias.get_cols()))
+		{
+			throw std::invalid_argument(INVALID_TRAINING_LAYERS_EX);
+		}
+
+		// Packed copies, updated in place and detached from any mapping
+		_layers.push_back({Matrix(layer.weights, matrix_layout::PACKED),
+						   Matrix(layer.bias, matrix_layout::PACKED),
+						   layer.activation});
+		_widths.push_back(layer.weights.get_rows());
+
+		const int rows = layer.weights.get_rows();
+		const int cols = layer.weights.get_cols();
+		_gradients.push_back({Matrix(rows, cols), Matrix(rows, 1)});
+		_first_moments.push_back({Matrix(rows, cols), Matrix(rows, 1)});
+		_second_moments.push_back({Matrix(rows, cols), Matrix(rows, 1)});
+	}
+
+	const int input_size = _layers.front().weights.get_cols();
+	const int shards = (_options.batch_size + TRAINING_SHARD_SIZE - 1) /
+					   TRAINING_SHARD_SIZE;
+	_shards.resize(shards);
+	for (shard& state : _shards)
+	{
+		state.input.resize(static_cast<size_t>(input_size) *
+						   TRAINING_SHARD_SIZE);
+		for (size_t index = 0; index < _layers.size(); index++)
+		{
+			const size_t size = static_cast<size_t>(_widths[index]) *
+								TRAINING_SHARD_SIZE;
+			state.outputs.emplace_back(size);
+			state.deltas.emplace_back(size);
+			state.gradients.push_back(
+				{Matrix(_widths[index], _layers[index].weights.get_cols()),
+				 Matrix(_widths[index], 1)});
+		}
+		state.loss = 0;
+		state.correct = 0;
+	}
+}
+
+// See documentation at header file
+std::vector<model::layer> Trainer::initial_layers(
+	const std::vector<int>& widths, unsigned int seed)
+{
+	if ((2 > widths.size()) ||
+		std::any_of(widths.begin(), widths.end(),
+					[](int width) { return 0 >= width; }))
+	{
+		throw std::invalid_argument(INVALID_TRAINING_LAYERS_EX);
+	}
+
+	std::mt19937 generator(seed);
+	std::vector<model::layer> layers;
+	for (size_t index = 1; index < widths.size(); index++)
+	{
+		std::normal_distribution<float> normal(
+			0.0F, std::sqrt(2.0F / static_cast<float>(widths[index - 1])));
+		Matrix weights(widths[index], widths[index - 1]);
+		for (int row = 0; row < weights.get_rows(); row++)
+		{
+			for (int col = 0; col < weights.get_cols(); col++)
+			{
+				weights(row, col) = normal(generator);
+			}
+		}
+		layers.push_back({std::move(weights), Matrix(widths[index], 1),
+						  (widths.size() - 1 == index) ? activation::softmax
+													   : activation::relu});
+	}
+
+	return layers;
+}
+
+// See documentation at header file
+epoch_result Trainer::train_epoch(const Matrix& images,
+								  const std::vector<unsigned int>& labels)
+{
+	const int samples = images.get_rows();
+	const unsigned int classes = static_cast<unsigned int>(_widths.back());
+	if ((images.get_cols() != _layers.front().weights.get_cols()) ||
+		(static_cast<size_t>(samples) != labels.size()) ||
+		std::any_of(labels.begin(), labels.end(),
+					[classes](unsigned int label) { return label >= classes; }))
+	{
+		throw std::invalid_argument(INVALID_TRAINING_DATA_EX);
+	}
+
+	std::vector<int> order(samples);
+	std::iota(order.begin(), order.end(), 0);
+	std::mt19937 generator(_epoch_seed++);
+	std::shuffle(order.begin(), order.end(), generator);
+
+	double loss = 0;
+	long correct = 0;
+	for (int first = 0; first < samples; first += _options.batch_size)
+	{
+		const int batch = std::min(_options.batch_size, samples - first);
+		const int shards = (batch + TRAINING_SHARD_SIZE - 1) /
+						   TRAINING_SHARD_SIZE;
+		const auto compute = [&](int index)
+		{
+			const int start = index * TRAINING_SHARD_SIZE;
+			compute_shard(images, labels, order.data() + first + start,
+						  std::min(TRAINING_SHARD_SIZE, batch - start),
+						  _shards[index]);
+		};
+		if (nullptr == _pool)
+		{
+			for (int index = 0; index < shards; index++)
+			{
+				compute(index);
+			}
+		}
+		else
+		{
+			_pool->run(shards, compute);
+		}
+
+		// Summed in shard order, so the sums do not depend on the threads
+		for (size_t layer = 0; layer < _layers.size(); layer++)
+		{
+			_gradients[layer].weights = _shards[0].gradients[layer].weights;
+			_gradients[layer].bias = _shards[0].gradients[layer].bias;
+			for (int index = 1; index < shards; index++)
+			{
+				_gradients[layer].weights += _shards[index].gradients[layer].weights;
+				_gradients[layer].bias += _shards[index].gradients[layer].bias;
+			}
+		}
+		for (int index = 0; index < shards; index++)
+		{
+			loss += _shards[index].loss;
+			correct += _shards[index].correct;
+		}
+
+		update(batch);
+	}
+
+	return {static_cast<float>(loss / samples),
+			static_cast<float>(correct) / static_cast<float>(samples),
+			samples};
+}
+
+// See documentation at header file
+const std::vector<model::layer>& Trainer::get_layers() const
+{
+	return _layers;
+}
+
+// See documentation at header file
+void Trainer::compute_shard(const Matrix& images,
+							const std::vector<unsigned int>& labels,
+							const int* order, int count, shard& state) const
+{
+	// The shard images are gathered as columns, like a classified batch
+	const int input_size = images.get_cols();
+	for (int sample = 0; sample < count; sample++)
+	{
+		const float* image = images.data() +
+							 (static_cast<size_t>(order[sample]) *
+							  images.get_stride());
+		for (int feature = 0; feature < input_size; feature++)
+		{
+			state.input[(feature * count) + sample] = image[feature];
+		}
+	}
+
+	// Forward pass, keeping the output of every layer
+	const size_t layers = _layers.size();
+	const float* input = state.input.data();
+	int depth = input_size;
+	for (size_t index = 0; index < layers; index++)
+	{
+		const Matrix& weights = _layers[index].weights;
+		gemm::multiply(_widths[index], count, depth, weights.data(),
+					   weights.get_stride(), input, count,
+					   state.outputs[index].data(), count,
+					   {_layers[index].bias.data(), layers - 1 != index});
+		input = state.outputs[index].data();
+		depth = _widths[index];
+	}
+
+	// Cross-entropy of the Softmax, whose gradient is p - onehot(label)
+	const int classes = _widths.back();
+	float* probabilities = state.outputs.back().data();
+	float* delta = state.deltas.back().data();
+	activation::softmax_columns(probabilities, classes, count);
+	state.loss = 0;
+	state.correct = 0;
+	for (int sample = 0; sample < count; sample++)
+	{
+		const int label = static_cast<int>(labels[order[sample]]);
+		int best = 0;
+		for (int row = 0; row < classes; row++)
+		{
+			const float probability = probabilities[(row * count) + sample];
+			if (probability > probabilities[(best * count) + sample])
+			{
+				best = row;
+			}
+			delta[(row * count) + sample] = probability -
+											((row == label) ? 1.0F : 0.0F);
+		}
+		state.correct += (best == label) ? 1 : 0;
+		state.loss -= std::log(std::max(
+			probabilities[(label * count) + sample], FLT_MIN));
+	}
+
+	// Backward pass, from the last layer
+	for (size_t index = layers; 0 < index--;)
+	{
+		const int rows = _widths[index];
+		const int cols = _layers[index].weights.get_cols();
+		const float* layer_input = (0 == index) ? state.input.data()
+												: state.outputs[index - 1].data();
+		const float* layer_delta = state.deltas[index].data();
+		layer_state& gradients = state.gradients[index];
+
+		// Weight gradients: delta * input^T, bias gradients: delta row sums
+		gemm::multiply(MatrixView(layer_delta, rows, count, count),
+					   MatrixView(layer_input, count, cols, count, true),
+					   gradients.weights.data(), gradients.weights.get_stride());
+		float* bias = gradients.bias.data();
+		for (int row = 0; row < rows; row++)
+		{
+			float sum = 0;
+			for (int sample = 0; sample < count; sample++)
+			{
+				sum += layer_delta[(row * count) + sample];
+			}
+			bias[row] = sum;
+		}
+
+		// Input delta: W^T * delta, through the previous layer's ReLU
+		if (0 < index)
+		{
+			const Matrix& weights = _layers[index].weights;
+			float* previous = state.deltas[index - 1].data();
+			gemm::multiply(MatrixView(weights.data(), cols, rows,
+									  weights.get_stride(), true),
+						   MatrixView(layer_delta, rows, count, count),
+						   previous, count);
+			for (int cell = 0; cell < cols * count; cell++)
+			{
+				if (0.0F >= layer_input[cell])
+				{
+					previous[cell] = 0.0F;
+				}
+			}
+		}
+	}
+}
+
+// See documentation at header file
+void Trainer::update(int samples)
+{
+	_steps++;
+	const float scale = 1.0F / static_cast<float>(samples);
+	const float first_bias = 1.0F - std::pow(ADAM_BETA1,
+											 static_cast<float>(_steps));
+	const float second_bias = 1.0F - std::pow(ADAM_BETA2,
+											  static_cast<float>(_steps));
+	for (size_t index = 0; index < _layers.size(); index++)
+	{
+		Matrix* parameters[] = {&_layers[index].weights,
+								&_layers[index].bias};
+		Matrix* gradients[] = {&_gradients[index].weights,
+							   &_gradients[index].bias};
+		Matrix* first[] = {&_first_moments[index].weights,
+						   &_first_moments[index].bias};
+		Matrix* second[] = {&_second_moments[index].weights,
+							&_second_moments[index].bias};
+		for (int part = 0; part < 2; part++)
+		{
+			const int size = parameters[part]->get_rows() *
+							 parameters[part]->get_cols();
+			if (optimizer_kind::SGD == _options.optimizer)
+			{
+				sgd_step(parameters[part]->data(), gradients[part]->data(),
+						 first[part]->data(), size, scale, _options);
+			}
+			else
+			{
+				adam_step(parameters[part]->data(), gradients[part]->data(),
+						  first[part]->data(), second[part]->data(), size,
+						  scale, _options.learning_rate / first_bias,
+						  second_bias);
+			}
+		}
+	}
+}
@@ -0,0 +1,202 @@
+#ifndef TRAINER_H
+#define TRAINER_H
+
+#include <memory>
+#include <vector>
+
+#include "ModelFile.h"
+#include "WorkStealingPool.h"
+
+// Samples of a gradient shard, the unit of data parallelism
+constexpr int TRAINING_SHARD_SIZE = 16;
+
+/**
+* Update rule of the weights and biases.
+*/
+enum class optimizer_kind
+{
+	// Stochastic gradient descent, with momentum
+	SGD = 0,
+	// Adam, per-parameter step sizes from the gradient moments
+	ADAM
+};
+
+/**
+ * @struct training_options
+ * @brief Hyperparameters of a Trainer.
+ * @var optimizer - The update rule.
+ * @var learning_rate - The step size.
+ * @var momentum - SGD momentum, 0 for plain SGD. Unused by Adam.
+ * @var batch_size - The samples of every minibatch (and update).
+ * @var threads - The threads computing the shard gradients, the
+ *				  calling thread included.
+ * @var seed - Seeds the sample order of every epoch.
+ */
+typedef struct training_options
+{
+	optimizer_kind optimizer;
+	float learning_rate;
+	float momentum;
+	int batch_size;
+	int threads;
+	unsigned int seed;
+} training_options;
+
+// Adam with its usual step size, over minibatches of 128
+constexpr training_options default_training_options = {
+	optimizer_kind::ADAM, 1e-3F, 0.9F, 128, 1, 1};
+
+/**
+ * @struct epoch_result
+ * @brief Statistics of a training epoch.
+ * @var loss - The mean cross-entropy of the samples, as computed
+ *			   during the epoch (before each minibatch's update).
+ * @var accuracy - The fraction of samples classified correctly, as
+ *				   computed during the epoch.
+ * @var samples - The number of samples trained on.
+ */
+typedef struct epoch_result
+{
+	float loss;
+	float accuracy;
+	long samples;
+} epoch_result;
+
+/**
+ * @class Trainer
+ * @brief Trains the layers of an MlpNetwork (ReLU layers, then a
+ *		  Softmax layer) on labelled images, by backpropagating the
+ *		  cross-entropy through every layer over minibatches.
+ *		  Every minibatch is split into shards of TRAINING_SHARD_SIZE
+ *		  samples whose gradients are computed concurrently, each into
+ *		  its own buffers, then summed in shard order. The shards do
+ *		  not depend on the thread count, so training is deterministic:
+ *		  the same options give the same layers with any threads.
+ */
+class Trainer
+{
+public:
+	/**
+	* Starts training from the given layers, such as a loaded model
+	* or initial_layers. The layers are copied.
+	* @param layers - The layers, ReLU activated but the last, Softmax
+	*				  activated, each as wide as the next one's input.
+	* @param options - The hyperparameters.
+	* @throws std::invalid_argument in case of other layers, or options
+	*		  with a non-positive batch size, thread count or learning
+	*		  rate.
+	*/
+	Trainer(const std::vector<model::layer>& layers,
+			const training_options& options = default_training_options);
+
+	// Explicitly defining behavior to prevent implicit behavior
+	Trainer() = delete;
+	Trainer(const Trainer&) = delete;
+	Trainer& operator=(const Trainer&) = delete;
+	~Trainer() = default;
+
+	/**
+	* Draws layers of the given widths for training from scratch:
+	* He-initialized weights (normal, variance 2 / inputs) and zero
+	* biases, ReLU activated but the last, Softmax activated.
+	* @param widths - The layer widths, the input size first, such as
+	*				  {784, 128, 64, 20, 10}.
+	* @param seed - Seeds the weights.
+	* @throws std::invalid_argument in case of fewer than two widths,
+	*		  or a non-positive width.
+	* @return The layers.
+	*/
+	static std::vector<model::layer> initial_layers(
+		const std::vector<int>& widths, unsigned int seed);
+
+	/**
+	* Trains one epoch: every sample once, in a shuffled order, one
+	* update per minibatch (the last one may be smaller).
+	* @param images - The images, one per row (samples x input size).
+	* @param labels - The label of every image, in [0, output size).
+	* @throws std::invalid_argument in case the images do not match
+	*		  the input size or the labels, or a label is out of range.
+	* @return The loss and accuracy of the epoch.
+	*/
+	epoch_result train_epoch(const Matrix& images,
+							 const std::vector<unsigned int>& labels);
+
+	/**
+	* Gets the trained layers, to save (see model::save) or to build
+	* an MlpNetwork with.
+	*/
+	const std::vector<model::layer>& get_layers() const;
+
+private:
+	/**
+	 * @struct layer_state
+	 * @brief Gradient sums or optimizer moments of every layer.
+	 * @var weights - One value per weight.
+	 * @var bias - One value per bias.
+	 */
+	typedef struct layer_state
+	{
+		Matrix weights;
+		Matrix bias;
+	} layer_state;
+
+	/**
+	 * @struct shard
+	 * @brief Buffers of a shard's forward and backward passes.
+	 * @var input - The shard images, one per column.
+	 * @var outputs - The output of every layer (width x samples).
+	 * @var deltas - The loss gradient of every layer output.
+	 * @var gradients - The gradient sums of the shard.
+	 * @var loss - The cross-entropy sum of the shard.
+	 * @var correct - The samples of the shard classified correctly.
+	 */
+	typedef struct shard
+	{
+		std::vector<float> input;
+		std::vector<std::vector<float>> outputs;
+		std::vector<std::vector<float>> deltas;
+		std::vector<layer_state> gradients;
+		double loss;
+		int correct;
+	} shard;
+
+	/**
+	* Computes the gradient sums, loss and accuracy of a shard.
+	* @param images - The training images.
+	* @param labels - The training labels.
+	* @param order - The sample indices of the shard.
+	* @param count - The number of samples of the shard.
+	* @param state - The shard buffers.
+	*/
+	void compute_shard(const Matrix& images,
+					   const std::vector<unsigned int>& labels,
+					   const int* order, int count, shard& state) const;
+
+	/**
+	* Updates every parameter from the summed gradients.
+	* @param samples - The minibatch samples the gradients sum over.
+	*/
+	void update(int samples);
+
+	// The trained layers
+	std::vector<model::layer> _layers;
+	const training_options _options;
+	// The widths of every layer output
+	std::vector<int> _widths;
+	// One shard per TRAINING_SHARD_SIZE samples of a minibatch
+	std::vector<shard> _shards;
+	// The minibatch gradients, summed over the shards
+	std::vector<layer_state> _gradients;
+	// The optimizer moments, velocity (SGD) or first moment (Adam)
+	std::vector<layer_state> _first_moments;
+	// The second moments (Adam)
+	std::vector<layer_state> _second_moments;
+	// The number of updates so far
+	long _steps;
+	// The sample order of the next epoch
+	unsigned int _epoch_seed;
+	// Computes the shards, nullptr when single-threaded
+	std::unique_ptr<WorkStealingPool> _pool;
+};
+
+#endif //TRAINER_H
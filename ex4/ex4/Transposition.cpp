@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "Transposition.h"
+
+/**
+* Swaps a rows x cols block lhs with the transpose of the
+* cols x rows block rhs, both within the same matrix.
+*/
+static void swap_transposed(int rows, int cols,
+							float* lhs, float* rhs, int stride)
+{
+	if ((rows <= transposition::BLOCK) && (cols <= transposition::BLOCK))
+	{
+		for (int row = 0; row < rows; row++)
+		{
+			for (int col = 0; col < cols; col++)
+			{
+				std::swap(lhs[(row * stride) + col], rhs[(col * stride) + row]);
+			}
+		}
+		return;
+	}
+
+	if (rows >= cols)
+	{
+		const int half = rows / 2;
+		swap_transposed(half, cols, lhs, rhs, stride);
+		swap_transposed(rows - half, cols,
+						lhs + (half * stride), rhs + half, stride);
+		return;
+	}
+
+	const int half = cols / 2;
+	swap_transposed(rows, half, lhs, rhs, stride);
+	swap_transposed(rows, cols - half,
+					lhs + half, rhs + (half * stride), stride);
+}
+
+// See documentation at header file
+void transposition::out_of_place(int rows, int cols,
+								 const float* source, int source_stride,
+								 float* destination, int destination_stride)
+{
+	if ((rows <= BLOCK) && (cols <= BLOCK))
+	{
+		for (int row = 0; row < rows; row++)
+		{
+			for (int col = 0; col < cols; col++)
+			{
+				destination[(col * destination_stride) + row] =
+					source[(row * source_stride) + col];
+			}
+		}
+		return;
+	}
+
+	if (rows >= cols)
+	{
+		const int half = rows / 2;
+		out_of_place(half, cols, source, source_stride,
+					 destination, destination_stride);
+		out_of_place(rows - half, cols,
+					 source + (half * source_stride), source_stride,
+					 destination + half, destination_stride);
+		return;
+	}
+
+	const int half = cols / 2;
+	out_of_place(rows, half, source, source_stride,
+				 destination, destination_stride);
+	out_of_place(rows, cols - half, source + half, source_stride,
+				 destination + (half * destination_stride),
+				 destination_stride);
+}
+
+// See documentation at header file
+void transposition::in_place_square(int size, float* data, int stride)
+{
+	if (size <= BLOCK)
+	{
+		for (int row = 0; row < size; row++)
+		{
+			for (int col = row + 1; col < size; col++)
+			{
+				std::swap(data[(row * stride) + col],
+						  data[(col * stride) + row]);
+			}
+		}
+		return;
+	}
+
+	// Diagonal quadrants transpose in place, the other two swap
+	const int half = size / 2;
+	in_place_square(half, data, stride);
+	in_place_square(size - half, data + (half * stride) + half, stride);
+	swap_transposed(half, size - half,
+					data + half, data + (half * stride), stride);
+}
+
+// See documentation at header file
+void transposition::in_place(int rows, int cols, float* data)
+{
+	if ((1 == rows) || (1 == cols))
+	{
+		// Vectors keep their memory layout
+		return;
+	}
+
+	if (rows == cols)
+	{
+		in_place_square(rows, data, cols);
+		return;
+	}
+
+	// The element at index i moves to (i * rows) mod (size - 1),
+	// the first and last elements stay in place
+	const int64_t last = (static_cast<int64_t>(rows) * cols) - 1;
+	std::vector<bool> moved(static_cast<size_t>(last + 1));
+	for (int64_t start = 1; start < last; start++)
+	{
+		if (moved[start])
+		{
+			continue;
+		}
+
+		float carried = data[start];
+		int64_t index = start;
+		do
+		{
+			index = (index * rows) % last;
+			std::swap(carried, data[index]);
+			moved[index] = true;
+		} while (index != start);
+	}
+}
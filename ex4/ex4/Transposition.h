@@ -0,0 +1,52 @@
+#ifndef TRANSPOSITION_H
+#define TRANSPOSITION_H
+
+/**
+* Cache-oblivious matrix transposition.
+* Matrices are row-major, addressed by a base pointer and a leading
+* dimension. The recursions halve the larger side of a block until
+* it fits within BLOCK x BLOCK, so every cache level sees blocks
+* small enough to hold both the rows read and the columns written,
+* whatever its size.
+*/
+namespace transposition
+{
+	// Side of the blocks transposed directly by the recursion leaves
+	constexpr int BLOCK = 16;
+
+	/**
+	* Writes the transpose of source into destination.
+	* @param rows - Row count of the source.
+	* @param cols - Column count of the source.
+	* @param source - The source matrix (rows x cols).
+	* @param source_stride - Leading dimension of the source.
+	* @param destination - The destination matrix (cols x rows),
+	*					   may not overlap the source.
+	* @param destination_stride - Leading dimension of the destination.
+	*/
+	void out_of_place(int rows, int cols,
+					  const float* source, int source_stride,
+					  float* destination, int destination_stride);
+
+	/**
+	* Transposes a square matrix in place, swapping blocks across
+	* the diagonal.
+	* @param size - Row and column count of the matrix.
+	* @param data - The matrix.
+	* @param stride - Leading dimension of the matrix.
+	*/
+	void in_place_square(int size, float* data, int stride);
+
+	/**
+	* Transposes a contiguous rows x cols matrix in place, into a
+	* contiguous cols x rows matrix, by following the permutation
+	* cycles. The only extra memory is one bit per element, marking
+	* the elements already moved.
+	* @param rows - Row count of the matrix before transposing.
+	* @param cols - Column count of the matrix before transposing.
+	* @param data - The matrix, rows * cols contiguous floats.
+	*/
+	void in_place(int rows, int cols, float* data);
+}
+
+#endif //TRANSPOSITION_H
@@ -0,0 +1,167 @@
+#include <stdexcept>
+
+#include "WorkStealingPool.h"
+
+// Exception descriptions
+#define INVALID_THREADS_EX ("Invalid thread count")
+
+// Whether the thread is running a task of a pool, whose nested loops
+// then run inline (waiting for the running loop would never end)
+static thread_local bool running_task = false;
+
+// See documentation at header file
+WorkStealingPool::WorkStealingPool(int threads) :
+	_task(nullptr),
+	_pending(0),
+	_generation(0),
+	_stopping(false)
+{
+	if (0 >= threads)
+	{
+		throw std::length_error(INVALID_THREADS_EX);
+	}
+
+	for (int thread = 0; thread < threads; thread++)
+	{
+		_queues.emplace_back(new task_queue());
+	}
+
+	// The calling thread is the first one, only the others are started
+	for (int thread = 1; thread < threads; thread++)
+	{
+		_workers.emplace_back(&WorkStealingPool::work, this, thread);
+	}
+}
+
+// See documentation at header file
+WorkStealingPool::~WorkStealingPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_started.notify_all();
+
+	for (auto& worker : _workers)
+	{
+		worker.join();
+	}
+}
+
+// See documentation at header file
+int WorkStealingPool::get_threads() const
+{
+	return static_cast<int>(_queues.size());
+}
+
+// See documentation at header file
+void WorkStealingPool::run(int count, const std::function<void(int)>& task)
+{
+	if (0 >= count)
+	{
+		return;
+	}
+
+	if (running_task)
+	{
+		for (int index = 0; index < count; index++)
+		{
+			task(index);
+		}
+		return;
+	}
+
+	std::lock_guard<std::mutex> run_lock(_run_mutex);
+	_task = &task;
+	_pending = count;
+	const int threads = get_threads();
+	for (int thread = 0; thread < threads; thread++)
+	{
+		std::lock_guard<std::mutex> lock(_queues[thread]->mutex);
+		for (int index = thread; index < count; index += threads)
+		{
+			_queues[thread]->indices.push_back(index);
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_generation++;
+	}
+	_started.notify_all();
+
+	while (run_one(0))
+	{}
+
+	// Tasks taken by the workers may still be running
+	std::unique_lock<std::mutex> lock(_mutex);
+	_finished.wait(lock, [this]() { return 0 == _pending; });
+}
+
+// See documentation at header file
+bool WorkStealingPool::run_one(int thread)
+{
+	const int threads = get_threads();
+	int index = -1;
+	for (int offset = 0; (offset < threads) && (0 > index); offset++)
+	{
+		task_queue& queue = *_queues[(thread + offset) % threads];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.indices.empty())
+		{
+			continue;
+		}
+
+		// The owner works from the back, thieves from the front
+		if (0 == offset)
+		{
+			index = queue.indices.back();
+			queue.indices.pop_back();
+		}
+		else
+		{
+			index = queue.indices.front();
+			queue.indices.pop_front();
+		}
+	}
+
+	if (0 > index)
+	{
+		return false;
+	}
+
+	running_task = true;
+	(*_task)(index);
+	running_task = false;
+	if (1 == _pending.fetch_sub(1))
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_finished.notify_all();
+	}
+
+	return true;
+}
+
+// See documentation at header file
+void WorkStealingPool::work(int thread)
+{
+	unsigned long generation = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_started.wait(lock, [this, generation]()
+			{
+				return _stopping || (generation != _generation);
+			});
+			if (_stopping)
+			{
+				return;
+			}
+			generation = _generation;
+		}
+
+		while (run_one(thread))
+		{}
+	}
+}
@@ -0,0 +1,106 @@
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @class WorkStealingPool
+ * @brief Threads running the indexed tasks of a parallel loop.
+ *		  Every thread (the calling thread included) owns a queue of
+ *		  task indices, dealt round-robin. A thread pops its own
+ *		  queue from the back and, once it is empty, steals from the
+ *		  front of the others, so uneven tasks balance out without a
+ *		  shared queue.
+ *		  Loops run one at a time; concurrent calls to run wait for
+ *		  each other. A loop started by a running task (of any pool),
+ *		  such as a parallel product inside a parallel loop, runs
+ *		  inline on the task's thread instead.
+ */
+class WorkStealingPool
+{
+public:
+	/**
+	* Starts the worker threads.
+	* @param threads - The number of threads running every loop,
+	*				   including the calling thread.
+	* @throws std::length_error in case threads is not positive.
+	*/
+	explicit WorkStealingPool(int threads);
+
+	// Explicitly defining behavior to prevent implicit behavior
+	WorkStealingPool() = delete;
+	WorkStealingPool(const WorkStealingPool&) = delete;
+	WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+	/**
+	* Stops the worker threads.
+	*/
+	~WorkStealingPool();
+
+	/**
+	* Gets the number of threads running every loop.
+	*/
+	int get_threads() const;
+
+	/**
+	* Runs task(index) for every index in [0, count), and returns once
+	* all of them are done. Tasks may run in any order, concurrently,
+	* and must not throw.
+	* @param count - The number of tasks.
+	* @param task - The task body, called with the task index.
+	*/
+	void run(int count, const std::function<void(int)>& task);
+
+private:
+	/**
+	 * @struct task_queue
+	 * @brief The task indices owned by a thread.
+	 * @var mutex - Guards the indices, against thieves.
+	 * @var indices - The indices left to run.
+	 */
+	typedef struct task_queue
+	{
+		std::mutex mutex;
+		std::deque<int> indices;
+	} task_queue;
+
+	/**
+	* Runs one task, from the thread's own queue or stolen.
+	* @param thread - The index of the running thread's queue.
+	* @return False once every queue is empty.
+	*/
+	bool run_one(int thread);
+
+	/**
+	* Worker thread body, joins every loop until stopped.
+	*/
+	void work(int thread);
+
+	// One queue per thread, the calling thread's first
+	std::vector<std::unique_ptr<task_queue>> _queues;
+	std::vector<std::thread> _workers;
+	// Serializes loops
+	std::mutex _run_mutex;
+	// Guards the loop generation and the stop flag
+	std::mutex _mutex;
+	// Signalled when a loop starts, and on stop
+	std::condition_variable _started;
+	// Signalled when the last task of a loop is done
+	std::condition_variable _finished;
+	// The body of the running loop
+	const std::function<void(int)>* _task;
+	// Tasks of the running loop not done yet
+	std::atomic<int> _pending;
+	// Incremented by every loop
+	unsigned long _generation;
+	bool _stopping;
+};
+
+#endif //WORKSTEALINGPOOL_H
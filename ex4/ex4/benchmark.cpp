@@ -0,0 +1,1297 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <initializer_list>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Gemm.h"
+#include "Gemv.h"
+#include "InferencePool.h"
+#include "MappedFile.h"
+#include "Dense.h"
+#include "Matrix.h"
+#include "MlpNetwork.h"
+#include "ModelFile.h"
+#include "QuantizedMatrix.h"
+#include "Reduction.h"
+#include "SparseMatrix.h"
+#include "StaticMlpNetwork.h"
+#include "Transposition.h"
+
+// Minimal wall time spent measuring a single case, in seconds
+constexpr double min_measure_seconds = 0.2;
+// Column count of the rhs in the GEMM cases (images per batch)
+constexpr int gemm_batch_cols = 64;
+// Minimal wall time of a single latency sample, in seconds
+constexpr double min_sample_seconds = 20e-6;
+// Minimal number of latency samples per suite case
+constexpr int min_samples = 100;
+
+#define USAGE_MSG "Usage:\n" \
+				  "\t./benchmark [--suite] [--json path]\n" \
+				  "\t--suite - run the regression suite only, without the\n" \
+				  "\t          comparisons against the original loops\n" \
+				  "\t--json - also write the suite results to a JSON file"
+#define SUITE_FLAG "--suite"
+#define JSON_FLAG "--json"
+#define JSON_WRITE_EX ("Cannot write the benchmark results to ")
+
+/**
+ * @struct latency
+ * @brief The latency distribution of a measured call.
+ * @var p50 - The median seconds per call.
+ * @var p99 - The 99th percentile of seconds per call.
+ * @var mean - The average seconds per call.
+ */
+typedef struct latency
+{
+	double p50;
+	double p99;
+	double mean;
+} latency;
+
+/**
+ * @struct suite_result
+ * @brief A measured case of the regression suite.
+ * @var name - The case name, "group/shape".
+ * @var timing - The latency of a call.
+ * @var throughput - Work units per second.
+ * @var unit - The throughput unit.
+ */
+typedef struct suite_result
+{
+	std::string name;
+	latency timing;
+	double throughput;
+	const char* unit;
+} suite_result;
+
+/**
+* The original matrix product: i-j-k loop over the bounds-checked
+* accessors. Kept as the baseline the GEMM engine is measured against.
+*/
+static Matrix naive_multiply(const Matrix& lhs, const Matrix& rhs)
+{
+	Matrix mult_matrix(lhs.get_rows(), rhs.get_cols());
+	for (int row = 0; row < lhs.get_rows(); row++)
+	{
+		for (int col = 0; col < rhs.get_cols(); col++)
+		{
+			float mult_sum = 0;
+			for (int index = 0; index < lhs.get_cols(); index++)
+			{
+				mult_sum += lhs(row, index) * rhs(index, col);
+			}
+			mult_matrix(row, col) = mult_sum;
+		}
+	}
+
+	return mult_matrix;
+}
+
+/**
+* The original transpose: scatters into a second buffer through the
+* bounds-checked accessors. Kept as the baseline the cache-oblivious
+* transposes are measured against.
+*/
+static Matrix naive_transpose(const Matrix& matrix)
+{
+	Matrix transposed(matrix.get_cols(), matrix.get_rows());
+	for (int row = 0; row < matrix.get_rows(); row++)
+	{
+		for (int col = 0; col < matrix.get_cols(); col++)
+		{
+			transposed(col, row) = matrix(row, col);
+		}
+	}
+
+	return transposed;
+}
+
+/**
+* The original parameter reader: one istream::read per float,
+* stored through the bounds-checked accessor. Kept as the baseline
+* the mapped loader is measured against.
+*/
+static void naive_read(std::istream& is, Matrix& matrix)
+{
+	for (int row = 0; row < matrix.get_rows(); row++)
+	{
+		for (int col = 0; col < matrix.get_cols(); col++)
+		{
+			float input = 0;
+			is.read(reinterpret_cast<char*>(&input), sizeof(input));
+			matrix(row, col) = input;
+		}
+	}
+}
+
+/**
+* The original column Softmax: std::exp of every value, then a
+* division by the sum, without subtracting the maximum. Kept as the
+* baseline the vectorized Softmax is measured against.
+*/
+static void naive_softmax_columns(float* data, int rows, int cols)
+{
+	for (int column_index = 0; column_index < cols; column_index++)
+	{
+		float* column = data + column_index;
+		float variable_sum = 0;
+		for (int row_index = 0; row_index < rows; row_index++)
+		{
+			column[row_index * cols] = std::exp(column[row_index * cols]);
+			variable_sum += column[row_index * cols];
+		}
+
+		for (int row_index = 0; row_index < rows; row_index++)
+		{
+			column[row_index * cols] /= variable_sum;
+		}
+	}
+}
+
+/**
+* Fills the matrix with pseudo-random values in [-1, 1].
+*/
+static void fill_random(Matrix& matrix)
+{
+	for (int index = 0;
+		 index < matrix.get_rows() * matrix.get_cols();
+		 index++)
+	{
+		matrix[index] =
+			(static_cast<float>(std::rand()) / RAND_MAX) * 2.0F - 1.0F;
+	}
+}
+
+/**
+* Runs the given callable repeatedly for at least
+* min_measure_seconds.
+* @return Average seconds per call.
+*/
+template <typename Callable>
+static double measure(Callable&& callable)
+{
+	using clock = std::chrono::steady_clock;
+
+	// Warm-up, also populates caches and packing buffers
+	callable();
+
+	long iterations = 0;
+	const auto start = clock::now();
+	double elapsed = 0;
+	do
+	{
+		callable();
+		iterations++;
+		elapsed = std::chrono::duration<double>(
+			clock::now() - start).count();
+	} while (elapsed < min_measure_seconds);
+
+	return elapsed / static_cast<double>(iterations);
+}
+
+/**
+* Measures naive and GEMM products for one shape and prints a row.
+*/
+static void benchmark_gemm(int rows, int depth, int cols)
+{
+	Matrix lhs(rows, depth);
+	Matrix rhs(depth, cols);
+	fill_random(lhs);
+	fill_random(rhs);
+
+	const double flops = 2.0 * rows * depth * cols;
+	const double naive_seconds = measure(
+		[&]() { (void)naive_multiply(lhs, rhs); });
+	const double gemm_seconds = measure(
+		[&]() { (void)(lhs * rhs); });
+
+	std::cout << std::setw(5) << rows << "x" << std::setw(4) << depth
+			  << " * " << std::setw(4) << depth << "x"
+			  << std::setw(4) << cols
+			  << std::setw(14) << flops / naive_seconds / 1e9
+			  << std::setw(14) << flops / gemm_seconds / 1e9
+			  << std::setw(10) << naive_seconds / gemm_seconds << "x"
+			  << std::endl;
+}
+
+/**
+* Measures a square product on 1 to 16 threads, and prints a row of
+* GFLOP/s with the scaling over a single thread.
+*/
+static void benchmark_parallel_gemm(int size)
+{
+	Matrix lhs(size, size);
+	Matrix rhs(size, size);
+	fill_random(lhs);
+	fill_random(rhs);
+
+	const double flops = 2.0 * size * size * size;
+	const int previous_threads = gemm::get_thread_count();
+	double single_thread_seconds = 0;
+	std::cout << std::setw(5) << size;
+	for (int threads : {1, 2, 4, 8, 16})
+	{
+		gemm::set_thread_count(threads);
+		const double seconds = measure([&]() { (void)(lhs * rhs); });
+		single_thread_seconds =
+			(1 == threads) ? seconds : single_thread_seconds;
+		std::cout << std::setw(9) << flops / seconds / 1e9
+				  << std::setw(6) << single_thread_seconds / seconds << "x";
+	}
+	std::cout << std::endl;
+	gemm::set_thread_count(previous_threads);
+}
+
+/**
+* Measures the matrix-vector product of one shape through the naive
+* loop, the GEMM engine and every supported GEMV kernel, and prints
+* a row of GFLOP/s.
+*/
+static void benchmark_gemv(int rows, int cols)
+{
+	Matrix matrix(rows, cols);
+	Matrix vector(cols, 1);
+	Matrix result(rows, 1);
+	fill_random(matrix);
+	fill_random(vector);
+
+	const double flops = 2.0 * rows * cols;
+	std::cout << std::setw(5) << rows << "x" << std::setw(4) << cols
+			  << std::setw(12)
+			  << flops / measure([&]() {
+					 (void)naive_multiply(matrix, vector); }) / 1e9
+			  << std::setw(12)
+			  << flops / measure([&]() {
+					 gemm::multiply(rows, 1, cols, matrix.data(), cols,
+									vector.data(), 1, result.data(), 1); }) / 1e9;
+
+	for (auto set : {simd::isa::SCALAR, simd::isa::AVX2,
+					 simd::isa::AVX512})
+	{
+		if (set > simd::active_isa())
+		{
+			std::cout << std::setw(12) << "-";
+			continue;
+		}
+
+		std::cout << std::setw(12)
+				  << flops / measure([&]() {
+						 gemv::multiply(set, rows, cols, matrix.data(), cols,
+										vector.data(), result.data()); }) / 1e9;
+	}
+
+	std::cout << std::endl;
+}
+
+/**
+* Measures one Dense layer on a single sample, computed unfused
+* through Matrix temporaries and through the fused kernel into a
+* preallocated buffer, and prints a row of microseconds per call.
+*/
+static void benchmark_dense(const matrix_dims& dims,
+							activation::ActivationPfn activation_func,
+							const char* activation_name)
+{
+	Matrix weights(dims.rows, dims.cols);
+	Matrix bias(dims.rows, 1);
+	Matrix input(dims.cols, 1);
+	Matrix output(dims.rows, 1);
+	fill_random(weights);
+	fill_random(bias);
+	fill_random(input);
+	const Dense layer(weights, bias, activation_func);
+
+	const double unfused_seconds = measure(
+		[&]() { (void)activation_func((weights * input) + bias); });
+	const double fused_seconds = measure(
+		[&]() { layer.forward(input.data(), output.data()); });
+
+	std::cout << std::setw(5) << dims.rows << "x" << std::setw(4) << dims.cols
+			  << std::setw(9) << activation_name
+			  << std::setw(12) << unfused_seconds * 1e6
+			  << std::setw(12) << fused_seconds * 1e6
+			  << std::setw(10) << unfused_seconds / fused_seconds << "x"
+			  << std::endl;
+}
+
+/**
+* Measures one Dense layer on a single sample with FP32 and INT8
+* weights, and prints a row of microseconds per call, with the int8
+* kernels (AVX-512 VNNI when supported) and with AVX2 pmaddubsw.
+*/
+static void benchmark_int8(const matrix_dims& dims)
+{
+	Matrix weights(dims.rows, dims.cols);
+	Matrix bias(dims.rows, 1);
+	Matrix input(dims.cols, 1);
+	Matrix output(dims.rows, 1);
+	fill_random(weights);
+	fill_random(bias);
+	fill_random(input);
+	const Dense fp32_layer(weights, bias, activation::relu);
+	const Dense int8_layer(weights, bias, activation::relu,
+						   weight_format::INT8);
+	const QuantizedMatrix quantized(weights);
+	const epilogue post = {bias.data(), true};
+
+	const double fp32_seconds = measure(
+		[&]() { fp32_layer.forward(input.data(), output.data()); });
+	const double int8_seconds = measure(
+		[&]() { int8_layer.forward(input.data(), output.data()); });
+	std::cout << std::setw(5) << dims.rows << "x" << std::setw(4) << dims.cols
+			  << std::setw(12) << fp32_seconds * 1e6
+			  << std::setw(12) << int8_seconds * 1e6;
+	if (simd::isa::AVX2 <= simd::active_isa())
+	{
+		const double avx2_seconds = measure([&]()
+		{
+			gemv::multiply(simd::isa::AVX2, quantized, input.data(),
+						   output.data(), post);
+		});
+		std::cout << std::setw(12) << avx2_seconds * 1e6;
+	}
+	std::cout << std::setw(10) << fp32_seconds / int8_seconds << "x"
+			  << std::endl;
+}
+
+/**
+* Measures one Dense layer with FP32, FP16 and BF16 weights, on a
+* single sample and on a batch, and prints a row of microseconds per
+* call.
+*/
+static void benchmark_half(const matrix_dims& dims)
+{
+	Matrix weights(dims.rows, dims.cols);
+	Matrix bias(dims.rows, 1);
+	Matrix input(dims.cols, gemm_batch_cols);
+	Matrix output(dims.rows, gemm_batch_cols);
+	fill_random(weights);
+	fill_random(bias);
+	fill_random(input);
+
+	std::cout << std::setw(5) << dims.rows << "x" << std::setw(4) << dims.cols;
+	for (int batch : {1, gemm_batch_cols})
+	{
+		for (auto format : {weight_format::FP32, weight_format::FP16,
+							weight_format::BF16})
+		{
+			const Dense layer(weights, bias, activation::relu, format);
+			const double seconds = measure([&]()
+			{
+				layer.forward(input.data(), output.data(), batch);
+			});
+			std::cout << std::setw(10) << seconds * 1e6;
+		}
+	}
+	std::cout << std::endl;
+}
+
+/**
+* Fills the matrix with pseudo-random values, pruned to the given
+* density: about that fraction of the cells is non-zero.
+*/
+static void fill_pruned(Matrix& matrix, float density)
+{
+	fill_random(matrix);
+	matrix = SparseMatrix(matrix, 1.0F - density).to_matrix();
+}
+
+/**
+* Measures one ReLU Dense layer pruned to the given density with FP32
+* and SPARSE weights, on a single sample and on a batch, and prints a
+* row of microseconds per call.
+*/
+static void benchmark_sparse(const matrix_dims& dims, float density)
+{
+	Matrix weights(dims.rows, dims.cols);
+	Matrix bias(dims.rows, 1);
+	Matrix input(dims.cols, gemm_batch_cols);
+	Matrix output(dims.rows, gemm_batch_cols);
+	fill_pruned(weights, density);
+	fill_random(bias);
+	fill_random(input);
+
+	const Dense fp32_layer(weights, bias, activation::relu);
+	const Dense sparse_layer(weights, bias, activation::relu,
+							 weight_format::SPARSE);
+	std::cout << std::setw(5) << dims.rows << "x" << std::setw(4) << dims.cols
+			  << std::setw(8) << std::setprecision(0) << density * 100 << "%"
+			  << std::setprecision(2);
+	for (int batch : {1, gemm_batch_cols})
+	{
+		for (const Dense* layer : {&fp32_layer, &sparse_layer})
+		{
+			const double seconds = measure([&]()
+			{
+				layer->forward(input.data(), output.data(), batch);
+			});
+			std::cout << std::setw(10) << seconds * 1e6;
+		}
+	}
+	std::cout << std::endl;
+}
+
+/**
+* Measures one ReLU Dense layer on a single sample of the given
+* density (the fraction of non-zero values), computed by the dense
+* kernel and by the layer, which skips the zero values, and prints a
+* row of microseconds per call.
+*/
+static void benchmark_sparse_input(const matrix_dims& dims, float density)
+{
+	Matrix weights(dims.rows, dims.cols);
+	Matrix bias(dims.rows, 1);
+	Matrix input(dims.cols, 1);
+	Matrix output(dims.rows, 1);
+	fill_random(weights);
+	fill_random(bias);
+	fill_pruned(input, density);
+	const Dense layer(weights, bias, activation::relu);
+	const epilogue post = {bias.data(), true};
+
+	const double dense_seconds = measure([&]()
+	{
+		gemv::multiply(dims.rows, dims.cols, weights.data(), dims.cols,
+					   input.data(), output.data(), post);
+	});
+	const double layer_seconds = measure(
+		[&]() { layer.forward(input.data(), output.data()); });
+	std::cout << std::setw(5) << dims.rows << "x" << std::setw(4) << dims.cols
+			  << std::setw(8) << std::setprecision(0) << density * 100 << "%"
+			  << std::setprecision(2)
+			  << std::setw(12) << dense_seconds * 1e6
+			  << std::setw(12) << layer_seconds * 1e6
+			  << std::setw(10) << dense_seconds / layer_seconds << "x"
+			  << std::endl;
+}
+
+/**
+* Measures the original and vectorized column Softmax, and the
+* log-Softmax, for one shape and prints a row.
+*/
+static void benchmark_softmax(int rows, int cols)
+{
+	Matrix logits(rows, cols);
+	fill_random(logits);
+	std::vector<float> buffer(static_cast<size_t>(rows) * cols);
+	const auto reset = [&]()
+	{
+		std::copy(logits.data(), logits.data() + buffer.size(),
+				  buffer.begin());
+	};
+
+	const double naive_seconds = measure([&]()
+	{
+		reset();
+		naive_softmax_columns(buffer.data(), rows, cols);
+	});
+	const double softmax_seconds = measure([&]()
+	{
+		reset();
+		activation::softmax_columns(buffer.data(), rows, cols);
+	});
+	const double log_seconds = measure([&]()
+	{
+		reset();
+		activation::log_softmax_columns(buffer.data(), rows, cols);
+	});
+
+	std::cout << std::setw(5) << rows << "x" << std::setw(4) << cols
+			  << std::setw(12) << naive_seconds * 1e6
+			  << std::setw(12) << softmax_seconds * 1e6
+			  << std::setw(12) << log_seconds * 1e6
+			  << std::setw(10) << naive_seconds / softmax_seconds << "x"
+			  << std::endl;
+}
+
+/**
+* Measures the original serial loops (std::pow for the norm) and the
+* vectorized reductions over a matrix of the given size, and prints a
+* row of microseconds per call.
+*/
+static void benchmark_reductions(int rows, int cols)
+{
+	Matrix matrix(rows, cols);
+	fill_random(matrix);
+	const int count = rows * cols;
+	const float* data = matrix.data();
+	volatile float sink = 0;
+
+	const double naive_norm_seconds = measure([&]()
+	{
+		float quadratic_sum = 0;
+		for (int index = 0; index < count; index++)
+		{
+			quadratic_sum += std::pow(data[index], 2.0F);
+		}
+		sink = std::sqrt(quadratic_sum);
+	});
+	const double norm_seconds = measure([&]() { sink = matrix.norm(); });
+	const double naive_sum_seconds = measure([&]()
+	{
+		float sum = 0;
+		for (int index = 0; index < count; index++)
+		{
+			sum += data[index];
+		}
+		sink = sum;
+	});
+	const double sum_seconds = measure([&]() { sink = matrix.sum(); });
+	const double naive_argmax_seconds = measure([&]()
+	{
+		int current_max = 0;
+		for (int index = 0; index < count; index++)
+		{
+			if (data[current_max] < data[index])
+			{
+				current_max = index;
+			}
+		}
+		sink = data[current_max];
+	});
+	const double argmax_seconds = measure([&]()
+	{
+		sink = matrix.max_with_index().value;
+	});
+	static_cast<void>(sink);
+
+	std::cout << std::setw(5) << rows << "x" << std::setw(5) << cols
+			  << std::setw(10) << naive_norm_seconds * 1e6
+			  << std::setw(8) << norm_seconds * 1e6
+			  << std::setw(10) << naive_sum_seconds * 1e6
+			  << std::setw(8) << sum_seconds * 1e6
+			  << std::setw(10) << naive_argmax_seconds * 1e6
+			  << std::setw(8) << argmax_seconds * 1e6 << std::endl;
+}
+
+/**
+* Measures 2 * lhs + rhs over matrices of the given size, computed
+* through intermediate matrices (as eager operators would) and as a
+* single expression, and prints a row of microseconds per call.
+*/
+static void benchmark_expression(int rows, int cols)
+{
+	Matrix lhs(rows, cols);
+	Matrix rhs(rows, cols);
+	Matrix result(rows, cols);
+	fill_random(lhs);
+	fill_random(rhs);
+
+	const double eager_seconds = measure([&]()
+	{
+		Matrix scaled(lhs);
+		float* values = scaled.data();
+		for (int index = 0; index < rows * cols; index++)
+		{
+			values[index] *= 2.0F;
+		}
+		Matrix sum(scaled);
+		sum += rhs;
+		result = sum;
+	});
+	const double lazy_seconds = measure(
+		[&]() { result = (2.0F * lhs) + rhs; });
+
+	std::cout << std::setw(5) << rows << "x" << std::setw(4) << cols
+			  << std::setw(18) << eager_seconds * 1e6
+			  << std::setw(12) << lazy_seconds * 1e6
+			  << std::setw(10) << eager_seconds / lazy_seconds << "x"
+			  << std::endl;
+}
+
+/**
+* Measures transposing one shape with the naive scatter, the
+* recursive out-of-place transpose and the in-place Matrix::transpose,
+* and prints a row of milliseconds per call, with the extra memory
+* the in-place transpose needs.
+*/
+static void benchmark_transpose(int rows, int cols)
+{
+	Matrix matrix(rows, cols);
+	fill_random(matrix);
+
+	const double naive_seconds =
+		measure([&]() { (void)naive_transpose(matrix); });
+	const double recursive_seconds = measure([&]()
+	{
+		Matrix transposed(cols, rows);
+		transposition::out_of_place(rows, cols, matrix.data(), cols,
+									transposed.data(), rows);
+	});
+	// Every call transposes back, so the shape alternates
+	const double in_place_seconds =
+		measure([&]() { matrix.transpose(); });
+
+	const double matrix_mb = rows * static_cast<double>(cols) * 4 / 1e6;
+	std::cout << std::setw(5) << rows << "x" << std::setw(5) << cols
+			  << std::setw(11) << naive_seconds * 1e3
+			  << std::setw(12) << recursive_seconds * 1e3
+			  << std::setw(12) << in_place_seconds * 1e3
+			  << std::setw(10) << matrix_mb
+			  << std::setw(10) << ((rows == cols) ? 0 : matrix_mb / 32)
+			  << std::endl;
+}
+
+/**
+* Measures loading one parameter file of the given shape with the
+* per-float reader, a single stream read, and the file mapping,
+* and prints a row of microseconds per load.
+*/
+static void benchmark_load(const matrix_dims& dims)
+{
+	const char* path = "benchmark_parameters.bin";
+	Matrix parameters(dims.rows, dims.cols);
+	fill_random(parameters);
+	{
+		std::ofstream file(path, std::ios::binary);
+		file.write(reinterpret_cast<const char*>(parameters.data()),
+				   static_cast<std::streamsize>(
+					   sizeof(float) * dims.rows * dims.cols));
+	}
+
+	const double naive_seconds = measure([&]()
+	{
+		std::ifstream file(path, std::ios::binary);
+		naive_read(file, parameters);
+	});
+	const double stream_seconds = measure([&]()
+	{
+		std::ifstream file(path, std::ios::binary);
+		file >> parameters;
+	});
+	const double mapped_seconds =
+		measure([&]() { (void)map_matrix(path, dims); });
+	std::remove(path);
+
+	std::cout << std::setw(5) << dims.rows << "x" << std::setw(4) << dims.cols
+			  << std::setw(12) << naive_seconds * 1e6
+			  << std::setw(12) << stream_seconds * 1e6
+			  << std::setw(12) << mapped_seconds * 1e6
+			  << std::endl;
+}
+
+/**
+* Measures MlpNetwork throughput for one batch size, classifying the
+* images one by one and as a single batch, and prints a row of
+* images per second.
+*/
+static void benchmark_batch(const MlpNetwork& mlp, int batch_size)
+{
+	const int image_size = img_dims.rows * img_dims.cols;
+	Matrix images(batch_size, image_size);
+	fill_random(images);
+
+	const double single_seconds = measure([&]()
+	{
+		for (int image_index = 0; image_index < batch_size; image_index++)
+		{
+			Matrix image(image_size, 1);
+			for (int pixel = 0; pixel < image_size; pixel++)
+			{
+				image[pixel] = images(image_index, pixel);
+			}
+			(void)mlp(image);
+		}
+	});
+	const double batch_seconds = measure(
+		[&]() { (void)mlp.classify_batch(images.data(), batch_size); });
+
+	std::cout << std::setw(10) << batch_size
+			  << std::setw(16) << batch_size / single_seconds
+			  << std::setw(16) << batch_size / batch_seconds
+			  << std::setw(10) << single_seconds / batch_seconds << "x"
+			  << std::endl;
+}
+
+/**
+* Measures the statically shaped network against MlpNetwork::forward
+* on a single image, and prints a row.
+*/
+static void benchmark_static_mlp(Matrix weights[MLP_SIZE],
+								 Matrix biases[MLP_SIZE])
+{
+	const MlpNetwork mlp(weights, biases);
+	const StaticMlpNetwork static_mlp(weights, biases);
+	Matrix image(IMAGE_SIZE, 1);
+	fill_random(image);
+	const StaticMlpNetwork::Image static_image(image);
+
+	Workspace workspace;
+	const double dynamic_seconds = measure(
+		[&]() { (void)mlp.forward(image.data(), workspace); });
+	const double static_seconds = measure(
+		[&]() { (void)static_mlp(static_image); });
+	std::cout << "one image" << std::setw(14) << dynamic_seconds * 1e6
+			  << std::setw(12) << static_seconds * 1e6
+			  << std::setw(10) << dynamic_seconds / static_seconds << "x"
+			  << std::endl;
+}
+
+/**
+* Measures the fixed-size StaticMatrix product loops against the GEMV
+* kernels for the first layer shape, and prints a row.
+*/
+static void benchmark_static_product()
+{
+	// The weights are too large for the stack
+	using Weights = StaticMatrix<weights_dims[0].rows, IMAGE_SIZE>;
+	Matrix weights(weights_dims[0].rows, IMAGE_SIZE);
+	Matrix vector(IMAGE_SIZE, 1);
+	fill_random(weights);
+	fill_random(vector);
+	const std::unique_ptr<const Weights> static_weights(new Weights(weights));
+	const StaticMatrix<IMAGE_SIZE, 1> static_vector(vector);
+
+	std::vector<float> result(weights_dims[0].rows);
+	const double loop_seconds = measure(
+		[&]() { result[0] += (*static_weights * static_vector)[0]; });
+	const double gemv_seconds = measure([&]()
+	{
+		gemv::multiply(weights_dims[0].rows, IMAGE_SIZE,
+					   static_weights->data(), IMAGE_SIZE,
+					   static_vector.data(), result.data());
+	});
+	std::cout << std::setw(5) << weights_dims[0].rows << "x"
+			  << std::setw(4) << IMAGE_SIZE
+			  << std::setw(13) << loop_seconds * 1e6
+			  << std::setw(12) << gemv_seconds * 1e6
+			  << std::setw(10) << loop_seconds / gemv_seconds << "x"
+			  << std::endl;
+}
+
+/**
+* Measures the throughput of an inference pool classifying images
+* one by one with the given number of workers, and prints a row of
+* images per second with the scaling over a single worker.
+* @param single_worker_rate - Images per second of a single worker,
+*							  0 when measuring it.
+* @return Images per second.
+*/
+static double benchmark_pool(const MlpNetwork& mlp, int workers,
+						   double single_worker_rate)
+{
+	constexpr int image_count = 512;
+	std::vector<Matrix> images;
+	for (int index = 0; index < image_count; index++)
+	{
+		Matrix image(img_dims.rows * img_dims.cols, 1);
+		fill_random(image);
+		images.push_back(image);
+	}
+
+	InferencePool pool(mlp, workers);
+	const double seconds = measure([&]() { (void)pool.classify(images); });
+	const double rate = image_count / seconds;
+	std::cout << std::setw(10) << workers
+			  << std::setw(16) << rate
+			  << std::setw(10)
+			  << ((0 < single_worker_rate) ? rate / single_worker_rate : 1.0)
+			  << "x" << std::endl;
+	return rate;
+}
+
+/**
+* Runs the given callable repeatedly, timing samples of as many calls
+* as take min_sample_seconds (so the clock resolution is negligible),
+* for at least min_measure_seconds and min_samples samples.
+* @return The latency distribution of a call.
+*/
+template <typename Callable>
+static latency measure_latency(Callable&& callable)
+{
+	using clock = std::chrono::steady_clock;
+	const auto time_calls = [&](long calls)
+	{
+		const auto start = clock::now();
+		for (long call = 0; call < calls; call++)
+		{
+			callable();
+		}
+		return std::chrono::duration<double>(clock::now() - start).count();
+	};
+
+	// Warm-up, then doubling the calls per sample up to the sample time
+	long calls = 1;
+	while (time_calls(calls) < min_sample_seconds)
+	{
+		calls *= 2;
+	}
+
+	std::vector<double> samples;
+	double elapsed = 0;
+	while ((elapsed < min_measure_seconds) ||
+		   (min_samples > static_cast<int>(samples.size())))
+	{
+		const double seconds = time_calls(calls);
+		samples.push_back(seconds / static_cast<double>(calls));
+		elapsed += seconds;
+	}
+
+	std::sort(samples.begin(), samples.end());
+	const auto percentile = [&](double fraction)
+	{
+		return samples[static_cast<size_t>(
+			std::ceil(fraction * static_cast<double>(samples.size()))) - 1];
+	};
+	return {percentile(0.5), percentile(0.99),
+			elapsed / static_cast<double>(calls * samples.size())};
+}
+
+/**
+* Measures a case of the regression suite, prints a row and records
+* the result.
+* @param results - The suite results, to append to.
+* @param name - The case name.
+* @param work - Work units done by a call, in the throughput unit
+*				per second (such as GFLOP or images).
+* @param unit - The throughput unit.
+* @param callable - The measured call.
+*/
+template <typename Callable>
+static void suite_case(std::vector<suite_result>& results,
+					   const std::string& name, double work,
+					   const char* unit, Callable&& callable)
+{
+	const latency timing = measure_latency(callable);
+	results.push_back({name, timing, work / timing.p50, unit});
+
+	std::cout << std::left << std::setw(30) << name << std::right
+			  << std::setw(12) << timing.p50 * 1e6
+			  << std::setw(12) << timing.p99 * 1e6
+			  << std::setw(14) << results.back().throughput
+			  << " " << unit << std::endl;
+}
+
+/**
+* Gets the name of a case shape.
+*/
+static std::string shape_name(const char* group, int rows, int cols)
+{
+	return std::string(group) + "/" + std::to_string(rows) + "x" +
+		   std::to_string(cols);
+}
+
+/**
+* Runs the regression suite: products at the network layer shapes
+* and at large sizes, transposes, every activation, model loading and
+* end-to-end inference. The throughput is computed from the median.
+* @param mlp - The network of the inference cases.
+* @param layers - The layers of mlp, saved to measure loading.
+* @return The results of every case, in order.
+*/
+static std::vector<suite_result> run_suite(
+	const MlpNetwork& mlp, const std::vector<model::layer>& layers)
+{
+	std::vector<suite_result> results;
+	std::cout << std::left << std::setw(30) << "Suite" << std::right
+			  << "    p50 (us)    p99 (us)    throughput" << std::endl;
+
+	for (const auto& dims : layers)
+	{
+		const int rows = dims.weights.get_rows();
+		const int cols = dims.weights.get_cols();
+		Matrix vector(cols, 1);
+		Matrix batch(cols, gemm_batch_cols);
+		fill_random(vector);
+		fill_random(batch);
+		suite_case(results, shape_name("gemv", rows, cols),
+				   2e-9 * rows * cols, "GFLOP/s",
+				   [&]() { (void)(dims.weights * vector); });
+		suite_case(results, shape_name("gemm", rows, cols) + "x" +
+							std::to_string(gemm_batch_cols),
+				   2e-9 * rows * cols * gemm_batch_cols, "GFLOP/s",
+				   [&]() { (void)(dims.weights * batch); });
+	}
+
+	// The first layer pruned to a tenth of its weights
+	{
+		const int rows = layers.front().weights.get_rows();
+		const int cols = layers.front().weights.get_cols();
+		Matrix weights(rows, cols);
+		Matrix vector(cols, 1);
+		Matrix result(rows, 1);
+		fill_pruned(weights, 0.1F);
+		fill_random(vector);
+		const SparseMatrix sparse(weights);
+		suite_case(results, shape_name("sparse_gemv", rows, cols) + "/10%",
+				   2e-9 * sparse.get_nonzeros(), "GFLOP/s",
+				   [&]() { gemv::multiply(sparse, vector.data(),
+										  result.data()); });
+	}
+
+	// Beyond the caches
+	{
+		constexpr int large = 1024;
+		constexpr int large_vector = 4096;
+		Matrix lhs(large, large);
+		Matrix rhs(large, large);
+		Matrix weights(large_vector, large_vector);
+		Matrix vector(large_vector, 1);
+		fill_random(lhs);
+		fill_random(rhs);
+		fill_random(weights);
+		fill_random(vector);
+		suite_case(results, shape_name("gemv", large_vector, large_vector),
+				   2e-9 * large_vector * large_vector, "GFLOP/s",
+				   [&]() { (void)(weights * vector); });
+		suite_case(results, shape_name("gemm", large, large) + "x" +
+							std::to_string(large),
+				   2e-9 * large * large * large, "GFLOP/s",
+				   [&]() { (void)(lhs * rhs); });
+		// Read and written once, in place and into a copy
+		suite_case(results, shape_name("transpose", large_vector,
+									   large_vector),
+				   8e-9 * large_vector * large_vector, "GB/s",
+				   [&]() { weights.transpose(); });
+		suite_case(results, shape_name("transpose_copy", large, large),
+				   8e-9 * large * large, "GB/s",
+				   [&]() { (void)MatrixView(lhs).transpose().to_matrix(); });
+	}
+
+	// Activations over a batch of layer outputs
+	{
+		const int rows = layers.front().weights.get_rows();
+		const int output_rows = mlp.get_output_size();
+		Matrix hidden(rows, gemm_batch_cols);
+		Matrix logits(output_rows, gemm_batch_cols);
+		fill_random(hidden);
+		fill_random(logits);
+		const double values = 1e-6 * rows * gemm_batch_cols;
+		const double output_values = 1e-6 * output_rows * gemm_batch_cols;
+		suite_case(results, shape_name("relu", rows, gemm_batch_cols),
+				   values, "Mvalues/s",
+				   [&]() { (void)activation::relu(hidden); });
+		suite_case(results, shape_name("softmax", output_rows,
+									   gemm_batch_cols),
+				   output_values, "Mvalues/s",
+				   [&]() { (void)activation::softmax(logits); });
+		suite_case(results, shape_name("log_softmax", output_rows,
+									   gemm_batch_cols),
+				   output_values, "Mvalues/s",
+				   [&]() { (void)activation::log_softmax(logits); });
+	}
+
+	// Parameter loading, reading the whole model file once per call
+	{
+		const char* path = "benchmark_model.bin";
+		model::save(path, layers);
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		const double megabytes = 1e-6 * static_cast<double>(file.tellg());
+		suite_case(results, "load/model", megabytes, "MB/s",
+				   [&]() { (void)model::load(path); });
+		std::remove(path);
+	}
+
+	// End-to-end inference
+	{
+		Matrix image(mlp.get_input_size(), 1);
+		Matrix images(mlp.get_input_size(), gemm_batch_cols);
+		fill_random(image);
+		fill_random(images);
+		Workspace workspace(mlp);
+		suite_case(results, "mlp/single", 1, "images/s",
+				   [&]() { (void)mlp.forward(image.data(), workspace); });
+		// A digit-like image, a fifth of the pixels non-zero
+		Matrix digit(mlp.get_input_size(), 1);
+		fill_pruned(digit, 0.2F);
+		suite_case(results, "mlp/single/sparse", 1, "images/s",
+				   [&]() { (void)mlp.forward(digit.data(), workspace); });
+		suite_case(results, "mlp/batch/" + std::to_string(gemm_batch_cols),
+				   gemm_batch_cols, "images/s",
+				   [&]() { (void)mlp.classify_batch(images); });
+	}
+
+	return results;
+}
+
+/**
+* Writes the suite results as JSON, so runs can be compared.
+* @param path - The file to write.
+* @param results - The suite results.
+* @throws std::runtime_error in case the file cannot be written.
+*/
+static void write_json(const std::string& path,
+					   const std::vector<suite_result>& results)
+{
+	std::ofstream file(path);
+	file << std::setprecision(6)
+		 << "{\n  \"isa\": \"" << simd::isa_name(simd::active_isa())
+		 << "\",\n  \"hardware_threads\": "
+		 << std::thread::hardware_concurrency()
+		 << ",\n  \"results\": [";
+	for (size_t index = 0; index < results.size(); index++)
+	{
+		const suite_result& result = results[index];
+		file << ((0 == index) ? "\n" : ",\n")
+			 << "    {\"name\": \"" << result.name
+			 << "\", \"p50_us\": " << result.timing.p50 * 1e6
+			 << ", \"p99_us\": " << result.timing.p99 * 1e6
+			 << ", \"mean_us\": " << result.timing.mean * 1e6
+			 << ", \"throughput\": " << result.throughput
+			 << ", \"unit\": \"" << result.unit << "\"}";
+	}
+	file << "\n  ]\n}\n";
+
+	if (!file)
+	{
+		throw std::runtime_error(JSON_WRITE_EX + path);
+	}
+}
+
+/**
+* Reports GFLOP/s of the naive loop against the GEMM engine and the
+* GEMV kernels for the layer shapes of MlpNetwork, the fused Dense
+* layer kernel, the weight formats, Softmax, reductions, element-wise
+* expressions, transposes and parameter loading.
+*/
+static void run_kernel_comparisons()
+{
+	std::cout << "GEMM (GFLOP/s)       naive loop   gemm engine   speedup"
+			  << std::endl;
+
+	for (int cols : {1, gemm_batch_cols})
+	{
+		for (const auto& dims : weights_dims)
+		{
+			benchmark_gemm(dims.rows, dims.cols, cols);
+		}
+	}
+
+	std::cout << std::endl
+			  << "GEMM threads (GFLOP/s, " << std::thread::hardware_concurrency()
+			  << " hardware threads)" << std::endl
+			  << " size        1            2            4"
+			  << "            8           16" << std::endl;
+	for (int size : {512, 2048})
+	{
+		benchmark_parallel_gemm(size);
+	}
+
+	std::cout << std::endl
+			  << "GEMV (GFLOP/s)  naive loop        gemm      scalar"
+			  << "        avx2      avx512" << std::endl;
+	for (const auto& dims : weights_dims)
+	{
+		benchmark_gemv(dims.rows, dims.cols);
+	}
+
+	std::cout << std::endl
+			  << "Dense (us/call)         unfused       fused   speedup"
+			  << std::endl;
+	for (int layer = 0; layer < MLP_SIZE; layer++)
+	{
+		const bool last_layer = (MLP_SIZE - 1 == layer);
+		benchmark_dense(weights_dims[layer],
+						last_layer ? activation::softmax : activation::relu,
+						last_layer ? "softmax" : "relu");
+	}
+
+	std::cout << std::endl
+			  << "INT8 (us/call)           fp32        int8   pmaddubsw"
+			  << "   speedup" << std::endl;
+	for (const auto& dims : weights_dims)
+	{
+		benchmark_int8(dims);
+	}
+
+	std::cout << std::endl
+			  << "Half (us/call)      fp32      fp16      bf16"
+			  << "  fp32 x64  fp16 x64  bf16 x64" << std::endl;
+	for (const auto& dims : weights_dims)
+	{
+		benchmark_half(dims);
+	}
+	// Weights beyond the caches, where the product is bandwidth-bound
+	benchmark_half({4096, 4096});
+
+	std::cout << std::endl
+			  << "Sparse (us/call)  density      fp32    sparse"
+			  << "  fp32 x64 sparse x64" << std::endl;
+	for (float density : {1.0F, 0.5F, 0.2F, 0.1F, 0.05F})
+	{
+		benchmark_sparse(weights_dims[0], density);
+	}
+
+	std::cout << std::endl
+			  << "Sparse input (us)  density       dense     skipping"
+			  << "   speedup" << std::endl;
+	// Digits are 10 to 25% non-zero, hidden ReLU outputs about half
+	for (float density : {1.0F, 0.5F, 0.2F, 0.1F})
+	{
+		benchmark_sparse_input(weights_dims[0], density);
+	}
+	benchmark_sparse_input(weights_dims[1], 0.5F);
+
+	std::cout << std::endl
+			  << "Softmax (us/call)     naive  vectorized         log"
+			  << "   speedup" << std::endl;
+	for (const auto& shape : {matrix_dims{10, 1}, matrix_dims{10, 64},
+							  matrix_dims{1000, 1}, matrix_dims{1000, 64}})
+	{
+		benchmark_softmax(shape.rows, shape.cols);
+	}
+
+	std::cout << std::endl
+			  << "Reduce (us)   norm pow     simd  sum loop     simd"
+			  << "  argmax loop  simd" << std::endl;
+	for (const auto& shape : {matrix_dims{weights_dims[0].rows,
+										  weights_dims[0].cols},
+							  matrix_dims{4096, 4096}})
+	{
+		benchmark_reductions(shape.rows, shape.cols);
+	}
+
+	std::cout << std::endl
+			  << "2*a+b (us/call)   temporaries  expression   speedup"
+			  << std::endl;
+	for (const auto& dims : weights_dims)
+	{
+		benchmark_expression(dims.rows, dims.cols);
+	}
+
+	std::cout << std::endl
+			  << "Transpose (ms)   naive   recursive    in place"
+			  << "   size MB  extra MB" << std::endl;
+	for (const auto& shape : {matrix_dims{4096, 4096},
+							  matrix_dims{784, 60000}})
+	{
+		benchmark_transpose(shape.rows, shape.cols);
+	}
+
+	std::cout << std::endl
+			  << "Load (us)        per float  one read      mapped"
+			  << std::endl;
+	for (const auto& dims : weights_dims)
+	{
+		benchmark_load(dims);
+	}
+}
+
+/**
+* Reports the network throughput by batch size, the statically shaped
+* network and the inference pool scaling.
+* @param weights - The weights of the network layers.
+* @param biases - The biases of the network layers.
+* @param mlp - The network of weights and biases.
+*/
+static void run_network_comparisons(Matrix weights[MLP_SIZE],
+									Matrix biases[MLP_SIZE],
+									const MlpNetwork& mlp)
+{
+	std::cout << "MLP (images/s)   one by one     batched   speedup"
+			  << std::endl;
+	for (int batch_size : {1, 8, 64, 512})
+	{
+		benchmark_batch(mlp, batch_size);
+	}
+
+	std::cout << std::endl
+			  << "Static (us)         MlpNetwork      static   speedup"
+			  << std::endl;
+	benchmark_static_mlp(weights, biases);
+	std::cout << "StaticMatrix (us)  fixed loops        gemv   speedup"
+			  << std::endl;
+	benchmark_static_product();
+
+	const int cores = static_cast<int>(std::thread::hardware_concurrency());
+	std::cout << std::endl
+			  << "Pool (images/s)  " << cores << " hardware threads"
+			  << std::endl;
+	std::cout << "   workers      throughput   scaling" << std::endl;
+	double single_worker_rate = 0;
+	for (int workers : {1, 2, 4, 8})
+	{
+		const double rate = benchmark_pool(mlp, workers, single_worker_rate);
+		single_worker_rate = (1 == workers) ? rate : single_worker_rate;
+	}
+}
+
+/**
+* Benchmark entry point, comparing every optimized kernel against the
+* original loops, then running the regression suite, whose results can
+* be written as JSON to compare runs.
+* @param argc count of args
+* @param argv args values
+* @return program exit status code
+*/
+int main(int argc, char** argv)
+{
+	bool suite_only = false;
+	std::string json_path;
+	for (int index = 1; index < argc; index++)
+	{
+		if (0 == std::strcmp(SUITE_FLAG, argv[index]))
+		{
+			suite_only = true;
+		}
+		else if ((0 == std::strcmp(JSON_FLAG, argv[index])) &&
+				 (index + 1 < argc))
+		{
+			json_path = argv[++index];
+		}
+		else
+		{
+			std::cerr << USAGE_MSG << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::cout << std::fixed << std::setprecision(2);
+	if (!suite_only)
+	{
+		run_kernel_comparisons();
+		std::cout << std::endl;
+	}
+
+	Matrix weights[MLP_SIZE];
+	Matrix biases[MLP_SIZE];
+	for (int layer = 0; layer < MLP_SIZE; layer++)
+	{
+		weights[layer] = Matrix(weights_dims[layer].rows,
+								weights_dims[layer].cols);
+		biases[layer] = Matrix(bias_dims[layer].rows, bias_dims[layer].cols);
+		fill_random(weights[layer]);
+		fill_random(biases[layer]);
+	}
+	const MlpNetwork mlp(weights, biases);
+
+	if (!suite_only)
+	{
+		run_network_comparisons(weights, biases, mlp);
+		std::cout << std::endl;
+	}
+
+	std::vector<model::layer> layers;
+	for (int layer = 0; layer < MLP_SIZE; layer++)
+	{
+		layers.push_back({weights[layer], biases[layer],
+						  (MLP_SIZE - 1 == layer) ?
+							  activation::softmax : activation::relu});
+	}
+
+	try
+	{
+		const std::vector<suite_result> results = run_suite(mlp, layers);
+		if (!json_path.empty())
+		{
+			write_json(json_path, results);
+		}
+	}
+	catch (const std::exception& exception)
+	{
+		std::cerr << exception.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
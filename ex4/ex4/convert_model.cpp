@@ -0,0 +1,112 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+#include "ModelFile.h"
+#include "MlpNetwork.h"
+
+#define USAGE_MSG "Usage:\n" \
+				  "\t./convert_model w1 w2 w3 w4 b1 b2 b3 b4 model\n" \
+				  "\t./convert_model -s n0,n1,...,nk w1 ... wk b1 ... bk model\n" \
+				  "\twi - the i'th layer's weights\n" \
+				  "\tbi - the i'th layer's biases\n" \
+				  "\tni - the layer widths, n0 the image size, nk the\n" \
+				  "\t     output size (the default is 784,128,64,20,10)\n" \
+				  "\tmodel - the single model file to write"
+#define SHAPE_FLAG "-s"
+#define SHAPE_ARGS_COUNT 2
+#define ARGS_START_IDX 1
+#define INVALID_SHAPE_EX ("Invalid layer widths: ")
+
+/**
+* Parses comma separated layer widths.
+* @param shape - The widths, such as "784,64,10".
+* @throws std::invalid_argument in case of fewer than two widths, or
+*		  a width which is not a positive number.
+* @return The dimensions of every layer's weights.
+*/
+static std::vector<matrix_dims> parse_shape(const std::string& shape)
+{
+	std::vector<int> widths;
+	std::stringstream stream(shape);
+	std::string width;
+	while (std::getline(stream, width, ','))
+	{
+		const int value = std::atoi(width.c_str());
+		if (0 >= value)
+		{
+			throw std::invalid_argument(INVALID_SHAPE_EX + shape);
+		}
+		widths.push_back(value);
+	}
+	if (2 > widths.size())
+	{
+		throw std::invalid_argument(INVALID_SHAPE_EX + shape);
+	}
+
+	std::vector<matrix_dims> dims;
+	for (size_t index = 1; index < widths.size(); index++)
+	{
+		dims.push_back({widths[index], widths[index - 1]});
+	}
+
+	return dims;
+}
+
+/**
+* Converts loose parameter files (as given to mlpnetwork) into a single
+* model file. The default network layers are converted unless layer
+* widths are given, for a network of any depth.
+* @param argc count of args
+* @param argv args values
+* @return program exit status code
+*/
+int main(int argc, char** argv)
+{
+	try
+	{
+		const bool shaped = (ARGS_START_IDX < argc) &&
+							(0 == std::strcmp(SHAPE_FLAG, argv[ARGS_START_IDX]));
+		std::vector<matrix_dims> dims(weights_dims, weights_dims + MLP_SIZE);
+		if (shaped && (ARGS_START_IDX + 1 < argc))
+		{
+			dims = parse_shape(argv[ARGS_START_IDX + 1]);
+		}
+
+		const int layer_count = static_cast<int>(dims.size());
+		const int weights_start = ARGS_START_IDX +
+								  (shaped ? SHAPE_ARGS_COUNT : 0);
+		const int bias_start = weights_start + layer_count;
+		const int model_index = bias_start + layer_count;
+		if (model_index + 1 != argc)
+		{
+			std::cerr << USAGE_MSG << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		std::vector<model::layer> layers;
+		for (int index = 0; index < layer_count; index++)
+		{
+			layers.push_back({
+				map_matrix(argv[weights_start + index], dims[index]),
+				map_matrix(argv[bias_start + index], {dims[index].rows, 1}),
+				(layer_count - 1 == index) ?
+					activation::softmax : activation::relu
+			});
+		}
+
+		model::save(argv[model_index], layers);
+	}
+	catch (const std::exception& exception)
+	{
+		std::cerr << exception.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
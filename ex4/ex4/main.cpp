@@ -1,11 +1,22 @@
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <future>
 #include <iostream>
 #include <fstream>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "Matrix.h"
 #include "Activation.h"
 #include "Dense.h"
+#include "ImagePipeline.h"
+#include "InferencePool.h"
 #include "MlpNetwork.h"
+#include "MappedFile.h"
+#include "ModelFile.h"
 
 #define QUIT "q"
 #define INSERT_IMAGE_PATH "Please insert image path:"
@@ -14,13 +25,33 @@
 #define ERROR_INVALID_IMG "Error: invalid image path or size: "
 #define USAGE_MSG "Usage:\n" \
                   "\t./mlpnetwork w1 w2 w3 w4 b1 b2 b3 b4\n" \
+                  "\t./mlpnetwork model\n" \
                   "\twi - the i'th layer's weights\n" \
-                  "\tbi - the i'th layer's biases"
+                  "\tbi - the i'th layer's biases\n" \
+                  "\tmodel - a single model file (see convert_model), of\n" \
+                  "\t        any number of layers"
 #define USAGE_ERR "Error: wrong number of arguments."
 #define ARGS_START_IDX 1
 #define ARGS_COUNT (ARGS_START_IDX + (MLP_SIZE * 2))
+#define MODEL_ARGS_COUNT (ARGS_START_IDX + 1)
+#define MODEL_IDX ARGS_START_IDX
+#define ERROR_INVALID_MODEL "Error: failed to load model: "
+#define ERROR_MODEL_INPUT "model input must be a whole image"
 #define WEIGHTS_START_IDX ARGS_START_IDX
 #define BIAS_START_IDX (ARGS_START_IDX + MLP_SIZE)
+// Environment variable selecting the weights format,
+// one of "fp32" (the default), "int8", "fp16", "bf16" or "sparse"
+// (for models pruned with prune_model)
+#define WEIGHT_FORMAT_ENV "MLP_WEIGHTS"
+// Environment variable setting the number of inference worker threads,
+// images are classified on the calling thread when unset or below 2
+#define WORKERS_ENV "MLP_THREADS"
+// Environment variable streaming image paths through the prefetching
+// pipeline instead of prompting for them, "-" for paths on the standard
+// input, any other value a manifest file of paths
+#define STREAM_ENV "MLP_STREAM"
+#define STREAM_STDIN "-"
+#define ERROR_INVALID_MANIFEST "Error: failed to open manifest: "
 
 /**
  * Prints program usage to stdout.
@@ -29,7 +60,7 @@
  */
 void usage (int argc) noexcept (false)
 {
-  if (argc != ARGS_COUNT)
+  if ((argc != ARGS_COUNT) && (argc != MODEL_ARGS_COUNT))
   {
 	throw std::domain_error (USAGE_ERR);
   }
@@ -54,35 +85,108 @@ bool readFileToMatrix (const std::string &filePath, Matrix &mat)
 }
 
 /**
- * Loads MLP parameters from weights & biases paths
- * to Weights[] and Biases[].
+ * Loads the default MLP parameters from weights & biases paths
+ * to the layers of the network.
+ * The files are memory mapped, and the matrices built directly on the
+ * mapped pages, so loading does not read the parameters.
  * Throws an exception upon failures.
  * @param paths array of programs arguments, expected to be mlp parameters
  *        path.
- * @param weights array of matrix, weigths[i] is the i'th layer weights matrix
- * @param biases array of matrix, biases[i] is the i'th layer bias matrix
- *          (which is actually a vector)
+ * @return the layers, ReLU activated but the last, Softmax activated
  *  @throw std::invalid_argument in case of problem with a certain argument
  */
-void loadParameters (char *paths[ARGS_COUNT], Matrix weights[MLP_SIZE],
-					 Matrix biases[MLP_SIZE]) noexcept (false)
+std::vector<model::layer> loadParameters (char *paths[ARGS_COUNT])
+noexcept (false)
 {
+  std::vector<model::layer> layers;
   for (int i = 0; i < MLP_SIZE; i++)
   {
-	weights[i] = Matrix (weights_dims[i].rows, weights_dims[i].cols);
-	biases[i] = Matrix (bias_dims[i].rows, bias_dims[i].cols);
-
 	std::string weightsPath (paths[WEIGHTS_START_IDX + i]);
 	std::string biasPath (paths[BIAS_START_IDX + i]);
 
-	if (!(readFileToMatrix (weightsPath, weights[i]) &&
-		  readFileToMatrix (biasPath, biases[i])))
+	try
+	{
+	  layers.push_back ({map_matrix (weightsPath, weights_dims[i]),
+						 map_matrix (biasPath, bias_dims[i]),
+						 (MLP_SIZE - 1 == i) ? activation::softmax
+											 : activation::relu});
+	}
+	catch (const std::runtime_error &)
 	{
 	  auto msg = ERROR_INAVLID_PARAMETER + std::to_string (i + 1);
 	  throw std::invalid_argument (msg);
 	}
+  }
+
+  return layers;
+}
+
+/**
+ * Loads every layer of a single model file, with a single mapping of
+ * the file. The model may have any number of layers of any widths.
+ * @param path the model file path.
+ * @return the layers, in order
+ *  @throw std::invalid_argument in case of problem with the model file
+ */
+std::vector<model::layer> loadModel (const std::string &path)
+noexcept (false)
+{
+  try
+  {
+	std::vector<model::layer> layers = model::load (path);
+	if (layers.empty () ||
+		(layers.front ().weights.get_cols () != img_dims.rows * img_dims.cols))
+	{
+	  throw std::runtime_error (ERROR_MODEL_INPUT);
+	}
+	return layers;
+  }
+  catch (const std::runtime_error &runtimeError)
+  {
+	throw std::invalid_argument (ERROR_INVALID_MODEL
+								 + std::string (runtimeError.what ()));
+  }
+}
 
+/**
+ * Reads the weights format of the network from the environment.
+ * The parameters are converted to it once, while the network is built.
+ * @return The requested format, fp32 when unset or unknown.
+ */
+weight_format weightFormat ()
+{
+  const char *requested = std::getenv (WEIGHT_FORMAT_ENV);
+  const std::string format ((nullptr == requested) ? "" : requested);
+  if (format == "int8")
+  {
+	return weight_format::INT8;
   }
+  if (format == "fp16")
+  {
+	return weight_format::FP16;
+  }
+  if (format == "bf16")
+  {
+	return weight_format::BF16;
+  }
+  if (format == "sparse")
+  {
+	return weight_format::SPARSE;
+  }
+  return weight_format::FP32;
+}
+
+/**
+ * Prints a classified image and the network prediction.
+ * @param img the image.
+ * @param output the network prediction for the image.
+ */
+void printResult (Matrix &img, const digit &output)
+{
+  std::cout << "Image processed:" << std::endl
+			<< img << std::endl;
+  std::cout << "Mlp result: " << output.value <<
+			" at probability: " << output.probability << std::endl;
 }
 
 /**
@@ -113,11 +217,7 @@ void mlpCli (MlpNetwork &mlp) noexcept (false)
 	if (readFileToMatrix (imgPath, img))
 	{
 	  Matrix imgVec = img;
-	  digit output = mlp (imgVec.vectorize ());
-	  std::cout << "Image processed:" << std::endl
-				<< img << std::endl;
-	  std::cout << "Mlp result: " << output.value <<
-				" at probability: " << output.probability << std::endl;
+	  printResult (img, mlp (imgVec.vectorize ()));
 	}
 	else
 	{
@@ -133,6 +233,95 @@ void mlpCli (MlpNetwork &mlp) noexcept (false)
   }
 }
 
+/**
+ * Same as mlpCli, with the images classified by a pool of worker
+ * threads: every image is queued as soon as it is read, and results
+ * are printed in input order as they complete, the remaining ones
+ * once the user quits.
+ * @param mlp MlpNetwork to use in order to predict img, shared by
+ *        the workers.
+ * @param workers number of worker threads.
+ * @throw std::invalid_argument in case of problem with the user input path
+ */
+void mlpPoolCli (const MlpNetwork &mlp, int workers) noexcept (false)
+{
+  InferencePool pool (mlp, workers);
+  std::deque<std::pair<Matrix, std::future<digit>>> pending;
+  std::string imgPath;
+
+  std::cout << INSERT_IMAGE_PATH << std::endl;
+  std::cin >> imgPath;
+  if (!std::cin.good ())
+  {
+	throw std::invalid_argument (ERROR_INVALID_INPUT);
+  }
+
+  while (imgPath != QUIT)
+  {
+	Matrix img (img_dims.rows, img_dims.cols);
+	if (!readFileToMatrix (imgPath, img))
+	{
+	  throw std::invalid_argument (ERROR_INVALID_IMG + imgPath);
+	}
+	Matrix imgVec = img;
+	std::future<digit> output = pool.submit (std::move (imgVec.vectorize ()));
+	pending.emplace_back (std::move (img), std::move (output));
+
+	while (!pending.empty () && (std::future_status::ready ==
+		   pending.front ().second.wait_for (std::chrono::seconds (0))))
+	{
+	  printResult (pending.front ().first, pending.front ().second.get ());
+	  pending.pop_front ();
+	}
+
+	std::cout << INSERT_IMAGE_PATH << std::endl;
+	std::cin >> imgPath;
+	if (!std::cin.good ())
+	{
+	  throw std::invalid_argument (ERROR_INVALID_INPUT);
+	}
+  }
+
+  for (auto &result : pending)
+  {
+	printResult (result.first, result.second.get ());
+  }
+}
+
+/**
+ * Streams image paths through an ImagePipeline: the images are read
+ * ahead by reader threads while earlier ones are classified, and one
+ * result line is printed per image, in input order.
+ * @param mlp MlpNetwork to use in order to predict the images.
+ * @param source STREAM_STDIN for paths on the standard input, or the
+ *        path of a manifest file listing the image paths.
+ * @throw std::invalid_argument in case of problem with the manifest or
+ *        an image path
+ */
+void mlpStreamCli (const MlpNetwork &mlp, const std::string &source)
+noexcept (false)
+{
+  std::ifstream manifest;
+  if (source != STREAM_STDIN)
+  {
+	manifest.open (source);
+	if (!manifest.is_open ())
+	{
+	  throw std::invalid_argument (ERROR_INVALID_MANIFEST + source);
+	}
+  }
+
+  ImagePipeline pipeline (mlp);
+  pipeline.run (manifest.is_open () ? manifest : std::cin,
+				[] (const std::string &path, const float *,
+					const digit &output)
+				{
+				  std::cout << path << ": Mlp result: " << output.value
+							<< " at probability: " << output.probability
+							<< std::endl;
+				});
+}
+
 /**
  * Program's main
  * @param argc count of args
@@ -152,25 +341,43 @@ int main (int argc, char **argv)
 
   }
 
-  Matrix weights[MLP_SIZE];
-  Matrix biases[MLP_SIZE];
+  std::unique_ptr<MlpNetwork> network;
 
   try
   {
-	loadParameters (argv, weights, biases);
-
+	const std::vector<model::layer> layers = (argc == MODEL_ARGS_COUNT) ?
+		loadModel (argv[MODEL_IDX]) : loadParameters (argv);
+	network.reset (new MlpNetwork (layers, weightFormat ()));
   }
   catch (const std::invalid_argument &invalidArgument)
   {
 	std::cerr << invalidArgument.what () << std::endl;
 	return EXIT_FAILURE;
   }
+  catch (const std::length_error &lengthError)
+  {
+	std::cerr << ERROR_INVALID_MODEL << lengthError.what () << std::endl;
+	return EXIT_FAILURE;
+  }
 
-  MlpNetwork mlp (weights, biases);
+  MlpNetwork &mlp = *network;
 
+  const char *workers = std::getenv (WORKERS_ENV);
+  const char *stream = std::getenv (STREAM_ENV);
   try
   {
-	mlpCli (mlp);
+	if (nullptr != stream)
+	{
+	  mlpStreamCli (mlp, stream);
+	}
+	else if ((nullptr != workers) && (1 < std::atoi (workers)))
+	{
+	  mlpPoolCli (mlp, std::atoi (workers));
+	}
+	else
+	{
+	  mlpCli (mlp);
+	}
   }
 
   catch (const std::invalid_argument &invalidArgument)
@@ -0,0 +1,90 @@
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "ModelFile.h"
+#include "SparseMatrix.h"
+
+#define USAGE_MSG "Usage:\n" \
+				  "\t./prune_model model threshold pruned_model\n" \
+				  "\tmodel - the model file to prune (see convert_model)\n" \
+				  "\tthreshold - weights of magnitude up to it are set to 0\n" \
+				  "\tpruned_model - the model file to write, run it with\n" \
+				  "\t               MLP_WEIGHTS=sparse"
+#define MODEL_IDX 1
+#define THRESHOLD_IDX 2
+#define PRUNED_MODEL_IDX 3
+#define ARGS_COUNT 4
+#define INVALID_THRESHOLD_EX ("Invalid pruning threshold: ")
+
+/**
+* Parses the pruning threshold.
+* @param threshold - The threshold, such as "0.05".
+* @throws std::invalid_argument in case the threshold is not a
+*		  non-negative number.
+* @return The threshold.
+*/
+static float parse_threshold(const std::string& threshold)
+{
+	char* end = nullptr;
+	const float value = std::strtof(threshold.c_str(), &end);
+	if (threshold.empty() || ('\0' != *end) || !(0.0F <= value))
+	{
+		throw std::invalid_argument(INVALID_THRESHOLD_EX + threshold);
+	}
+
+	return value;
+}
+
+/**
+* Prunes a model file by weight magnitude: every weight of magnitude
+* up to the threshold is set to exact 0, the biases are kept. Prints
+* the weights kept by every layer, so a threshold can be chosen for a
+* target sparsity.
+* @param argc count of args
+* @param argv args values
+* @return program exit status code
+*/
+int main(int argc, char** argv)
+{
+	if (ARGS_COUNT != argc)
+	{
+		std::cerr << USAGE_MSG << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	try
+	{
+		const float threshold = parse_threshold(argv[THRESHOLD_IDX]);
+		std::vector<model::layer> layers = model::load(argv[MODEL_IDX]);
+
+		long kept = 0;
+		long total = 0;
+		for (size_t index = 0; index < layers.size(); index++)
+		{
+			const SparseMatrix pruned(layers[index].weights, threshold);
+			layers[index].weights = pruned.to_matrix();
+			kept += pruned.get_nonzeros();
+			total += static_cast<long>(pruned.get_rows()) * pruned.get_cols();
+			std::cout << "layer " << index << " (" << pruned.get_rows()
+					  << "x" << pruned.get_cols() << "): kept "
+					  << pruned.get_nonzeros() << " weights, "
+					  << std::fixed << std::setprecision(1)
+					  << 100.0F * pruned.get_density() << "%" << std::endl;
+		}
+		std::cout << "total: kept " << kept << " of " << total << " weights"
+				  << std::endl;
+
+		model::save(argv[PRUNED_MODEL_IDX], layers);
+	}
+	catch (const std::exception& exception)
+	{
+		std::cerr << exception.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "MappedFile.h"
+#include "ModelFile.h"
+#include "MlpNetwork.h"
+
+#define USAGE_MSG "Usage:\n" \
+				  "\t./quantization_report model image1 [image2 ...]\n" \
+				  "\tmodel - the model file (see convert_model)\n" \
+				  "\timagei - the images to classify"
+#define MODEL_IDX 1
+#define IMAGES_START_IDX 2
+#define MIN_ARGS_COUNT (IMAGES_START_IDX + 1)
+
+/**
+ * @struct reduced_format
+ * @brief A reduced weight format compared against the FP32 network.
+ * @var format - The weight format.
+ * @var name - The printable name of the format.
+ */
+typedef struct reduced_format
+{
+	weight_format format;
+	const char* name;
+} reduced_format;
+
+const reduced_format reduced_formats[] = {{weight_format::INT8, "int8"},
+										  {weight_format::FP16, "fp16"},
+										  {weight_format::BF16, "bf16"}};
+constexpr int reduced_formats_count =
+	sizeof(reduced_formats) / sizeof(reduced_formats[0]);
+
+/**
+* Classifies every given image with the FP32 network of the model and
+* with its reduced weight formats, and reports whether every format's
+* top-1 digit matches the FP32 one, and how far its probability drifted.
+* @param argc count of args
+* @param argv args values
+* @return program exit status code, failure on any top-1 mismatch
+*/
+int main(int argc, char** argv)
+{
+	if (MIN_ARGS_COUNT > argc)
+	{
+		std::cerr << USAGE_MSG << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	int matches[reduced_formats_count] = {};
+	float max_differences[reduced_formats_count] = {};
+	const int count = argc - IMAGES_START_IDX;
+	try
+	{
+		const std::vector<model::layer> layers = model::load(argv[MODEL_IDX]);
+		const MlpNetwork fp32_network(layers, weight_format::FP32);
+		std::unique_ptr<const MlpNetwork> networks[reduced_formats_count];
+		for (int index = 0; index < reduced_formats_count; index++)
+		{
+			networks[index].reset(
+				new MlpNetwork(layers, reduced_formats[index].format));
+		}
+
+		for (int image_index = IMAGES_START_IDX; image_index < argc;
+			 image_index++)
+		{
+			const Matrix image = map_matrix(argv[image_index], img_dims);
+			const digit fp32_digit = fp32_network(image);
+			std::cout << argv[image_index]
+					  << ": fp32 " << fp32_digit.value
+					  << " (" << fp32_digit.probability << ")";
+
+			for (int index = 0; index < reduced_formats_count; index++)
+			{
+				const digit reduced_digit = (*networks[index])(image);
+				const bool match = (fp32_digit.value == reduced_digit.value);
+				max_differences[index] = std::max(
+					max_differences[index],
+					std::fabs(fp32_digit.probability -
+							  reduced_digit.probability));
+				matches[index] += match ? 1 : 0;
+
+				std::cout << ", " << reduced_formats[index].name << " "
+						  << reduced_digit.value
+						  << " (" << reduced_digit.probability << ")"
+						  << (match ? "" : " MISMATCH");
+			}
+			std::cout << std::endl;
+		}
+	}
+	catch (const std::exception& exception)
+	{
+		std::cerr << exception.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	bool all_match = true;
+	for (int index = 0; index < reduced_formats_count; index++)
+	{
+		std::cout << reduced_formats[index].name
+				  << " top-1 agreement: " << matches[index] << "/" << count
+				  << ", max probability difference: "
+				  << max_differences[index] << std::endl;
+		all_match = all_match && (matches[index] == count);
+	}
+
+	return all_match ? EXIT_SUCCESS : EXIT_FAILURE;
+}
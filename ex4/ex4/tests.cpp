@@ -0,0 +1,2426 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <initializer_list>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Gemm.h"
+#include "Gemv.h"
+#include "HalfMatrix.h"
+#include "ImagePipeline.h"
+#include "InferencePool.h"
+#include "MappedFile.h"
+#include "Dense.h"
+#include "Matrix.h"
+#include "MatrixView.h"
+#include "MlpNetwork.h"
+#include "ModelFile.h"
+#include "QuantizedMatrix.h"
+#include "Reduction.h"
+#include "SparseMatrix.h"
+#include "StaticMatrix.h"
+#include "StaticMlpNetwork.h"
+#include "Trainer.h"
+#include "WorkStealingPool.h"
+
+// Maximal relative error allowed between float computation orders
+constexpr float relative_tolerance = 1e-4F;
+
+// Heap allocations made by the test binary so far, by any thread
+static std::atomic<size_t> allocation_count(0);
+
+/**
+* Allocates for every replaced allocation function, counting the call.
+* Not inlined (nor is release), so the compiler does not pair the
+* inlined operators with malloc and free (-Wmismatched-new-delete).
+* @param size - The number of bytes.
+* @param alignment - The alignment, 0 for the default one.
+* @return The memory, nullptr on failure.
+*/
+__attribute__((noinline)) static void* counted_allocate(size_t size,
+														size_t alignment)
+{
+	allocation_count++;
+	size = (0 == size) ? 1 : size;
+	if (0 == alignment)
+	{
+		return std::malloc(size);
+	}
+
+	void* memory = nullptr;
+	return (0 == posix_memalign(&memory, alignment, size)) ? memory : nullptr;
+}
+
+/**
+* Frees memory of counted_allocate.
+*/
+__attribute__((noinline)) static void release(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+/**
+* Allocates for the throwing allocation functions.
+* @throws std::bad_alloc in case of allocation failure.
+*/
+static void* counted_allocate_or_throw(size_t size, size_t alignment)
+{
+	void* memory = counted_allocate(size, alignment);
+	if (nullptr == memory)
+	{
+		throw std::bad_alloc();
+	}
+
+	return memory;
+}
+
+/**
+* Replaces every global allocation function, counting every call,
+* whether from new, new[] or the standard containers.
+*/
+void* operator new(size_t size)
+{
+	return counted_allocate_or_throw(size, 0);
+}
+
+void* operator new[](size_t size)
+{
+	return counted_allocate_or_throw(size, 0);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return counted_allocate(size, 0);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return counted_allocate(size, 0);
+}
+
+/**
+* Replaces every global deallocation function, matching operator new.
+*/
+void operator delete(void* memory) noexcept
+{
+	release(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	release(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	release(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+	release(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+	release(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+	release(memory);
+}
+
+#if defined(__cpp_aligned_new)
+// Over-aligned types (C++17, or -faligned-new)
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	return counted_allocate_or_throw(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+	return counted_allocate_or_throw(size, static_cast<size_t>(alignment));
+}
+
+void* operator new(size_t size, std::align_val_t alignment,
+				   const std::nothrow_t&) noexcept
+{
+	return counted_allocate(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment,
+					 const std::nothrow_t&) noexcept
+{
+	return counted_allocate(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+	release(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t) noexcept
+{
+	release(memory);
+}
+
+void operator delete(void* memory, size_t, std::align_val_t) noexcept
+{
+	release(memory);
+}
+
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept
+{
+	release(memory);
+}
+
+void operator delete(void* memory, std::align_val_t,
+					 const std::nothrow_t&) noexcept
+{
+	release(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t,
+					   const std::nothrow_t&) noexcept
+{
+	release(memory);
+}
+#endif
+
+/**
+* Fills the matrix with deterministic values in [-1, 1].
+*/
+static void fill_pattern(Matrix& matrix, int seed)
+{
+	for (int index = 0;
+		 index < matrix.get_rows() * matrix.get_cols();
+		 index++)
+	{
+		matrix[index] = std::sin(static_cast<float>(index * 7 + seed));
+	}
+}
+
+/**
+* Builds the layers of a default shaped network (see weights_dims) from
+* fill_pattern values, ReLU activated but the last, Softmax activated.
+* MlpNetwork is neither copied nor moved, so it is built from these.
+* @param seed - The pattern seed of the first layer weights.
+* @param scale - The weights scale, below 1 to keep the softmax finite.
+*/
+static std::vector<model::layer> pattern_network(int seed, float scale)
+{
+	std::vector<model::layer> layers;
+	for (int layer = 0; layer < MLP_SIZE; layer++)
+	{
+		Matrix weights(weights_dims[layer].rows, weights_dims[layer].cols);
+		Matrix bias(bias_dims[layer].rows, bias_dims[layer].cols);
+		fill_pattern(weights, layer + seed);
+		fill_pattern(bias, layer + MLP_SIZE + seed);
+		layers.push_back({scale * weights, bias,
+						  (MLP_SIZE - 1 == layer) ?
+						  activation::softmax : activation::relu});
+	}
+	return layers;
+}
+
+/**
+* Reference i-j-k product over the bounds-checked accessors.
+*/
+static Matrix reference_multiply(const Matrix& lhs, const Matrix& rhs)
+{
+	Matrix mult_matrix(lhs.get_rows(), rhs.get_cols());
+	for (int row = 0; row < lhs.get_rows(); row++)
+	{
+		for (int col = 0; col < rhs.get_cols(); col++)
+		{
+			double mult_sum = 0;
+			for (int index = 0; index < lhs.get_cols(); index++)
+			{
+				mult_sum += lhs(row, index) * rhs(index, col);
+			}
+			mult_matrix(row, col) = static_cast<float>(mult_sum);
+		}
+	}
+
+	return mult_matrix;
+}
+
+/**
+* Checks both matrices have the same dimensions and values,
+* up to relative_tolerance.
+*/
+static bool matrices_close(const Matrix& lhs, const Matrix& rhs)
+{
+	if ((lhs.get_rows() != rhs.get_rows()) ||
+		(lhs.get_cols() != rhs.get_cols()))
+	{
+		return false;
+	}
+
+	for (int index = 0; index < lhs.get_rows() * lhs.get_cols(); index++)
+	{
+		const float scale = std::fmax(1.0F, std::fabs(rhs[index]));
+		if (std::fabs(lhs[index] - rhs[index]) > relative_tolerance * scale)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+* Tests the GEMM-backed product against the reference product,
+* on shapes which are not multiples of the register tile and cross
+* every cache block boundary.
+* @return True on success.
+*/
+static bool test_multiply_matches_reference()
+{
+	const int shapes[][3] = {{1, 1, 1}, {3, 5, 2}, {10, 20, 1},
+							 {128, 784, 1}, {129, 300, 65},
+							 {7, 513, 2050}};
+	for (const auto& shape : shapes)
+	{
+		Matrix lhs(shape[0], shape[1]);
+		Matrix rhs(shape[1], shape[2]);
+		fill_pattern(lhs, 1);
+		fill_pattern(rhs, 2);
+
+		if (!matrices_close(lhs * rhs, reference_multiply(lhs, rhs)))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+* Tests every GEMM micro-kernel the CPU supports against the
+* reference product, on a shape with partial tiles in both
+* dimensions and several depth blocks.
+* @return True on success.
+*/
+static bool test_gemm_kernels_match_reference()
+{
+	constexpr int rows = 2 * gemm::MR + 1;
+	constexpr int cols = 3 * gemm::NR - 5;
+	constexpr int depth = 2 * gemm::KC + 3;
+	Matrix lhs(rows, depth);
+	Matrix rhs(depth, cols);
+	fill_pattern(lhs, 6);
+	fill_pattern(rhs, 7);
+	const Matrix expected = reference_multiply(lhs, rhs);
+
+	for (auto set : {simd::isa::SCALAR, simd::isa::AVX2, simd::isa::AVX512})
+	{
+		if (set > simd::active_isa())
+		{
+			continue;
+		}
+
+		Matrix result(rows, cols);
+		gemm::multiply(set, rows, cols, depth, lhs.data(), depth,
+					   rhs.data(), cols, result.data(), cols);
+		if (!matrices_close(result, expected))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+* Tests products above the parallel threshold give the single-threaded
+* result, including the fused epilogue, with few and many row blocks.
+* @return True on success.
+*/
+static bool test_parallel_gemm_matches_serial()
+{
+	const int shapes[][3] = {{gemm::MC + 7, 2 * gemm::KC + 3, 301},
+							 {2 * gemm::MR + 1, 3 * gemm::KC, 4100},
+							 {1000, 129, 150}};
+	const int previous_threads = gemm::get_thread_count();
+	for (const auto& shape : shapes)
+	{
+		const int rows = shape[0];
+		const int depth = shape[1];
+		const int cols = shape[2];
+		Matrix lhs(rows, depth);
+		Matrix rhs(depth, cols);
+		Matrix bias(rows, 1);
+		fill_pattern(lhs, 6);
+		fill_pattern(rhs, 7);
+		fill_pattern(bias, 8);
+		const epilogue post = {bias.data(), true};
+
+		gemm::set_thread_count(1);
+		Matrix expected(rows, cols);
+		gemm::multiply(rows, cols, depth, lhs.data(), depth, rhs.data(),
+					   cols, expected.data(), cols, post);
+		for (int threads : {2, 3, 8})
+		{
+			gemm::set_thread_count(threads);
+			Matrix result(rows, cols);
+			gemm::multiply(rows, cols, depth, lhs.data(), depth, rhs.data(),
+						   cols, result.data(), cols, post);
+			// Every tile sums in the same order as the single thread
+			for (int index = 0; index < rows * cols; index++)
+			{
+				if (result[index] != expected[index])
+				{
+					gemm::set_thread_count(previous_threads);
+					return false;
+				}
+			}
+		}
+	}
+
+	gemm::set_thread_count(previous_threads);
+	return true;
+}
+
+/**
+* Tests loops started by running tasks, on the same pool or as
+* parallel products, run inline instead of waiting forever.
+* @return True on success.
+*/
+static bool test_nested_loops_run_inline()
+{
+	WorkStealingPool pool(3);
+	std::atomic<int> inner_tasks(0);
+	pool.run(7, [&](int)
+	{
+		pool.run(5, [&](int)
+		{
+			pool.run(2, [&](int) { inner_tasks++; });
+		});
+	});
+	if (7 * 5 * 2 != inner_tasks)
+	{
+		return false;
+	}
+
+	// Products above the parallel threshold, in the tasks of a loop
+	const int previous_threads = gemm::get_thread_count();
+	gemm::set_thread_count(3);
+	const int rows = 2 * gemm::MC;
+	const int depth = gemm::KC;
+	const int cols = 600;
+	Matrix lhs(rows, depth);
+	Matrix rhs(depth, cols);
+	fill_pattern(lhs, 9);
+	fill_pattern(rhs, 10);
+	Matrix expected(rows, cols);
+	gemm::multiply(rows, cols, depth, lhs.data(), depth, rhs.data(), cols,
+				   expected.data(), cols);
+	std::vector<Matrix> results(4, Matrix(rows, cols));
+	pool.run(4, [&](int index)
+	{
+		gemm::multiply(rows, cols, depth, lhs.data(), depth, rhs.data(),
+					   cols, results[index].data(), cols);
+	});
+	gemm::set_thread_count(previous_threads);
+
+	for (const Matrix& result : results)
+	{
+		for (int index = 0; index < rows * cols; index++)
+		{
+			if (result[index] != expected[index])
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+/**
+* Tests every GEMV kernel the CPU supports against the reference
+* product, on row and column counts around the block and lane sizes.
+* @return True on success.
+*/
+static bool test_gemv_kernels_match_reference()
+{
+	const int shapes[][2] = {{1, 1}, {3, 7}, {4, 16}, {5, 33},
+							 {10, 20}, {20, 64}, {128, 784}, {131, 47}};
+	for (const auto& shape : shapes)
+	{
+		Matrix matrix(shape[0], shape[1]);
+		Matrix vector(shape[1], 1);
+		fill_pattern(matrix, 3);
+		fill_pattern(vector, 4);
+		const Matrix expected = reference_multiply(matrix, vector);
+
+		for (auto set : {simd::isa::SCALAR, simd::isa::AVX2,
+						 simd::isa::AVX512})
+		{
+			if (set > simd::active_isa())
+			{
+				continue;
+			}
+
+			Matrix result(shape[0], 1);
+			gemv::multiply(set, shape[0], shape[1],
+						   matrix.data(), shape[1], vector.data(), result.data());
+			if (!matrices_close(result, expected))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+/**
+* Tests every int8 kernel gives the same sums, within the quantization
+* error of the floating-point product.
+* @return True on success.
+*/
+static bool test_int8_kernels_match_reference()
+{
+	const int shapes[][2] = {{1, 1}, {3, 7}, {4, 16}, {5, 33},
+							 {10, 20}, {20, 64}, {128, 784}, {131, 47}};
+	for (const auto& shape : shapes)
+	{
+		Matrix matrix(shape[0], shape[1]);
+		Matrix vector(shape[1], 1);
+		fill_pattern(matrix, 3);
+		fill_pattern(vector, 4);
+		const QuantizedMatrix quantized(matrix);
+		const Matrix expected = reference_multiply(matrix, vector);
+
+		Matrix scalar_result(shape[0], 1);
+		gemv::multiply(simd::isa::SCALAR, quantized, vector.data(),
+					   scalar_result.data());
+
+		// Both operands are off by up to half a step of their scale
+		std::vector<int8_t> unused(quantized.get_stride());
+		const float vector_scale = QuantizedMatrix::quantize_vector(
+			vector.data(), shape[1], 1, unused.data());
+		for (int row = 0; row < shape[0]; row++)
+		{
+			float bound = 0;
+			for (int col = 0; col < shape[1]; col++)
+			{
+				bound += std::fabs(matrix(row, col)) * vector_scale +
+						 std::fabs(vector[col]) * quantized.scales()[row];
+			}
+			if (std::fabs(scalar_result[row] - expected[row]) > bound)
+			{
+				return false;
+			}
+		}
+
+		for (auto set : {simd::isa::AVX2, simd::isa::AVX512})
+		{
+			if ((set > simd::active_isa()) ||
+				((simd::isa::AVX512 == set) && !simd::vnni_supported()))
+			{
+				continue;
+			}
+
+			Matrix result(shape[0], 1);
+			gemv::multiply(set, quantized, vector.data(), result.data());
+			for (int row = 0; row < shape[0]; row++)
+			{
+				if (result[row] != scalar_result[row])
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+/**
+* Tests an INT8 layer computes a batch as its single samples, and
+* classifies them as the FP32 layer does.
+* @return True on success.
+*/
+static bool test_dense_int8_matches_fp32()
+{
+	constexpr int rows = 10;
+	constexpr int cols = 64;
+	constexpr int batch = 5;
+	Matrix weights(rows, cols);
+	Matrix bias(rows, 1);
+	fill_pattern(weights, 8);
+	fill_pattern(bias, 9);
+	// Scaled down so the softmax stays finite
+	const Dense fp32_layer(0.1F * weights, bias, activation::softmax);
+	const Dense int8_layer(0.1F * weights, bias, activation::softmax,
+						   weight_format::INT8);
+	if (weight_format::INT8 != int8_layer.get_weight_format())
+	{
+		return false;
+	}
+
+	Matrix input(cols, batch);
+	fill_pattern(input, 10);
+	const Matrix fp32_output = fp32_layer(input);
+	const Matrix int8_output = int8_layer(input);
+	for (int sample = 0; sample < batch; sample++)
+	{
+		const MatrixView input_column = MatrixView(input).column(sample);
+		const MatrixView int8_column = MatrixView(int8_output).column(sample);
+		const Matrix single = int8_layer(input_column);
+		for (int index = 0; index < rows; index++)
+		{
+			if (single[index] != int8_column(index, 0))
+			{
+				return false;
+			}
+		}
+
+		if (MatrixView(fp32_output).column(sample).argmax() !=
+			int8_column.argmax())
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+* Tests 16-bit conversions round to nearest even, saturate to infinity
+* and widen back exactly.
+* @return True on success.
+*/
+static bool test_half_conversions_round()
+{
+	const struct
+	{
+		float value;
+		half_format format;
+		uint16_t expected;
+	} cases[] = {
+		{1.0F, half_format::FP16, 0x3C00},
+		{-2.0F, half_format::FP16, 0xC000},
+		{65504.0F, half_format::FP16, 0x7BFF},
+		{65520.0F, half_format::FP16, 0x7C00},
+		{std::ldexp(1.0F, -24), half_format::FP16, 0x0001},
+		{std::ldexp(1.0F, -25), half_format::FP16, 0x0000},
+		// Ties round to the even mantissa
+		{1.0F + std::ldexp(1.0F, -11), half_format::FP16, 0x3C00},
+		{1.0F + std::ldexp(3.0F, -11), half_format::FP16, 0x3C02},
+		{1.0F, half_format::BF16, 0x3F80},
+		{1.0F + std::ldexp(1.0F, -8), half_format::BF16, 0x3F80},
+		{1.0F + std::ldexp(3.0F, -8), half_format::BF16, 0x3F82},
+	};
+	for (const auto& test_case : cases)
+	{
+		if (HalfMatrix::narrow(test_case.value, test_case.format) !=
+			test_case.expected)
+		{
+			return false;
+		}
+	}
+
+	// Every finite value survives widening and narrowing back, through
+	// the scalar and the vectorized conversions alike
+	for (auto format : {half_format::FP16, half_format::BF16})
+	{
+		std::vector<uint16_t> values;
+		for (uint32_t bits = 0; bits <= 0xFFFF; bits++)
+		{
+			const auto value = static_cast<uint16_t>(bits);
+			if (std::isfinite(HalfMatrix::widen(value, format)))
+			{
+				values.push_back(value);
+			}
+		}
+
+		std::vector<float> widened(values.size());
+		HalfMatrix::widen(values.data(), static_cast<int>(values.size()),
+						  format, widened.data());
+		for (size_t index = 0; index < values.size(); index++)
+		{
+			if ((widened[index] != HalfMatrix::widen(values[index], format)) ||
+				(HalfMatrix::narrow(widened[index], format) != values[index]))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+/**
+* Tests the 16-bit GEMV kernels and GEMM products match the float
+* product of the widened matrix.
+* @return True on success.
+*/
+static bool test_half_kernels_match_reference()
+{
+	const int shapes[][2] = {{1, 1}, {3, 7}, {5, 33}, {20, 64}, {131, 300}};
+	for (const auto& shape : shapes)
+	{
+		Matrix matrix(shape[0], shape[1]);
+		Matrix input(shape[1], 5);
+		fill_pattern(matrix, 3);
+		fill_pattern(input, 4);
+
+		for (auto format : {half_format::FP16, half_format::BF16})
+		{
+			const HalfMatrix half(matrix, format);
+			const Matrix widened = half.to_matrix();
+			const Matrix vector = MatrixView(input).column(0).to_matrix();
+			const Matrix expected = reference_multiply(widened, vector);
+			for (auto set : {simd::isa::SCALAR, simd::isa::AVX2,
+							 simd::isa::AVX512})
+			{
+				if (set > simd::active_isa())
+				{
+					continue;
+				}
+
+				Matrix result(shape[0], 1);
+				gemv::multiply(set, half, vector.data(), result.data());
+				if (!matrices_close(result, expected))
+				{
+					return false;
+				}
+			}
+
+			Matrix product(shape[0], input.get_cols());
+			gemm::multiply(half, input, product.data(), input.get_cols());
+			if (!matrices_close(product, reference_multiply(widened, input)))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+/**
+* Tests sparse matrices keep exactly the cells above the threshold,
+* and the sparse GEMV kernels, GEMM products and Dense layers match the
+* float product of the pruned matrix.
+* @return True on success.
+*/
+static bool test_sparse_kernels_match_reference()
+{
+	const int shapes[][2] = {{1, 1}, {3, 7}, {5, 33}, {20, 64}, {131, 300}};
+	for (const auto& shape : shapes)
+	{
+		Matrix matrix(shape[0], shape[1]);
+		Matrix bias(shape[0], 1);
+		Matrix input(shape[1], 70);
+		fill_pattern(matrix, 3);
+		fill_pattern(bias, 5);
+		fill_pattern(input, 4);
+
+		// Nothing, about half, and every cell pruned
+		for (float threshold : {0.0F, 0.7F, 2.0F})
+		{
+			const SparseMatrix sparse(matrix, threshold);
+			const Matrix pruned = sparse.to_matrix();
+			int kept = 0;
+			for (int index = 0; index < shape[0] * shape[1]; index++)
+			{
+				const bool keep = std::fabs(matrix[index]) > threshold;
+				kept += keep ? 1 : 0;
+				if (pruned[index] != (keep ? matrix[index] : 0.0F))
+				{
+					return false;
+				}
+			}
+			if (kept != sparse.get_nonzeros())
+			{
+				return false;
+			}
+
+			const Matrix vector = MatrixView(input).column(0).to_matrix();
+			const Matrix expected = reference_multiply(pruned, vector);
+			for (auto set : {simd::isa::SCALAR, simd::isa::AVX2,
+							 simd::isa::AVX512})
+			{
+				if (set > simd::active_isa())
+				{
+					continue;
+				}
+
+				Matrix result(shape[0], 1);
+				gemv::multiply(set, sparse, vector.data(), result.data());
+				Matrix product(shape[0], input.get_cols());
+				gemm::multiply(set, sparse, input, product.data(),
+							   input.get_cols());
+				if (!matrices_close(result, expected) ||
+					!matrices_close(product, reference_multiply(pruned, input)))
+				{
+					return false;
+				}
+			}
+
+			// The fused bias and ReLU, on a sample and a transposed batch
+			const Dense fp32_layer(pruned, bias, activation::relu);
+			const Dense sparse_layer(pruned, bias, activation::relu,
+									 weight_format::SPARSE);
+			const Matrix images = MatrixView(input).transpose().to_matrix();
+			if ((weight_format::SPARSE != sparse_layer.get_weight_format()) ||
+				!matrices_close(sparse_layer.get_weights(), pruned) ||
+				!matrices_close(fp32_layer(vector), sparse_layer(vector)) ||
+				!matrices_close(fp32_layer(input),
+								sparse_layer(MatrixView(images).transpose())))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+/**
+* Tests the sparse input GEMV matches the reference product for
+* vectors from all zeros to dense (past SPARSE_INPUT_DENSITY), and that
+* compaction keeps every non-zero value, NaNs included, in order.
+* @return True on success.
+*/
+static bool test_sparse_input_gemv_matches_dense()
+{
+	const int shapes[][2] = {{1, 1}, {3, 7}, {20, 64}, {67, 33}, {128, 784}};
+	for (const auto& shape : shapes)
+	{
+		Matrix matrix(shape[0], shape[1]);
+		Matrix bias(shape[0], 1);
+		fill_pattern(matrix, 6);
+		fill_pattern(bias, 7);
+		const Matrix columns = MatrixView(matrix).transpose().to_matrix();
+		const epilogue post = {bias.data(), true};
+
+		// Every n'th value kept, n = 0 keeping none
+		for (int every : {0, 9, 3, 2, 1})
+		{
+			Matrix vector(shape[1], 1);
+			fill_pattern(vector, every);
+			for (int index = 0; index < shape[1]; index++)
+			{
+				if ((0 == every) || (0 != (index % every)))
+				{
+					vector[index] = 0.0F;
+				}
+			}
+			Matrix expected = reference_multiply(matrix, vector);
+			for (int row = 0; row < shape[0]; row++)
+			{
+				expected[row] = std::fmax(0.0F, expected[row] + bias[row]);
+			}
+
+			for (auto set : {simd::isa::SCALAR, simd::isa::AVX2,
+							 simd::isa::AVX512})
+			{
+				if (set > simd::active_isa())
+				{
+					continue;
+				}
+
+				Matrix result(shape[0], 1);
+				gemv::multiply_sparse_input(
+					set, shape[0], shape[1], matrix.data(), shape[1],
+					columns.data(), shape[0], vector.data(), result.data(),
+					post);
+				if (!matrices_close(result, expected))
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	const float values[] = {0.0F, 1.0F, 0.0F, -0.0F, std::nanf(""), 0.0F,
+							0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F,
+							0.0F, 0.0F, 0.0F, -2.0F, 0.0F};
+	constexpr int size = sizeof(values) / sizeof(values[0]);
+	for (auto set : {simd::isa::SCALAR, simd::isa::AVX2, simd::isa::AVX512})
+	{
+		if (set > simd::active_isa())
+		{
+			continue;
+		}
+
+		int32_t indices[size + gemv::COMPACT_SLACK];
+		float compacted[size + gemv::COMPACT_SLACK];
+		if ((3 != gemv::compact(set, values, size, indices, compacted)) ||
+			(1 != indices[0]) || (4 != indices[1]) || (17 != indices[2]) ||
+			(1.0F != compacted[0]) || !std::isnan(compacted[1]) ||
+			(-2.0F != compacted[2]))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+* Tests batched classification gives the same digits and
+* probabilities as classifying each image on its own.
+* @return True on success.
+*/
+static bool test_classify_batch_matches_single()
+{
+	const MlpNetwork mlp(pattern_network(0, 1.0F));
+
+	constexpr int batch_size = 9;
+	const int image_size = img_dims.rows * img_dims.cols;
+	Matrix images(batch_size, image_size);
+	fill_pattern(images, 5);
+
+	const auto results = mlp.classify_batch(images.data(), batch_size);
+	if (batch_size != static_cast<int>(results.size()))
+	{
+		return false;
+	}
+
+	for (int image_index = 0; image_index < batch_size; image_index++)
+	{
+		Matrix image(image_size, 1);
+		for (int pixel = 0; pixel < image_size; pixel++)
+		{
+			image[pixel] = images(image_index, pixel);
+		}
+
+		const digit expected = mlp(image);
+		if ((expected.value != results[image_index].value) ||
+			(std::fabs(expected.probability -
+					   results[image_index].probability) >
+			 relative_tolerance))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+* Tests padded images (by value, moved in, or queued on a pool) are
+* classified like their packed copies, padding not read as pixels.
+* @return True on success.
+*/
+static bool test_padded_image_classifies_like_packed()
+{
+	const MlpNetwork mlp(pattern_network(2, 1.0F));
+	InferencePool pool(mlp, 2);
+
+	for (const auto& dims : {img_dims, matrix_dims{img_dims.rows *
+												   img_dims.cols, 1}})
+	{
+		Matrix image(dims.rows, dims.cols);
+		fill_pattern(image, 11);
+		Matrix padded(image, matrix_layout::PADDED);
+		if (padded.is_packed())
+		{
+			return false;
+		}
+
+		const digit expected = mlp(image);
+		const digit results[] = {
+			mlp(Matrix(image, matrix_layout::PADDED)),
+			pool.submit(Matrix(image, matrix_layout::PADDED)).get(),
+			mlp(std::move(padded))};
+		for (const digit& result : results)
+		{
+			if ((expected.value != result.value) ||
+				(expected.probability != result.probability))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+/**
+* Tests the statically shaped products match the reference, and the
+* statically shaped network gives the results of the dynamic one,
+* without allocating.
+* @return True on success.
+*/
+static bool test_static_network_matches_dynamic()
+{
+	Matrix lhs(7, 37);
+	Matrix rhs(37, 5);
+	Matrix vector(37, 1);
+	fill_pattern(lhs, 1);
+	fill_pattern(rhs, 2);
+	fill_pattern(vector, 3);
+	const StaticMatrix<7, 37> static_lhs(lhs);
+	const StaticMatrix<37, 5> static_rhs(rhs);
+	const StaticMatrix<37, 1> static_vector(vector);
+	if (!matrices_close((static_lhs * static_rhs).to_matrix(),
+						reference_multiply(lhs, rhs)) ||
+		!matrices_close((static_lhs * static_vector).to_matrix(),
+						reference_multiply(lhs, vector)) ||
+		!matrices_close((static_lhs + static_lhs).to_matrix(), lhs * 2.0F))
+	{
+		return false;
+	}
+
+	const std::vector<model::layer> layers = pattern_network(5, 0.1F);
+	const MlpNetwork mlp(layers);
+	Matrix weights[MLP_SIZE];
+	Matrix biases[MLP_SIZE];
+	for (int layer = 0; layer < MLP_SIZE; layer++)
+	{
+		weights[layer] = layers[layer].weights;
+		biases[layer] = layers[layer].bias;
+	}
+	const StaticMlpNetwork static_mlp(weights, biases);
+
+	Workspace workspace;
+	for (int index = 0; index < 8; index++)
+	{
+		Matrix image(IMAGE_SIZE, 1);
+		fill_pattern(image, index);
+		const StaticMlpNetwork::Image static_image(image);
+		const digit expected = mlp.forward(image.data(), workspace);
+		const size_t allocations = allocation_count;
+		const digit result = static_mlp(static_image);
+		if ((allocations != allocation_count) ||
+			(expected.value != result.value) ||
+			(std::fabs(expected.probability - result.probability) >
+			 relative_tolerance))
+		{
+			return false;
+		}
+	}
+
+	// Shapes are only checked when converting dynamic matrices
+	weights[1] = Matrix(weights_dims[1].cols, weights_dims[1].rows);
+	try
+	{
+		const StaticMlpNetwork mismatched(weights, biases);
+		return false;
+	}
+	catch (const std::length_error&)
+	{
+	}
+
+	return true;
+}
+
+/**
+* Tests networks of other depths and widths, built from a model
+* description, match the layers applied one by one, plan their
+* workspaces from their own shapes, and reject layers which do not
+* chain.
+* @return True on success.
+*/
+static bool test_configurable_network_depths()
+{
+	const int image_size = img_dims.rows * img_dims.cols;
+	Matrix image(image_size, 1);
+	fill_pattern(image, 4);
+	for (const auto& widths : {std::vector<int>{image_size, 64, 10},
+							   std::vector<int>{image_size, 10},
+							   std::vector<int>{image_size, 200, 32, 16,
+												8, 10}})
+	{
+		std::vector<model::layer> layers;
+		Matrix expected = image;
+		for (size_t layer = 1; layer < widths.size(); layer++)
+		{
+			Matrix weights(widths[layer], widths[layer - 1]);
+			Matrix bias(widths[layer], 1);
+			fill_pattern(weights, static_cast<int>(layer));
+			fill_pattern(bias, static_cast<int>(layer) + 10);
+			// Scaled down so the softmax stays finite
+			weights = 0.1F * weights;
+			const bool last_layer = (widths.size() - 1 == layer);
+			layers.push_back({weights, bias, last_layer ?
+							  activation::softmax : activation::relu});
+			const Matrix output = weights * expected + bias;
+			expected = last_layer ? activation::softmax(output) :
+									activation::relu(output);
+		}
+
+		const MlpNetwork mlp(layers);
+		Workspace workspace(mlp);
+		const size_t allocations = allocation_count;
+		const digit result = mlp.forward(image.data(), workspace);
+		const int expected_value = expected.argmax();
+		if ((allocations != allocation_count) ||
+			(static_cast<int>(layers.size()) != mlp.get_layer_count()) ||
+			(widths.back() != mlp.get_output_size()) ||
+			(expected_value != static_cast<int>(result.value)) ||
+			(std::fabs(expected[expected_value] - result.probability) >
+			 relative_tolerance))
+		{
+			return false;
+		}
+	}
+
+	std::vector<model::layer> mismatched = {
+		{Matrix(64, image_size), Matrix(64, 1), activation::relu},
+		{Matrix(10, 32), Matrix(10, 1), activation::softmax}
+	};
+	try
+	{
+		const MlpNetwork mlp(mismatched);
+		return false;
+	}
+	catch (const std::length_error&)
+	{
+	}
+
+	return true;
+}
+
+/**
+* Tests concurrent classification, from plain threads sharing the
+* network and through an inference pool, gives the serial results,
+* with the pool results in input order.
+* @return True on success.
+*/
+static bool test_concurrent_inference_matches_serial()
+{
+	const MlpNetwork mlp(pattern_network(0, 0.1F));
+
+	constexpr int image_count = 48;
+	constexpr int thread_count = 4;
+	const int image_size = img_dims.rows * img_dims.cols;
+	std::vector<Matrix> images;
+	std::vector<digit> expected;
+	Workspace workspace;
+	for (int index = 0; index < image_count; index++)
+	{
+		Matrix image(image_size, 1);
+		fill_pattern(image, index);
+		expected.push_back(mlp.forward(image.data(), workspace));
+		images.push_back(image);
+	}
+
+	std::vector<std::vector<digit>> thread_results(thread_count);
+	std::vector<std::thread> threads;
+	for (int thread = 0; thread < thread_count; thread++)
+	{
+		threads.emplace_back([&, thread]()
+		{
+			for (const auto& image : images)
+			{
+				thread_results[thread].push_back(mlp(MatrixView(image)));
+			}
+		});
+	}
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	InferencePool pool(mlp, thread_count);
+	thread_results.push_back(pool.classify(images));
+	for (const auto& results : thread_results)
+	{
+		for (int index = 0; index < image_count; index++)
+		{
+			if ((expected[index].value != results[index].value) ||
+				(expected[index].probability != results[index].probability))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+/**
+* Tests that steady-state inference through a workspace does not
+* allocate, for single images and for batches, and that the
+* workspace results match the allocating API.
+* @return True on success.
+*/
+static bool test_forward_does_not_allocate()
+{
+	const MlpNetwork mlp(pattern_network(1, 1.0F));
+
+	constexpr int batch_size = 16;
+	const int image_size = img_dims.rows * img_dims.cols;
+	Matrix images(image_size, batch_size);
+	fill_pattern(images, 6);
+	Matrix image(image_size, 1);
+	fill_pattern(image, 7);
+
+	Workspace workspace(batch_size);
+	digit results[batch_size];
+	const digit expected = mlp(image);
+	const auto expected_batch = mlp.classify_batch(images);
+
+	// Warm-up, the product kernels size their packing buffers
+	(void)mlp.forward(image.data(), workspace);
+	mlp.forward(images.data(), batch_size, workspace, results);
+
+	const size_t allocations_before = allocation_count;
+	digit single = {0, 0.0F};
+	for (int iteration = 0; iteration < 10; iteration++)
+	{
+		single = mlp.forward(image.data(), workspace);
+		mlp.forward(images.data(), batch_size, workspace, results);
+	}
+	if (allocation_count != allocations_before)
+	{
+		return false;
+	}
+
+	if ((expected.value != single.value) ||
+		(expected.probability != single.probability))
+	{
+		return false;
+	}
+	for (int image_index = 0; image_index < batch_size; image_index++)
+	{
+		if ((expected_batch[image_index].value !=
+			 results[image_index].value) ||
+			(expected_batch[image_index].probability !=
+			 results[image_index].probability))
+		{
+			return false;
+		}
+	}
+
+	try
+	{
+		mlp.forward(images.data(), batch_size + 1, workspace, results);
+	}
+	catch (const std::length_error&)
+	{
+		return true;
+	}
+
+	return false;
+}
+
+/**
+* Activation outside of the activation namespace, exercising the
+* Dense path for activations which cannot be fused.
+*/
+static Matrix halve(const Matrix& input)
+{
+	return input * 0.5F;
+}
+
+/**
+* Tests the fused Dense kernel against the unfused computation,
+* activation((weights * input) + bias) for every sample, with every
+* activation kind, for a single sample and for a batch.
+* @return True on success.
+*/
+static bool test_dense_forward_matches_unfused()
+{
+	constexpr int rows = 13;
+	constexpr int cols = 37;
+	Matrix weights(rows, cols);
+	Matrix bias(rows, 1);
+	fill_pattern(weights, 8);
+	fill_pattern(bias, 9);
+
+	for (auto activation_func : {activation::relu, activation::softmax,
+								 activation::log_softmax, halve})
+	{
+		const Dense layer(weights, bias, activation_func);
+		for (int batch : {1, 5, 21})
+		{
+			Matrix input(cols, batch);
+			fill_pattern(input, batch);
+			Matrix output(rows, batch);
+			layer.forward(input.data(), output.data(), batch);
+
+			for (int sample = 0; sample < batch; sample++)
+			{
+				Matrix sample_input(cols, 1);
+				for (int index = 0; index < cols; index++)
+				{
+					sample_input[index] = input(index, sample);
+				}
+
+				const Matrix expected = activation_func(
+					reference_multiply(weights, sample_input) + bias);
+				for (int index = 0; index < rows; index++)
+				{
+					if (std::fabs(output(index, sample) - expected[index]) >
+						relative_tolerance)
+					{
+						return false;
+					}
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+/**
+* Tests the exponential approximation stays within its documented
+* error on every kernel, and the Softmax filters match a double
+* precision reference, including for logits which overflow a plain
+* exponential.
+* @return True on success.
+*/
+static bool test_softmax_stable_and_accurate()
+{
+	std::vector<float> arguments;
+	for (float argument = -87.0F; argument <= 88.0F; argument += 0.0137F)
+	{
+		arguments.push_back(argument);
+	}
+	std::vector<float> exponentials(arguments.size());
+	for (auto set : {simd::isa::SCALAR, simd::isa::AVX2, simd::isa::AVX512})
+	{
+		if (set > simd::active_isa())
+		{
+			continue;
+		}
+
+		activation::exp_approx(set, arguments.data(),
+							   static_cast<int>(arguments.size()),
+							   exponentials.data());
+		for (size_t index = 0; index < arguments.size(); index++)
+		{
+			const double exact = std::exp(static_cast<double>(arguments[index]));
+			if (std::fabs(exponentials[index] - exact) >
+				activation::EXP_MAX_RELATIVE_ERROR * exact)
+			{
+				return false;
+			}
+		}
+	}
+
+	// Samples in columns, with logits far beyond the float exponent range
+	constexpr int rows = 37;
+	for (int cols : {1, 3, 19})
+	{
+		Matrix logits(rows, cols);
+		fill_pattern(logits, cols);
+		logits = 500.0F * logits;
+		Matrix probabilities(logits);
+		Matrix log_probabilities(logits);
+		activation::softmax_columns(probabilities.data(), rows, cols);
+		activation::log_softmax_columns(log_probabilities.data(), rows, cols);
+
+		for (int column = 0; column < cols; column++)
+		{
+			double maximum = logits(0, column);
+			for (int row = 1; row < rows; row++)
+			{
+				maximum = std::fmax(maximum, logits(row, column));
+			}
+			double sum = 0;
+			for (int row = 0; row < rows; row++)
+			{
+				sum += std::exp(logits(row, column) - maximum);
+			}
+
+			for (int row = 0; row < rows; row++)
+			{
+				const double log_expected =
+					logits(row, column) - maximum - std::log(sum);
+				if ((std::fabs(probabilities(row, column) -
+							   std::exp(log_expected)) > relative_tolerance) ||
+					(std::fabs(log_probabilities(row, column) -
+							   log_expected) >
+					 relative_tolerance * std::fmax(1.0, -log_expected)))
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+/**
+* Tests the reductions on every kernel against double precision
+* references, the sum of many small values keeping its precision,
+* and argmax returning the first maximum and skipping NaN values.
+* @return True on success.
+*/
+static bool test_reductions_match_reference()
+{
+	for (auto set : {simd::isa::SCALAR, simd::isa::AVX2, simd::isa::AVX512})
+	{
+		if (set > simd::active_isa())
+		{
+			continue;
+		}
+
+		for (int count : {1, 7, 100, 1000, 100003})
+		{
+			Matrix values(count, 1);
+			fill_pattern(values, count);
+			double sum = 0;
+			double quadratic_sum = 0;
+			for (int index = 0; index < count; index++)
+			{
+				sum += values[index];
+				quadratic_sum += values[index] * values[index];
+			}
+			if ((std::fabs(reduction::sum(set, values.data(), count) - sum) >
+				 relative_tolerance * std::fmax(1.0, std::fabs(sum))) ||
+				(std::fabs(reduction::sum_of_squares(set, values.data(),
+													 count) -
+						   quadratic_sum) >
+				 relative_tolerance * std::fmax(1.0, quadratic_sum)))
+			{
+				return false;
+			}
+
+			// The maximum twice, and a NaN before it
+			values[count - 1] = 2.0F;
+			values[count / 2] = 2.0F;
+			if (3 <= count)
+			{
+				values[count / 3] = std::nanf("");
+			}
+			const reduction::indexed_max maximum =
+				reduction::argmax(set, values.data(), count);
+			if (((count / 2) != maximum.index) || (2.0F != maximum.value))
+			{
+				return false;
+			}
+		}
+
+		// A serial float sum drifts by several percent over these values
+		const std::vector<float> small(1 << 24, 0.1F);
+		const double expected = (1 << 24) * static_cast<double>(0.1F);
+		if (std::fabs(reduction::sum(set, small.data(),
+									 static_cast<int>(small.size())) -
+					  expected) > relative_tolerance * expected)
+		{
+			return false;
+		}
+	}
+
+	Matrix matrix(31, 17);
+	fill_pattern(matrix, 3);
+	const MatrixView transposed = MatrixView(matrix).transpose();
+	return (std::fabs(matrix.sum() - transposed.sum()) < relative_tolerance) &&
+		   (std::fabs(matrix.norm() - transposed.norm()) < relative_tolerance) &&
+		   (matrix.argmax() == matrix.max_with_index().index) &&
+		   (matrix[matrix.argmax()] == matrix.max_with_index().value);
+}
+
+/**
+* Tests the per-layer counters count every call, sample and FLOP of a
+* forward pass, from several threads, or stay at 0 when compiled out.
+* @return True on success.
+*/
+static bool test_instrumentation_counts_layers()
+{
+	const int image_size = img_dims.rows * img_dims.cols;
+	const std::vector<int> widths = {image_size, 32, 10};
+	std::vector<model::layer> layers;
+	for (size_t layer = 1; layer < widths.size(); layer++)
+	{
+		Matrix weights(widths[layer], widths[layer - 1]);
+		Matrix bias(widths[layer], 1);
+		fill_pattern(weights, static_cast<int>(layer));
+		fill_pattern(bias, static_cast<int>(layer) + 10);
+		layers.push_back({0.1F * weights, bias,
+						  (widths.size() - 1 == layer) ?
+						  activation::softmax : activation::relu});
+	}
+	const MlpNetwork mlp(layers);
+
+	constexpr int threads = 3;
+	constexpr int batch = 5;
+	Matrix images(image_size, batch);
+	fill_pattern(images, 6);
+	std::vector<std::thread> workers;
+	for (int thread = 0; thread < threads; thread++)
+	{
+		workers.emplace_back([&]()
+		{
+			Workspace workspace(mlp, batch);
+			std::vector<digit> results(batch);
+			(void)mlp.forward(images.data(), workspace);
+			mlp.forward(images.data(), batch, workspace, results.data());
+		});
+	}
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+
+	const instrumentation::snapshot counted = mlp.get_instrumentation();
+	if ((instrumentation::ENABLED != counted.enabled) ||
+		(layers.size() != counted.layers.size()))
+	{
+		return false;
+	}
+
+	uint64_t flops = 0;
+	for (size_t layer = 0; layer < layers.size(); layer++)
+	{
+		const instrumentation::layer_counters& counters =
+			counted.layers[layer];
+		const uint64_t rows = static_cast<uint64_t>(widths[layer + 1]);
+		const uint64_t cols = static_cast<uint64_t>(widths[layer]);
+		const uint64_t samples = instrumentation::ENABLED ?
+								 threads * (1 + batch) : 0;
+		const uint64_t expected_flops =
+			samples * rows * ((2 * cols) + ((0 == layer) ? 2 : 1));
+		flops += expected_flops;
+		const uint64_t product_nanoseconds = counters.nanoseconds[
+			static_cast<int>(instrumentation::step::PRODUCT)];
+		if ((counters.calls != (instrumentation::ENABLED ? 2 * threads : 0)) ||
+			(samples != counters.samples) ||
+			(expected_flops != counters.flops) ||
+			(instrumentation::ENABLED != (0 < counters.bytes)) ||
+			(instrumentation::ENABLED != (0 < product_nanoseconds)))
+		{
+			return false;
+		}
+	}
+
+	mlp.reset_instrumentation();
+	return (flops == counted.total.flops) &&
+		   (0 == mlp.get_instrumentation().total.calls);
+}
+
+/**
+ * @class InteractiveBuffer
+ * @brief Stream buffer of paths typed one at a time: like a terminal,
+ *		  it blocks before every path but the first until the previous
+ *		  one was answered (or a timeout passed).
+ */
+class InteractiveBuffer : public std::streambuf
+{
+public:
+	explicit InteractiveBuffer(std::vector<std::string> lines) :
+		_lines(std::move(lines)), _next(0), _answered(0), _timed_out(false)
+	{}
+
+	/**
+	* Marks the last typed path as answered, typing the next one.
+	*/
+	void answer()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_answered++;
+		}
+		_answer.notify_all();
+	}
+
+	/**
+	* Checking whether a path was typed before the previous one was
+	* answered, after waiting for it.
+	*/
+	bool timed_out() const
+	{
+		return _timed_out;
+	}
+
+protected:
+	int_type underflow() override
+	{
+		if (_next == _lines.size())
+		{
+			return traits_type::eof();
+		}
+
+		std::unique_lock<std::mutex> lock(_mutex);
+		if (!_answer.wait_for(lock, std::chrono::seconds(2), [this]()
+							  {
+								  return _answered >= _next;
+							  }))
+		{
+			_timed_out = true;
+		}
+		_line = _lines[_next++] + "\n";
+		setg(&_line[0], &_line[0], &_line[0] + _line.size());
+		return traits_type::to_int_type(_line[0]);
+	}
+
+private:
+	std::vector<std::string> _lines;
+	size_t _next;
+	size_t _answered;
+	bool _timed_out;
+	std::string _line;
+	std::mutex _mutex;
+	std::condition_variable _answer;
+};
+
+/**
+* Tests the image pipeline delivers every image of a manifest in
+* order, with the results of single image inference, across several
+* laps of a small ring, and stops at an unreadable image once every
+* previous image is delivered.
+* @return True on success.
+*/
+static bool test_pipeline_matches_network()
+{
+	const MlpNetwork mlp(pattern_network(0, 0.1F));
+
+	constexpr int image_count = 29;
+	const int image_size = img_dims.rows * img_dims.cols;
+	std::vector<std::string> paths;
+	std::vector<digit> expected;
+	Workspace workspace;
+	std::ostringstream manifest;
+	for (int index = 0; index < image_count; index++)
+	{
+		Matrix image(image_size, 1);
+		fill_pattern(image, index);
+		expected.push_back(mlp.forward(image.data(), workspace));
+		paths.push_back("tests_pipeline_" + std::to_string(index) + ".bin");
+		std::ofstream file(paths.back(), std::ios::binary);
+		file.write(reinterpret_cast<const char*>(image.data()),
+				   static_cast<std::streamsize>(sizeof(float) * image_size));
+		manifest << paths.back() << "\n";
+	}
+
+	ImagePipeline pipeline(mlp, 4, 3);
+	int delivered = 0;
+	bool matching = true;
+	const auto check = [&](const std::string& path, const float* image,
+						   const digit& result)
+	{
+		Matrix expected_image(image_size, 1);
+		fill_pattern(expected_image, delivered);
+		matching = matching && (paths[delivered] == path) &&
+				   (expected_image[image_size - 1] == image[image_size - 1]) &&
+				   (expected[delivered].value == result.value) &&
+				   (std::fabs(expected[delivered].probability -
+							  result.probability) < relative_tolerance);
+		delivered++;
+	};
+
+	std::istringstream all_paths(manifest.str());
+	matching = matching && (image_count == pipeline.run(all_paths, check)) &&
+			   (image_count == delivered);
+
+	// The pipeline is reusable, and stops at the missing image
+	constexpr int missing = 11;
+	std::remove(paths[missing].c_str());
+	delivered = 0;
+	std::istringstream broken_paths(manifest.str());
+	try
+	{
+		(void)pipeline.run(broken_paths, check);
+		matching = false;
+	}
+	catch (const std::invalid_argument&)
+	{
+		matching = matching && (missing == delivered);
+	}
+
+	// Every typed path is answered before the next one is typed
+	InteractiveBuffer typed({paths[0], paths[1], paths[2]});
+	std::istream typed_paths(&typed);
+	delivered = 0;
+	const auto answer = [&](const std::string& path, const float* image,
+							const digit& result)
+	{
+		check(path, image, result);
+		typed.answer();
+	};
+	matching = matching && (3 == pipeline.run(typed_paths, answer)) &&
+			   !typed.timed_out();
+
+	for (const auto& path : paths)
+	{
+		std::remove(path.c_str());
+	}
+
+	return matching;
+}
+
+/**
+* Reference mean cross-entropy of a network over one image per row,
+* through the bounds-checked accessors.
+*/
+static double reference_loss(const std::vector<model::layer>& layers,
+							 const Matrix& images,
+							 const std::vector<unsigned int>& labels)
+{
+	double loss = 0;
+	for (int sample = 0; sample < images.get_rows(); sample++)
+	{
+		Matrix output(images.get_cols(), 1);
+		for (int feature = 0; feature < images.get_cols(); feature++)
+		{
+			output[feature] = images(sample, feature);
+		}
+		for (const model::layer& layer : layers)
+		{
+			Matrix input = reference_multiply(layer.weights, output);
+			for (int row = 0; row < input.get_rows(); row++)
+			{
+				input[row] += layer.bias[row];
+			}
+			output = layer.activation(input);
+		}
+		loss -= std::log(static_cast<double>(output[labels[sample]]));
+	}
+
+	return loss / images.get_rows();
+}
+
+/**
+* Tests training: the gradients match finite differences of the loss,
+* both optimizers learn a separable problem, and the trained layers
+* do not depend on the thread count.
+* @return True on success.
+*/
+static bool test_trainer_learns_and_is_deterministic()
+{
+	// A single plain SGD step over the whole set moves every weight by
+	// the learning rate times its gradient
+	{
+		const std::vector<unsigned int> labels = {0, 1, 2, 1, 0, 2, 2, 1};
+		Matrix images(static_cast<int>(labels.size()), 5);
+		fill_pattern(images, 3);
+		const std::vector<model::layer> layers =
+			Trainer::initial_layers({5, 4, 3, 3}, 7);
+		const float rate = 1e-2F;
+		Trainer trainer(layers, {optimizer_kind::SGD, rate, 0.0F, 8, 1, 1});
+		trainer.train_epoch(images, labels);
+		for (size_t index = 0; index < layers.size(); index++)
+		{
+			const Matrix& before = layers[index].weights;
+			const Matrix& after = trainer.get_layers()[index].weights;
+			for (int cell = 0; cell < before.get_rows() * before.get_cols();
+				 cell++)
+			{
+				const float step = 1e-3F;
+				std::vector<model::layer> moved = layers;
+				moved[index].weights[cell] = before[cell] + step;
+				const double higher = reference_loss(moved, images, labels);
+				moved[index].weights[cell] = before[cell] - step;
+				const double lower = reference_loss(moved, images, labels);
+				const double expected = (higher - lower) / (2 * step);
+				const double gradient = (before[cell] - after[cell]) / rate;
+				if (std::fabs(gradient - expected) >
+					1e-3 + (1e-2 * std::fabs(expected)))
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	// Three classes, each raising its own features over a pattern
+	const int samples = 240;
+	Matrix images(samples, 12);
+	std::vector<unsigned int> labels(samples);
+	fill_pattern(images, 5);
+	for (int sample = 0; sample < samples; sample++)
+	{
+		labels[sample] = static_cast<unsigned int>(sample % 3);
+		for (int feature = 0; feature < 4; feature++)
+		{
+			images(sample, (4 * labels[sample]) + feature) += 1.5F;
+		}
+	}
+
+	const std::vector<model::layer> layers =
+		Trainer::initial_layers({12, 16, 8, 3}, 11);
+	std::vector<std::vector<model::layer>> trained;
+	for (const training_options& options :
+		 {training_options{optimizer_kind::ADAM, 1e-2F, 0.9F, 50, 1, 3},
+		  training_options{optimizer_kind::ADAM, 1e-2F, 0.9F, 50, 3, 3},
+		  training_options{optimizer_kind::SGD, 5e-2F, 0.9F, 50, 2, 3}})
+	{
+		Trainer trainer(layers, options);
+		const epoch_result first = trainer.train_epoch(images, labels);
+		epoch_result last = first;
+		for (int epoch = 1; epoch < 15; epoch++)
+		{
+			last = trainer.train_epoch(images, labels);
+		}
+		if ((samples != last.samples) || !(last.loss < 0.5F * first.loss) ||
+			!(0.95F < last.accuracy))
+		{
+			return false;
+		}
+
+		const MlpNetwork network(trainer.get_layers());
+		int correct = 0;
+		for (int sample = 0; sample < samples; sample++)
+		{
+			Matrix image(12, 1);
+			for (int feature = 0; feature < 12; feature++)
+			{
+				image[feature] = images(sample, feature);
+			}
+			correct += (labels[sample] == network(image).value) ? 1 : 0;
+		}
+		if (0.95F * samples > correct)
+		{
+			return false;
+		}
+		trained.push_back(trainer.get_layers());
+	}
+
+	// The shards, and their sum order, do not depend on the threads
+	for (size_t index = 0; index < layers.size(); index++)
+	{
+		const Matrix& serial = trained[0][index].weights;
+		const Matrix& parallel = trained[1][index].weights;
+		for (int cell = 0; cell < serial.get_rows() * serial.get_cols(); cell++)
+		{
+			if (serial[cell] != parallel[cell])
+			{
+				return false;
+			}
+		}
+	}
+
+	bool passed = true;
+	std::vector<model::layer> relu_output = layers;
+	relu_output.back().activation = activation::relu;
+	try
+	{
+		Trainer trainer(relu_output);
+		passed = false;
+	}
+	catch (const std::invalid_argument&)
+	{
+	}
+	try
+	{
+		Trainer trainer(layers, {optimizer_kind::ADAM, 1e-3F, 0.9F, 0, 1, 1});
+		passed = false;
+	}
+	catch (const std::invalid_argument&)
+	{
+	}
+	try
+	{
+		Trainer trainer(layers);
+		labels.back() = 3;
+		trainer.train_epoch(images, labels);
+		passed = false;
+	}
+	catch (const std::invalid_argument&)
+	{
+	}
+
+	return passed;
+}
+
+/**
+* Tests the product still rejects incompatible dimensions.
+* @return True on success.
+*/
+static bool test_multiply_incompatible_dimensions()
+{
+	try
+	{
+		(void)(Matrix(2, 3) * Matrix(2, 3));
+	}
+	catch (const std::length_error&)
+	{
+		return true;
+	}
+
+	return false;
+}
+
+/**
+* Tests element-wise expressions against element-by-element results,
+* including expressions assigned into one of their own operands.
+* @return True on success.
+*/
+static bool test_expressions_match_elementwise()
+{
+	Matrix lhs(7, 5);
+	Matrix rhs(7, 5);
+	fill_pattern(lhs, 11);
+	fill_pattern(rhs, 12);
+
+	const Matrix sum = (2.0F * lhs) + rhs + (lhs * 0.5F);
+	Matrix accumulated(lhs);
+	accumulated += 3.0F * rhs;
+	Matrix aliased(lhs);
+	aliased = aliased + (aliased * -2.0F);
+	Matrix resized;
+	resized = lhs + rhs;
+
+	for (int index = 0; index < 7 * 5; index++)
+	{
+		const float expected_sum = (2.0F * lhs[index]) + rhs[index] +
+								   (lhs[index] * 0.5F);
+		const float expected_accumulated = lhs[index] + (3.0F * rhs[index]);
+		if ((std::abs(sum[index] - expected_sum) > 1e-5F) ||
+			(std::abs(accumulated[index] - expected_accumulated) > 1e-5F) ||
+			(std::abs(aliased[index] + lhs[index]) > 1e-5F) ||
+			(std::abs(resized[index] - (lhs[index] + rhs[index])) > 1e-5F))
+		{
+			return false;
+		}
+	}
+
+	try
+	{
+		const Matrix invalid = lhs + Matrix(5, 7);
+	}
+	catch (const std::length_error&)
+	{
+		return true;
+	}
+
+	return false;
+}
+
+/**
+* Tests expressions read like the matrix they evaluate to: cells,
+* dimensions, reductions and printing, kept in a variable or not.
+* @return True on success.
+*/
+static bool test_expressions_read_like_matrices()
+{
+	Matrix lhs(4, 6);
+	Matrix rhs(4, 6);
+	fill_pattern(lhs, 13);
+	fill_pattern(rhs, 14);
+	const Matrix expected = (2.0F * lhs) + rhs;
+
+	auto kept = (2.0F * lhs) + rhs;
+	if ((4 != kept.get_rows()) || (6 != kept.get_cols()) ||
+		(expected(2, 3) != kept(2, 3)) || (expected[17] != kept[17]) ||
+		(expected.norm() != ((2.0F * lhs) + rhs).norm()) ||
+		(expected.sum() != (rhs + (lhs * 2.0F)).sum()) ||
+		(expected.argmax() != kept.argmax()))
+	{
+		return false;
+	}
+
+	std::stringstream printed;
+	std::stringstream expected_printed;
+	std::streambuf* const output = std::cout.rdbuf(printed.rdbuf());
+	(lhs + rhs).plain_print();
+	std::cout.rdbuf(expected_printed.rdbuf());
+	Matrix(lhs + rhs).plain_print();
+	std::cout.rdbuf(output);
+	if (printed.str() != expected_printed.str())
+	{
+		return false;
+	}
+
+	try
+	{
+		(void)kept(4, 0);
+		return false;
+	}
+	catch (const std::out_of_range&)
+	{
+	}
+
+	// The kept expression reads its operands when read
+	lhs[17] += 1.0F;
+	return std::fabs(kept[17] - (expected[17] + 2.0F)) < 1e-5F;
+}
+
+/**
+* Tests moves take over the storage and leave the source empty,
+* and that sums with a temporary reuse its storage.
+* @return True on success.
+*/
+static bool test_move_takes_storage()
+{
+	Matrix source(3, 4);
+	fill_pattern(source, 13);
+	const float* storage = source.data();
+
+	Matrix moved(std::move(source));
+	if ((moved.data() != storage) || (nullptr != source.data()) ||
+		(0 != source.get_rows()) || (0 != source.get_cols()))
+	{
+		return false;
+	}
+
+	Matrix assigned;
+	assigned = std::move(moved);
+	if ((assigned.data() != storage) || (nullptr != moved.data()))
+	{
+		return false;
+	}
+
+	// The moved-from matrix may be assigned to again
+	moved = assigned;
+	const Matrix sum = std::move(assigned) + moved;
+	return (sum.data() == storage) && (sum[0] == 2.0F * moved[0]);
+}
+
+/**
+* Tests view addressing: submatrices, rows, columns and transposes
+* read the same elements as the viewed matrix, and reductions and
+* activations over views match those over copies.
+* @return True on success.
+*/
+static bool test_views_address_elements()
+{
+	Matrix matrix(6, 9);
+	fill_pattern(matrix, 14);
+	const MatrixView block = MatrixView(matrix).submatrix(1, 2, 4, 5);
+	const MatrixView transposed = block.transpose();
+
+	for (int row = 0; row < 4; row++)
+	{
+		for (int col = 0; col < 5; col++)
+		{
+			if ((block(row, col) != matrix(row + 1, col + 2)) ||
+				(transposed(col, row) != block(row, col)) ||
+				(block.row(row)(0, col) != block(row, col)) ||
+				(transposed.column(row)(col, 0) != block(row, col)))
+			{
+				return false;
+			}
+		}
+	}
+
+	const Matrix copy = transposed.to_matrix();
+	if ((std::fabs(copy.sum() - transposed.sum()) > relative_tolerance) ||
+		(std::fabs(copy.norm() - transposed.norm()) > relative_tolerance) ||
+		(copy.argmax() != transposed.argmax()) ||
+		!matrices_close(activation::apply_columns(activation::relu, transposed),
+						activation::relu(copy)) ||
+		!MatrixView(matrix).row(2).is_contiguous() ||
+		block.is_contiguous())
+	{
+		return false;
+	}
+
+	try
+	{
+		(void)block.submatrix(2, 0, 3, 1);
+	}
+	catch (const std::out_of_range&)
+	{
+		return true;
+	}
+
+	return false;
+}
+
+/**
+* Tests products over strided and transposed views against the
+* reference product of copies, and inference over slices of one
+* image buffer against inference over copied images.
+* @return True on success.
+*/
+static bool test_view_products_match_reference()
+{
+	const int shapes[][3] = {{3, 5, 2}, {20, 64, 1}, {129, 300, 65}};
+	for (const auto& shape : shapes)
+	{
+		const int rows = shape[0];
+		const int depth = shape[1];
+		const int cols = shape[2];
+		// Stored transposed, inside larger buffers
+		Matrix lhs_storage(depth + 2, rows + 3);
+		Matrix rhs_storage(cols + 1, depth + 4);
+		fill_pattern(lhs_storage, rows);
+		fill_pattern(rhs_storage, cols);
+
+		const MatrixView lhs = MatrixView(lhs_storage)
+			.submatrix(1, 2, depth, rows).transpose();
+		const MatrixView rhs = MatrixView(rhs_storage)
+			.submatrix(1, 3, cols, depth).transpose();
+		const Matrix expected =
+			reference_multiply(lhs.to_matrix(), rhs.to_matrix());
+		if (!matrices_close(lhs * rhs, expected) ||
+			!matrices_close(lhs.to_matrix() * rhs, expected) ||
+			!matrices_close(lhs * rhs.to_matrix(), expected))
+		{
+			return false;
+		}
+	}
+
+	const MlpNetwork mlp(pattern_network(2, 1.0F));
+
+	// One image per row, and one image per column
+	constexpr int batch_size = 5;
+	const int image_size = img_dims.rows * img_dims.cols;
+	Matrix rows_buffer(batch_size, image_size);
+	fill_pattern(rows_buffer, 8);
+	const Matrix columns_buffer = MatrixView(rows_buffer).transpose()
+		.to_matrix();
+	const auto batch = mlp.classify_batch(MatrixView(rows_buffer).transpose());
+
+	for (int image_index = 0; image_index < batch_size; image_index++)
+	{
+		const digit expected =
+			mlp(MatrixView(rows_buffer).row(image_index).to_matrix());
+		const digit from_row = mlp(MatrixView(rows_buffer).row(image_index));
+		const digit from_column =
+			mlp(MatrixView(columns_buffer).column(image_index));
+		for (const digit& result : {from_row, from_column,
+									batch[image_index]})
+		{
+			if ((expected.value != result.value) ||
+				(std::fabs(expected.probability - result.probability) >
+				 relative_tolerance))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+/**
+* Tests the in-place transpose against element-by-element results,
+* on vectors, square matrices across the recursion leaves, and
+* non-square matrices (cycle following).
+* @return True on success.
+*/
+static bool test_transpose_matches_elements()
+{
+	const int shapes[][2] = {{1, 7}, {7, 1}, {5, 5}, {33, 33},
+							 {2, 3}, {17, 40}, {100, 37}};
+	for (const auto& shape : shapes)
+	{
+		Matrix original(shape[0], shape[1]);
+		fill_pattern(original, shape[0] + shape[1]);
+		Matrix transposed(original);
+		transposed.transpose();
+
+		if ((transposed.get_rows() != shape[1]) ||
+			(transposed.get_cols() != shape[0]) ||
+			!matrices_close(MatrixView(original).transpose().to_matrix(),
+							transposed))
+		{
+			return false;
+		}
+
+		for (int row = 0; row < shape[0]; row++)
+		{
+			for (int col = 0; col < shape[1]; col++)
+			{
+				if (transposed(col, row) != original(row, col))
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+/**
+* Tests padded storage: rows start cache line aligned, every operation
+* matches the same operation over packed storage, and copies are packed.
+* @return True on success.
+*/
+static bool test_padded_matrix_matches_packed()
+{
+	Matrix packed(10, 20);
+	fill_pattern(packed, 15);
+	Matrix padded(packed, matrix_layout::PADDED);
+	if ((32 != padded.get_stride()) || padded.is_packed() ||
+		!packed.is_packed() || (20 != packed.get_stride()) ||
+		(0 != (reinterpret_cast<uintptr_t>(packed.data()) %
+			   Matrix::ALIGNMENT)) ||
+		(0 != (reinterpret_cast<uintptr_t>(padded.data() +
+										   padded.get_stride()) %
+			   Matrix::ALIGNMENT)) ||
+		!matrices_close(packed, padded) || (packed(3, 17) != padded(3, 17)))
+	{
+		return false;
+	}
+
+	// Element-wise operations and reductions
+	const Matrix other = 2.0F * packed;
+	padded += other;
+	packed += other;
+	const Matrix expression = (2.0F * padded) + packed;
+	Matrix copy(padded);
+	if (!copy.is_packed() || !matrices_close(packed, padded) ||
+		!matrices_close(3.0F * packed, expression) ||
+		!matrices_close(packed, copy) ||
+		(std::fabs(packed.sum() - padded.sum()) > relative_tolerance) ||
+		(std::fabs(packed.norm() - padded.norm()) > relative_tolerance) ||
+		(packed.argmax() != padded.argmax()))
+	{
+		return false;
+	}
+
+	// Products, as the vector or matrix operand
+	Matrix vector(20, 1);
+	fill_pattern(vector, 16);
+	Matrix batch(20, 7);
+	fill_pattern(batch, 17);
+	const Matrix padded_batch(batch, matrix_layout::PADDED);
+	if (!matrices_close(packed * vector, padded * vector) ||
+		!matrices_close(packed * batch, padded * padded_batch) ||
+		!matrices_close(packed * batch, packed * padded_batch))
+	{
+		return false;
+	}
+
+	// Reading, transposing and vectorizing
+	std::stringstream stream;
+	stream.write(reinterpret_cast<const char*>(packed.data()),
+				 sizeof(float) * 10 * 20);
+	Matrix read(10, 20, matrix_layout::PADDED);
+	stream >> read;
+	Matrix transposed(padded, matrix_layout::PADDED);
+	transposed.transpose();
+	Matrix vectorized(padded, matrix_layout::PADDED);
+	vectorized.vectorize();
+	return matrices_close(packed, read) && !transposed.is_packed() &&
+		   matrices_close(Matrix(packed).transpose(), transposed) &&
+		   matrices_close(Matrix(packed).vectorize(), vectorized) &&
+		   vectorized.is_packed();
+}
+
+/**
+* Tests matrices loaded through a file mapping: the values match the
+* file, copies share the mapped memory, and a modification detaches
+* only the modified matrix, leaving the file untouched.
+* @return True on success.
+*/
+static bool test_mapped_matrix_shares_until_written()
+{
+	const char* path = "tests_mapped_matrix.bin";
+	Matrix expected(3, 4);
+	fill_pattern(expected, 15);
+	{
+		std::ofstream file(path, std::ios::binary);
+		file.write(reinterpret_cast<const char*>(expected.data()),
+				   sizeof(float) * 3 * 4);
+	}
+
+	bool passed = true;
+	{
+		const Matrix mapped = map_matrix(path, {3, 4});
+		Matrix copy(mapped);
+		// Read through a const reference, non-const access detaches
+		const Matrix& shared = copy;
+		passed = mapped.is_borrowed() && shared.is_borrowed() &&
+				 (shared.data() == mapped.data()) &&
+				 matrices_close(mapped, expected);
+
+		copy[0] = 100.0F;
+		passed = passed && !copy.is_borrowed() && mapped.is_borrowed() &&
+				 (mapped[0] == expected[0]) && (copy[1] == expected[1]);
+
+		Matrix reread(3, 4);
+		std::ifstream file(path, std::ios::binary);
+		file >> reread;
+		passed = passed && matrices_close(reread, expected);
+
+		try
+		{
+			(void)map_matrix(path, {4, 4});
+			passed = false;
+		}
+		catch (const std::runtime_error&)
+		{
+		}
+	}
+
+	std::remove(path);
+	return passed;
+}
+
+/**
+* Tests a model file round trip: the loaded layers match the saved
+* ones, their tensors are aligned and borrowed from the mapping, the
+* network built from them matches one built from the source matrices,
+* and a corrupted file fails the checksum.
+* @return True on success.
+*/
+static bool test_model_file_round_trip()
+{
+	const char* path = "tests_model.mlp";
+	const std::vector<model::layer> saved = pattern_network(3, 0.1F);
+	model::save(path, saved);
+
+	bool passed = true;
+	{
+		const auto loaded = model::load(path);
+		passed = (saved.size() == loaded.size());
+		for (size_t layer = 0; passed && (layer < loaded.size()); layer++)
+		{
+			const auto address = reinterpret_cast<uintptr_t>(
+				loaded[layer].weights.data());
+			passed = loaded[layer].weights.is_borrowed() &&
+					 (0 == address % model::TENSOR_ALIGNMENT) &&
+					 (saved[layer].activation == loaded[layer].activation) &&
+					 matrices_close(loaded[layer].weights,
+									saved[layer].weights) &&
+					 matrices_close(loaded[layer].bias, saved[layer].bias);
+		}
+
+		Matrix loaded_weights[MLP_SIZE];
+		Matrix loaded_biases[MLP_SIZE];
+		model::load_mlp(path, loaded_weights, loaded_biases);
+		const MlpNetwork expected_mlp(saved);
+		const MlpNetwork loaded_mlp(loaded_weights, loaded_biases);
+		Matrix image(img_dims.rows * img_dims.cols, 1);
+		fill_pattern(image, 9);
+		const digit expected = expected_mlp(image);
+		const digit result = loaded_mlp(image);
+		passed = passed && (expected.value == result.value) &&
+				 (expected.probability == result.probability);
+	}
+
+	// Flipping a single tensor byte fails the checksum
+	{
+		std::fstream file(path, std::ios::binary | std::ios::in |
+								std::ios::out);
+		file.seekp(sizeof(model::model_header) +
+				   (MLP_SIZE * sizeof(model::model_layer)) + 64);
+		file.put('\x7F');
+	}
+	try
+	{
+		(void)model::load(path);
+		passed = false;
+	}
+	catch (const std::runtime_error&)
+	{
+	}
+
+	// Tensor offsets which wrap around, or point into the header or
+	// the layer table, are rejected even with a matching checksum
+	const std::vector<model::layer> crafted = {
+		{Matrix(4, 3), Matrix(4, 1), activation::relu},
+		{Matrix(2, 4), Matrix(2, 1), activation::softmax}};
+	// Past the end by wrapping, in the header, in the second table entry
+	for (const uint64_t offset : {UINT64_MAX - model::TENSOR_ALIGNMENT + 1,
+								  static_cast<uint64_t>(0),
+								  model::TENSOR_ALIGNMENT})
+	{
+		model::save(path, crafted);
+		std::fstream file(path, std::ios::binary | std::ios::in |
+								std::ios::out);
+		std::vector<char> contents(
+			(std::istreambuf_iterator<char>(file)),
+			std::istreambuf_iterator<char>());
+		model::model_header header = {};
+		model::model_layer entry = {};
+		std::memcpy(&header, contents.data(), sizeof(header));
+		std::memcpy(&entry, contents.data() + sizeof(header), sizeof(entry));
+		entry.weights_offset = offset;
+		std::memcpy(&contents[sizeof(header)], &entry, sizeof(entry));
+		uint64_t checksum = 14695981039346656037ULL;
+		for (size_t index = sizeof(header); index < contents.size(); index++)
+		{
+			checksum = (checksum ^ static_cast<unsigned char>(contents[index])) *
+					   1099511628211ULL;
+		}
+		header.checksum = checksum;
+		std::memcpy(contents.data(), &header, sizeof(header));
+		file.seekp(0);
+		file.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+		file.close();
+		try
+		{
+			(void)model::load(path);
+			passed = false;
+		}
+		catch (const std::runtime_error&)
+		{
+		}
+	}
+
+	std::remove(path);
+	return passed;
+}
+
+/**
+* Running all the tests.
+* @return EXIT_SUCCESS if all tests passed, EXIT_FAILURE otherwise.
+*/
+int main()
+{
+	const struct
+	{
+		const char* name;
+		bool (*test)();
+	} tests[] = {
+		{"multiply_matches_reference", test_multiply_matches_reference},
+		{"gemm_kernels_match_reference", test_gemm_kernels_match_reference},
+		{"parallel_gemm_matches_serial", test_parallel_gemm_matches_serial},
+		{"nested_loops_run_inline", test_nested_loops_run_inline},
+		{"gemv_kernels_match_reference", test_gemv_kernels_match_reference},
+		{"dense_forward_matches_unfused", test_dense_forward_matches_unfused},
+		{"int8_kernels_match_reference", test_int8_kernels_match_reference},
+		{"dense_int8_matches_fp32", test_dense_int8_matches_fp32},
+		{"half_conversions_round", test_half_conversions_round},
+		{"half_kernels_match_reference", test_half_kernels_match_reference},
+		{"sparse_kernels_match_reference",
+		 test_sparse_kernels_match_reference},
+		{"sparse_input_gemv_matches_dense",
+		 test_sparse_input_gemv_matches_dense},
+		{"softmax_stable_and_accurate", test_softmax_stable_and_accurate},
+		{"reductions_match_reference", test_reductions_match_reference},
+		{"classify_batch_matches_single", test_classify_batch_matches_single},
+		{"padded_image_classifies_like_packed",
+		 test_padded_image_classifies_like_packed},
+		{"forward_does_not_allocate", test_forward_does_not_allocate},
+		{"configurable_network_depths", test_configurable_network_depths},
+		{"instrumentation_counts_layers", test_instrumentation_counts_layers},
+		{"static_network_matches_dynamic",
+		 test_static_network_matches_dynamic},
+		{"concurrent_inference_matches_serial",
+		 test_concurrent_inference_matches_serial},
+		{"pipeline_matches_network", test_pipeline_matches_network},
+		{"trainer_learns_and_is_deterministic",
+		 test_trainer_learns_and_is_deterministic},
+		{"multiply_incompatible_dimensions",
+		 test_multiply_incompatible_dimensions},
+		{"expressions_match_elementwise", test_expressions_match_elementwise},
+		{"expressions_read_like_matrices",
+		 test_expressions_read_like_matrices},
+		{"move_takes_storage", test_move_takes_storage},
+		{"views_address_elements", test_views_address_elements},
+		{"view_products_match_reference", test_view_products_match_reference},
+		{"transpose_matches_elements", test_transpose_matches_elements},
+		{"padded_matrix_matches_packed", test_padded_matrix_matches_packed},
+		{"mapped_matrix_shares_until_written",
+		 test_mapped_matrix_shares_until_written},
+		{"model_file_round_trip", test_model_file_round_trip},
+	};
+
+	int failures = 0;
+	for (const auto& test : tests)
+	{
+		const bool passed = test.test();
+		std::cout << (passed ? "PASS " : "FAIL ") << test.name << std::endl;
+		failures += passed ? 0 : 1;
+	}
+
+	return (0 == failures) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
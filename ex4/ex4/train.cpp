@@ -0,0 +1,395 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MlpNetwork.h"
+#include "ModelFile.h"
+#include "Trainer.h"
+
+#define USAGE_MSG "Usage:\n" \
+				  "\t./train [options] images labels model\n" \
+				  "\timages - the training images, an MNIST idx3-ubyte file\n" \
+				  "\tlabels - the training labels, an MNIST idx1-ubyte file\n" \
+				  "\tmodel - the model file to write (see convert_model)\n" \
+				  "options:\n" \
+				  "\t-s n0,n1,...,nk - the layer widths, n0 the image size\n" \
+				  "\t                  (the default is 784,128,64,20,10)\n" \
+				  "\t-i model - start from a model file, not random weights\n" \
+				  "\t-e epochs - the training epochs (the default is 5)\n" \
+				  "\t-b batch - the minibatch size (the default is 128)\n" \
+				  "\t-o adam|sgd - the optimizer (the default is adam)\n" \
+				  "\t-r rate - the learning rate (the default is 0.001 for\n" \
+				  "\t          adam, 0.05 for sgd, with momentum 0.9)\n" \
+				  "\t-t threads - the training threads (the default is one\n" \
+				  "\t             per hardware thread)\n" \
+				  "\t-v images labels - held-out images, whose accuracy is\n" \
+				  "\t                   printed after every epoch\n" \
+				  "\t-p directory - also write the parameter files w1..wk,\n" \
+				  "\t               b1..bk (as given to mlpnetwork) into it"
+#define IMAGES_MAGIC 2051
+#define LABELS_MAGIC 2049
+#define PIXEL_MAX 255.0F
+#define DEFAULT_EPOCHS 5
+#define DEFAULT_SGD_RATE 0.05F
+#define DEFAULT_WIDTHS "784,128,64,20,10"
+#define INVALID_IDX_EX ("Invalid MNIST file: ")
+#define INVALID_SHAPE_EX ("Invalid layer widths: ")
+#define INVALID_OPTION_EX ("Invalid option: ")
+#define WRITE_FAILED_EX ("Cannot write: ")
+
+/**
+* Reads a big-endian 32 bit integer of an IDX file header.
+* @param file - The file.
+* @param path - The file path, for the error.
+* @throws std::runtime_error in case the file ended.
+* @return The integer.
+*/
+static uint32_t read_header_value(std::ifstream& file, const std::string& path)
+{
+	unsigned char bytes[sizeof(uint32_t)] = {};
+	if (!file.read(reinterpret_cast<char*>(bytes), sizeof(bytes)))
+	{
+		throw std::runtime_error(INVALID_IDX_EX + path);
+	}
+
+	return (static_cast<uint32_t>(bytes[0]) << 24) |
+		   (static_cast<uint32_t>(bytes[1]) << 16) |
+		   (static_cast<uint32_t>(bytes[2]) << 8) |
+		   static_cast<uint32_t>(bytes[3]);
+}
+
+/**
+* Reads the unsigned bytes after an IDX file header.
+* @param file - The file, after its header.
+* @param path - The file path, for the error.
+* @param size - The number of bytes.
+* @throws std::runtime_error in case the file is shorter.
+* @return The bytes.
+*/
+static std::vector<unsigned char> read_idx_bytes(std::ifstream& file,
+												 const std::string& path,
+												 size_t size)
+{
+	std::vector<unsigned char> bytes(size);
+	if (!file.read(reinterpret_cast<char*>(bytes.data()),
+				   static_cast<std::streamsize>(size)))
+	{
+		throw std::runtime_error(INVALID_IDX_EX + path);
+	}
+
+	return bytes;
+}
+
+/**
+* Reads MNIST images, scaled to [0, 1] like the images mlpnetwork
+* classifies.
+* @param path - An idx3-ubyte file.
+* @throws std::runtime_error in case the file cannot be read, or is
+*		  not an idx3-ubyte file.
+* @return The images, one per row.
+*/
+static Matrix read_images(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file || (IMAGES_MAGIC != read_header_value(file, path)))
+	{
+		throw std::runtime_error(INVALID_IDX_EX + path);
+	}
+	const uint32_t count = read_header_value(file, path);
+	const uint32_t rows = read_header_value(file, path);
+	const uint32_t cols = read_header_value(file, path);
+	if ((0 == count) || (0 == rows * cols))
+	{
+		throw std::runtime_error(INVALID_IDX_EX + path);
+	}
+
+	const std::vector<unsigned char> pixels =
+		read_idx_bytes(file, path, static_cast<size_t>(count) * rows * cols);
+	Matrix images(static_cast<int>(count), static_cast<int>(rows * cols));
+	for (int image = 0; image < images.get_rows(); image++)
+	{
+		for (int pixel = 0; pixel < images.get_cols(); pixel++)
+		{
+			images(image, pixel) = pixels[(static_cast<size_t>(image) *
+										   images.get_cols()) + pixel] /
+								   PIXEL_MAX;
+		}
+	}
+
+	return images;
+}
+
+/**
+* Reads MNIST labels.
+* @param path - An idx1-ubyte file.
+* @throws std::runtime_error in case the file cannot be read, or is
+*		  not an idx1-ubyte file.
+* @return The labels.
+*/
+static std::vector<unsigned int> read_labels(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file || (LABELS_MAGIC != read_header_value(file, path)))
+	{
+		throw std::runtime_error(INVALID_IDX_EX + path);
+	}
+
+	const std::vector<unsigned char> bytes =
+		read_idx_bytes(file, path, read_header_value(file, path));
+	return std::vector<unsigned int>(bytes.begin(), bytes.end());
+}
+
+/**
+* Parses comma separated layer widths.
+* @param shape - The widths, such as "784,64,10".
+* @throws std::invalid_argument in case a width is not a positive
+*		  number.
+* @return The widths.
+*/
+static std::vector<int> parse_widths(const std::string& shape)
+{
+	std::vector<int> widths;
+	std::stringstream stream(shape);
+	std::string width;
+	while (std::getline(stream, width, ','))
+	{
+		const int value = std::atoi(width.c_str());
+		if (0 >= value)
+		{
+			throw std::invalid_argument(INVALID_SHAPE_EX + shape);
+		}
+		widths.push_back(value);
+	}
+
+	return widths;
+}
+
+/**
+* Parses a positive number option.
+* @param flag - The option, for the error.
+* @param value - The value, such as "128".
+* @throws std::invalid_argument in case the value is not a positive
+*		  number.
+* @return The number.
+*/
+static float parse_positive(const std::string& flag, const std::string& value)
+{
+	char* end = nullptr;
+	const float number = std::strtof(value.c_str(), &end);
+	if (value.empty() || ('\0' != *end) || !(0.0F < number))
+	{
+		throw std::invalid_argument(INVALID_OPTION_EX + flag + " " + value);
+	}
+
+	return number;
+}
+
+/**
+* Writes the layers as loose parameter files, w1..wk and b1..bk, the
+* rows of every matrix one after the other.
+* @param directory - The directory to write the files into.
+* @param layers - The layers.
+* @throws std::runtime_error in case a file cannot be written.
+*/
+static void write_parameters(const std::string& directory,
+							 const std::vector<model::layer>& layers)
+{
+	for (size_t index = 0; index < layers.size(); index++)
+	{
+		const Matrix* matrices[] = {&layers[index].weights,
+									&layers[index].bias};
+		const char* names[] = {"/w", "/b"};
+		for (int part = 0; part < 2; part++)
+		{
+			const std::string path = directory + names[part] +
+									 std::to_string(index + 1);
+			std::ofstream file(path, std::ios::binary);
+			const Matrix& matrix = *matrices[part];
+			for (int row = 0; row < matrix.get_rows(); row++)
+			{
+				file.write(reinterpret_cast<const char*>(
+							   matrix.data() + (row * matrix.get_stride())),
+						   static_cast<std::streamsize>(matrix.get_cols() *
+														sizeof(float)));
+			}
+			if (!file)
+			{
+				throw std::runtime_error(WRITE_FAILED_EX + path);
+			}
+		}
+	}
+}
+
+/**
+* Gets the fraction of the images a network classifies correctly.
+* @param network - The network.
+* @param images - The images, one per row.
+* @param labels - The label of every image.
+* @return The accuracy, in [0, 1].
+*/
+static float accuracy(const MlpNetwork& network, const Matrix& images,
+					  const std::vector<unsigned int>& labels)
+{
+	const std::vector<digit> results =
+		network.classify_batch(MatrixView(images).transpose());
+	long correct = 0;
+	for (size_t index = 0; index < results.size(); index++)
+	{
+		correct += (results[index].value == labels[index]) ? 1 : 0;
+	}
+
+	return static_cast<float>(correct) / static_cast<float>(results.size());
+}
+
+/**
+* Trains a network on MNIST files and writes it as a model file, which
+* mlpnetwork classifies with.
+* @param argc count of args
+* @param argv args values
+* @return program exit status code
+*/
+int main(int argc, char** argv)
+{
+	try
+	{
+		training_options options = default_training_options;
+		options.threads = std::max(1U, std::thread::hardware_concurrency());
+		std::string widths = DEFAULT_WIDTHS;
+		std::string initial_model;
+		std::string parameters_directory;
+		std::string validation_images;
+		std::string validation_labels;
+		bool rate_given = false;
+		int epochs = DEFAULT_EPOCHS;
+		std::vector<std::string> positional;
+		for (int index = 1; index < argc; index++)
+		{
+			const std::string flag = argv[index];
+			const bool has_value = (index + 1 < argc);
+			if (("-v" == flag) && (index + 2 < argc))
+			{
+				validation_images = argv[++index];
+				validation_labels = argv[++index];
+			}
+			else if (("-s" == flag) && has_value)
+			{
+				widths = argv[++index];
+			}
+			else if (("-i" == flag) && has_value)
+			{
+				initial_model = argv[++index];
+			}
+			else if (("-p" == flag) && has_value)
+			{
+				parameters_directory = argv[++index];
+			}
+			else if (("-e" == flag) && has_value)
+			{
+				epochs = static_cast<int>(parse_positive(flag, argv[++index]));
+			}
+			else if (("-b" == flag) && has_value)
+			{
+				options.batch_size = static_cast<int>(
+					parse_positive(flag, argv[++index]));
+			}
+			else if (("-t" == flag) && has_value)
+			{
+				options.threads = static_cast<int>(
+					parse_positive(flag, argv[++index]));
+			}
+			else if (("-r" == flag) && has_value)
+			{
+				options.learning_rate = parse_positive(flag, argv[++index]);
+				rate_given = true;
+			}
+			else if (("-o" == flag) && has_value)
+			{
+				const std::string optimizer = argv[++index];
+				if (("adam" != optimizer) && ("sgd" != optimizer))
+				{
+					throw std::invalid_argument(INVALID_OPTION_EX + flag + " " +
+												optimizer);
+				}
+				options.optimizer = ("sgd" == optimizer) ? optimizer_kind::SGD
+														 : optimizer_kind::ADAM;
+			}
+			else if ('-' == flag[0])
+			{
+				std::cerr << USAGE_MSG << std::endl;
+				return EXIT_FAILURE;
+			}
+			else
+			{
+				positional.push_back(flag);
+			}
+		}
+		if (3 != positional.size())
+		{
+			std::cerr << USAGE_MSG << std::endl;
+			return EXIT_FAILURE;
+		}
+		if ((optimizer_kind::SGD == options.optimizer) && !rate_given)
+		{
+			options.learning_rate = DEFAULT_SGD_RATE;
+		}
+
+		const Matrix images = read_images(positional[0]);
+		const std::vector<unsigned int> labels = read_labels(positional[1]);
+		Matrix test_images;
+		std::vector<unsigned int> test_labels;
+		if (!validation_images.empty())
+		{
+			test_images = read_images(validation_images);
+			test_labels = read_labels(validation_labels);
+			if (static_cast<size_t>(test_images.get_rows()) != test_labels.size())
+			{
+				throw std::invalid_argument(INVALID_IDX_EX + validation_labels);
+			}
+		}
+
+		Trainer trainer(initial_model.empty() ?
+						Trainer::initial_layers(parse_widths(widths), options.seed) :
+						model::load(initial_model), options);
+		for (int epoch = 1; epoch <= epochs; epoch++)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			const epoch_result result = trainer.train_epoch(images, labels);
+			const std::chrono::duration<double> seconds =
+				std::chrono::steady_clock::now() - start;
+			std::cout << "epoch " << epoch << ": loss " << std::fixed
+					  << std::setprecision(4) << result.loss << ", accuracy "
+					  << std::setprecision(2) << 100.0F * result.accuracy
+					  << "%, " << seconds.count() << "s";
+			if (!validation_images.empty())
+			{
+				const MlpNetwork network(trainer.get_layers());
+				std::cout << ", held-out accuracy "
+						  << 100.0F * accuracy(network, test_images, test_labels)
+						  << "%";
+			}
+			std::cout << std::endl;
+		}
+
+		model::save(positional[2], trainer.get_layers());
+		if (!parameters_directory.empty())
+		{
+			write_parameters(parameters_directory, trainer.get_layers());
+		}
+	}
+	catch (const std::exception& exception)
+	{
+		std::cerr << exception.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}